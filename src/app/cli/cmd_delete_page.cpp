@@ -25,9 +25,14 @@ int cmd_delete_page(const DeleteArgs &args) {
         return 1;
     }
 
+    // the content of the deleted page is not referenced anymore and does not have to be written
+    auto options                = pdf::WriteOptions();
+    options.compression         = document.compression;
+    options.removeUnusedObjects = true;
+
     uint8_t *buffer = nullptr;
     size_t size     = 0;
-    result          = document.write_to_memory(buffer, size);
+    result          = document.write_to_memory(buffer, size, options);
     if (result.has_error()) {
         spdlog::error("Failed to save PDF document: {}", result.message());
         return 1;
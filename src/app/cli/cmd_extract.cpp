@@ -1,3 +1,6 @@
+#include <pdf/hash/hex_string.h>
+#include <pdf/stream_reader.h>
+
 struct ExtractArgs {
     std::string_view source;
 };
@@ -18,18 +21,46 @@ int cmd_extract(ExtractArgs &args) {
 
     // TODO get the file name from the file specifications
 
-    document.for_each_embedded_file([](pdf::EmbeddedFile * /*file*/) {
+    int count      = 0;
+    document.for_each_embedded_file([&count, &document](pdf::EmbeddedFile *file) {
         spdlog::info("Found embedded file");
 
         // TODO check that the file does not exist already (if so add a "-1" to the file name)
+        const auto &fileName = "embedded-file-" + std::to_string(count);
+        std::ofstream os(fileName, std::ios::binary);
+        if (!os.is_open()) {
+            spdlog::warn("Failed to open file '{}' for writing", fileName);
+            return pdf::ForEachResult::CONTINUE;
+        }
+
+        // the embedded file is decoded and written in chunks, since it might be too large to fit into memory
+        auto md5    = pdf::hash::MD5Context();
+        auto reader = pdf::StreamReader(document.allocator, file);
+        while (auto chunk = reader.read()) {
+            os.write(chunk->data(), static_cast<std::streamsize>(chunk->size()));
+            md5.update(reinterpret_cast<const uint8_t *>(chunk->data()), chunk->size());
+        }
+        os.close();
 
-        //        auto content = file->decode(document.allocator);
-        //        std::ofstream os(std::string(file->name()), std::ios::binary);
-        //        os.write(content.data(), static_cast<std::streamsize>(content.size()));
-        //        os.close();
+        if (reader.result().has_error()) {
+            spdlog::warn("Failed to decode embedded file '{}': {}", fileName, reader.result().message());
+            return pdf::ForEachResult::CONTINUE;
+        }
 
+        // the checksum is the raw MD5 digest
+        auto checksum = file->check_sum();
+        auto digest   = md5.finish();
+        auto expected = std::string_view(reinterpret_cast<const char *>(digest.data()), sizeof(digest));
+        if (checksum.has_value() && checksum.value() != expected) {
+            spdlog::warn("Checksum of embedded file '{}' does not match", fileName);
+        }
+
+        spdlog::info("Extracted {} bytes into '{}'", reader.position(), fileName);
+        count++;
         return pdf::ForEachResult::CONTINUE;
     });
 
+    spdlog::info("Extracted {} embedded files", count);
+
     return 0;
 }
@@ -2,6 +2,8 @@
 
 struct InfoArgs {
     std::string_view source = {};
+    /// print how much memory the arenas of the allocator used while reading the document
+    bool showMemory = false;
 };
 
 std::string formatSizeInBytes(size_t size) {
@@ -18,6 +20,22 @@ std::string formatSizeInBytes(size_t size) {
     return std::format("{:.2f} {}", (float)size / ((float)size_count * 1024.0), s[size_count]);
 }
 
+void print_arena_statistics(const std::string &name, const pdf::ArenaStatistics &statistics) {
+    spdlog::info("{} arena ({} pages):", name, pdf::arena_pages_name(statistics.pages));
+    spdlog::info("    Committed:   {:>12}", formatSizeInBytes(statistics.committedSizeInBytes));
+    spdlog::info("    Used:        {:>12}", formatSizeInBytes(statistics.usedSizeInBytes));
+    spdlog::info("    Peak:        {:>12}", formatSizeInBytes(statistics.peakUsedSizeInBytes));
+    spdlog::info("    Allocations: {:>12}", statistics.allocationCount);
+    for (size_t i = 0; i < statistics.allocatedSizeInBytesByTag.size(); i++) {
+        auto sizeInBytes = statistics.allocatedSizeInBytesByTag[i];
+        if (sizeInBytes == 0) {
+            continue;
+        }
+        auto tag = pdf::allocation_tag_name(static_cast<pdf::AllocationTag>(i));
+        spdlog::info("    {:<12} {:>12}", std::format("{}:", tag), formatSizeInBytes(sizeInBytes));
+    }
+}
+
 int cmd_info(const InfoArgs &args) {
     auto allocatorResult = pdf::Allocator::create();
     if (allocatorResult.has_error()) {
@@ -37,14 +55,21 @@ int cmd_info(const InfoArgs &args) {
     size_t wordCount           = document.word_count();
     size_t characterCount      = document.character_count();
     size_t objectCount         = document.object_count(false);
-    size_t parsableObjectCount = document.objects().size();
+    size_t parsableObjectCount = document.object_count(true);
 
     spdlog::info("Size:       {:>12}", formatSizeInBytes(document.file.sizeInBytes));
-    spdlog::info("Pages:      {:>5}", pageCount);
+    spdlog::info("Pages:      {:>5} ({} according to the page tree)", pageCount,
+                 document.declared_page_count().value_or(0));
     spdlog::info("Lines:      {:>5}", lineCount);
     spdlog::info("Words:      {:>5}", wordCount);
     spdlog::info("Characters: {:>5}", characterCount);
     spdlog::info("Objects:    {:>5} ({} parsable)", objectCount, parsableObjectCount);
 
+    if (args.showMemory) {
+        print_arena_statistics("Internal", document.allocator.internal_statistics());
+        print_arena_statistics("Temporary", document.allocator.temporary_statistics());
+        print_arena_statistics("Page", document.allocator.page_statistics());
+    }
+
     return 0;
 }
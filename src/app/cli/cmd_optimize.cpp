@@ -0,0 +1,43 @@
+#include <filesystem>
+#include <pdf/document.h>
+
+struct OptimizeArgs {
+    std::string_view source = {};
+    std::string_view target = {};
+};
+
+int cmd_optimize(const OptimizeArgs &args) {
+    auto allocatorResult = pdf::Allocator::create();
+    if (allocatorResult.has_error()) {
+        spdlog::error("Failed to create allocator: {}", allocatorResult.message());
+        return 1;
+    }
+
+    auto documentResult = pdf::Document::read_from_file(allocatorResult.value(), std::string(args.source));
+    if (documentResult.has_error()) {
+        spdlog::error("Failed to load PDF document: {}", documentResult.message());
+        return 1;
+    }
+
+    auto &document              = documentResult.value();
+    auto options                = pdf::WriteOptions();
+    options.removeUnusedObjects = true;
+    options.deduplicateObjects  = true;
+    options.renumberObjects     = true;
+    options.useObjectStreams    = true;
+
+    auto result = document.write_to_file(std::string(args.target), options);
+    if (result.has_error()) {
+        spdlog::error("Failed to save PDF document: {}", result.message());
+        return 1;
+    }
+
+    auto sizeBefore = document.file.sizeInBytes;
+    auto sizeAfter  = static_cast<size_t>(std::filesystem::file_size(std::string(args.target)));
+    auto savedBytes = sizeAfter < sizeBefore ? sizeBefore - sizeAfter : 0;
+    spdlog::info("Size before: {:>12}", formatSizeInBytes(sizeBefore));
+    spdlog::info("Size after:  {:>12}", formatSizeInBytes(sizeAfter));
+    spdlog::info("Saved:       {:>12} ({} bytes)", formatSizeInBytes(savedBytes), savedBytes);
+
+    return 0;
+}
@@ -19,13 +19,20 @@ int cmd_text(const TextArgs &args) {
     }
 
     auto &document = result.value();
-    document.for_each_page([](pdf::Page *page) {
-        auto textBlocks = page->text_blocks();
-        for (auto &textBlock : textBlocks) {
-            spdlog::info(textBlock.text);
+    // the pages are processed on all cores, everything that is produced for a page is released again (except for the
+    // text), so that long documents use little memory
+    auto pageTexts = document.parallel_for_each_page(0, [](pdf::Page *page) {
+        auto texts = std::vector<std::string>();
+        for (auto &textBlock : page->text_blocks()) {
+            texts.push_back(textBlock.text);
         }
-        return pdf::ForEachResult::CONTINUE;
+        return texts;
     });
+    for (auto &texts : pageTexts) {
+        for (auto &text : texts) {
+            spdlog::info(text);
+        }
+    }
 
     return 0;
 }
@@ -1,5 +1,6 @@
 #include <fstream>
 #include <iostream>
+#include <string_view>
 #include <pdf/document.h>
 
 #include "cmd_delete_page.cpp"
@@ -7,6 +8,7 @@
 #include "cmd_extract.cpp"
 #include "cmd_images.cpp"
 #include "cmd_info.cpp"
+#include "cmd_optimize.cpp"
 #include "cmd_text.cpp"
 
 void help() {
@@ -24,6 +26,7 @@ enum class CommandType {
     EMBED_FILES,
     EXTRACT_FILES,
     TEXT,
+    OPTIMIZE,
 };
 
 CommandType parse_command_type(int argc, char **argv) {
@@ -50,6 +53,9 @@ CommandType parse_command_type(int argc, char **argv) {
         if (arg == "extract") {
             return CommandType::EXTRACT_FILES;
         }
+        if (arg == "optimize") {
+            return CommandType::OPTIMIZE;
+        }
     }
 
     return CommandType::UNKNOWN;
@@ -67,7 +73,12 @@ int parse_document_source(int argc, char **argv, int firstArg, std::string_view
 }
 
 int parse_info_args(int argc, char **argv, InfoArgs &result) {
-    return parse_document_source(argc, argv, 2, result.source);
+    int firstArg = 2;
+    if (firstArg < argc && std::string_view(argv[firstArg]) == "--memory") {
+        result.showMemory = true;
+        firstArg++;
+    }
+    return parse_document_source(argc, argv, firstArg, result.source);
 }
 
 int parse_delete_args(int argc, char **argv, DeleteArgs &result) {
@@ -107,6 +118,21 @@ int parse_text_args(int argc, char **argv, TextArgs &result) {
     return parse_document_source(argc, argv, 2, result.source);
 }
 
+int parse_optimize_args(int argc, char **argv, OptimizeArgs &result) {
+    if (parse_document_source(argc, argv, 2, result.source)) {
+        return 1;
+    }
+
+    if (argc < 4) {
+        spdlog::error("No output file specified");
+        spdlog::error("    pdf-cli optimize [PDF_FILE] [OUTPUT_FILE]");
+        return 1;
+    }
+
+    result.target = std::string_view(argv[3], strlen(argv[3]));
+    return 0;
+}
+
 int main(int argc, char **argv) {
 #ifndef NDEBUG
     spdlog::set_level(spdlog::level::debug);
@@ -162,5 +188,12 @@ int main(int argc, char **argv) {
         }
         return cmd_text(args);
     }
+    case CommandType::OPTIMIZE: {
+        OptimizeArgs args;
+        if (parse_optimize_args(argc, argv, args)) {
+            return 1;
+        }
+        return cmd_optimize(args);
+    }
     }
 }
@@ -18,13 +18,15 @@ void ObjectList::fill_tree() {
     documentHasBeenParsed = true;
 
     spdlog::info("Filling document tree view");
-    document.for_each_object([this](pdf::IndirectObject *obj) {
+    // all objects have to be loaded before the referrers of an object are known
+    auto objects = document.objects();
+    for (auto obj : objects) {
         auto &row           = *treeStore->append();
         row[columns.name]   = std::to_string(obj->objectNumber) + " " + std::to_string(obj->generationNumber);
         row[columns.object] = obj;
         create_child_rows(row, obj->object);
-        return pdf::ForEachResult::CONTINUE;
-    });
+        create_referrer_row(row, obj);
+    }
 #if 0
     if (document.file.trailer.dict != nullptr) {
         auto &row           = *treeStore->append();create_child_rows
@@ -67,7 +69,7 @@ void ObjectList::create_child_rows(Gtk::TreeRow &parentRow, pdf::Object *object)
         parentRow[columns.value] = "Array";
         auto array = object->as<pdf::Array>();
         for (size_t i = 0; i < array->values.size(); i++) {
-            auto elem           = array->values[i];
+            auto &elem          = array->values[i];
             auto &row           = *treeStore->append(parentRow.children());
             row[columns.name]   = std::to_string(i);
             row[columns.object] = elem;
@@ -120,6 +122,25 @@ void ObjectList::create_child_rows(Gtk::TreeRow &parentRow, pdf::Object *object)
     }
 }
 
+void ObjectList::create_referrer_row(Gtk::TreeRow &parentRow, pdf::IndirectObject *object) {
+    std::string referrers;
+    document.for_each_referrer(object->objectNumber, [&referrers](pdf::IndirectObject *referrer) {
+        if (!referrers.empty()) {
+            referrers += ", ";
+        }
+        referrers += std::to_string(referrer->objectNumber) + " " + std::to_string(referrer->generationNumber) + " R";
+        return pdf::ForEachResult::CONTINUE;
+    });
+    if (referrers.empty()) {
+        return;
+    }
+
+    auto &row           = *treeStore->append(parentRow.children());
+    row[columns.name]   = "Referenced by";
+    row[columns.value]  = referrers;
+    row[columns.object] = object;
+}
+
 void ObjectList::on_row_clicked(const Gtk::TreeModel::Path &, Gtk::TreeViewColumn *) {
     auto refSelection = get_selection();
     if (!refSelection) {
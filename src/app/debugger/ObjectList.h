@@ -41,6 +41,7 @@ class ObjectList : public Gtk::TreeView {
     type_signal_object_selected signalObjectSelected;
 
     void create_child_rows(Gtk::TreeRow &parentRow, pdf::Object *object);
+    void create_referrer_row(Gtk::TreeRow &parentRow, pdf::IndirectObject *object);
 
     void create_row(pdf::Object *object, Gtk::TreeRow &parentRow, std::unordered_set<pdf::Object *> &alreadyVisited);
     void create_rows(pdf::Dictionary *dictionary, Gtk::TreeRow &parentRow,
@@ -1,4 +1,6 @@
 #include <benchmark/benchmark.h>
+#include <cstring>
+#include <mutex>
 
 #include <pdf/memory/arena_allocator.h>
 
@@ -28,6 +30,86 @@ static void BM_ArenaAllocate(benchmark::State &state) {
 }
 BENCHMARK(BM_ArenaAllocate)->Range(2, 1024);
 
+static void BM_ArenaAllocateTyped(benchmark::State &state) {
+    auto result = pdf::Arena::create();
+    ASSERT(!result.has_error());
+    auto &arena = result.value();
+    auto start  = arena.current_buffer_position();
+    for (auto _ : state) {
+        // an odd sized byte buffer in front of every object, like the body of a string before an operand
+        arena.push(3);
+        const auto buf = arena.push_array<double>(state.range(0));
+        benchmark::DoNotOptimize(buf);
+        arena.set_current_buffer_position(start);
+    }
+}
+BENCHMARK(BM_ArenaAllocateTyped)->Range(2, 1024);
+
+/// sums up integers that either start at an aligned address (offset 0) or that are shifted by offset bytes, shifted
+/// values straddle cache lines
+static void BM_SumIntegers(benchmark::State &state) {
+    const size_t count = 64 * 1024;
+    auto result        = pdf::Arena::create();
+    ASSERT(!result.has_error());
+    auto &arena  = result.value();
+    auto buffer  = arena.push(count * sizeof(int64_t) + pdf::CACHE_LINE_SIZE, pdf::CACHE_LINE_SIZE);
+    auto numbers = buffer + state.range(0);
+    for (size_t i = 0; i < count; i++) {
+        auto number = static_cast<int64_t>(i);
+        std::memcpy(numbers + i * sizeof(int64_t), &number, sizeof(int64_t));
+    }
+
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (size_t i = 0; i < count; i++) {
+            int64_t number;
+            std::memcpy(&number, numbers + i * sizeof(int64_t), sizeof(int64_t));
+            sum += number;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * count * sizeof(int64_t)));
+}
+BENCHMARK(BM_SumIntegers)->Arg(0)->Arg(4)->Arg(60);
+
+/// every thread pushes the same number of small objects, so that the committed memory stays bounded
+const int64_t CONTENDED_PUSH_ITERATIONS = 256 * 1024;
+
+static void BM_ConcurrentArenaPush(benchmark::State &state) {
+    static auto result = pdf::ConcurrentArena::create();
+    ASSERT(!result.has_error());
+    auto &arena = result.value();
+    if (state.thread_index() == 0) {
+        // the other threads wait for thread 0 before they start pushing
+        arena.pop_all();
+    }
+    for (auto _ : state) {
+        const auto buf = arena.push(16, 8);
+        benchmark::DoNotOptimize(buf);
+    }
+}
+BENCHMARK(BM_ConcurrentArenaPush)->Iterations(CONTENDED_PUSH_ITERATIONS)->ThreadRange(1, 64)->UseRealTime();
+
+/// the alternative to a ConcurrentArena: one Arena that is protected by a mutex
+static void BM_LockedArenaPush(benchmark::State &state) {
+    static auto result = pdf::Arena::create();
+    static std::mutex mutex;
+    ASSERT(!result.has_error());
+    auto &arena = result.value();
+    if (state.thread_index() == 0) {
+        arena.pop_all();
+    }
+    for (auto _ : state) {
+        uint8_t *buf = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            buf = arena.push(16, 8);
+        }
+        benchmark::DoNotOptimize(buf);
+    }
+}
+BENCHMARK(BM_LockedArenaPush)->Iterations(CONTENDED_PUSH_ITERATIONS)->ThreadRange(1, 64)->UseRealTime();
+
 static void BM_MallocAllocate(benchmark::State &state) {
     for (auto _ : state) {
         const auto buf = malloc(state.range(0));
@@ -0,0 +1,52 @@
+#include <benchmark/benchmark.h>
+
+#include <pdf/compression.h>
+
+static std::string create_content_stream(size_t sizeInBytes) {
+    auto result = std::string();
+    result.reserve(sizeInBytes);
+    for (size_t i = 0; result.size() < sizeInBytes; i++) {
+        result += "BT /F1 12 Tf " + std::to_string(i % 613) + " " + std::to_string(i * 31 % 797);
+        result += " Td (Hello) Tj ET\n";
+    }
+    result.resize(sizeInBytes);
+    return result;
+}
+
+static void run_deflate(benchmark::State &state, pdf::CompressionOptions options) {
+    auto allocatorResult = pdf::Allocator::create();
+    assert(not allocatorResult.has_error());
+    auto &allocator = allocatorResult.value();
+
+    auto data  = create_content_stream(state.range(0));
+    auto start = allocator.arena().current_buffer_position();
+    for (auto _ : state) {
+        auto result = pdf::deflate_buffer(allocator, (uint8_t *)data.data(), data.size(), options);
+        benchmark::DoNotOptimize(result);
+        allocator.arena().set_current_buffer_position(start);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+static void BM_DeflateBest(benchmark::State &state) {
+    auto options                     = pdf::CompressionOptions::best();
+    options.parallelThresholdInBytes = 0;
+    run_deflate(state, options);
+}
+BENCHMARK(BM_DeflateBest)->Range(64 * 1024, 64 * 1024 * 1024);
+
+static void BM_DeflateFast(benchmark::State &state) {
+    auto options                     = pdf::CompressionOptions::fast();
+    options.parallelThresholdInBytes = 0;
+    run_deflate(state, options);
+}
+BENCHMARK(BM_DeflateFast)->Range(64 * 1024, 64 * 1024 * 1024);
+
+static void BM_DeflateBestParallel(benchmark::State &state) {
+    auto options                     = pdf::CompressionOptions::best();
+    options.parallelThresholdInBytes = 1;
+    run_deflate(state, options);
+}
+BENCHMARK(BM_DeflateBestParallel)->Range(64 * 1024, 64 * 1024 * 1024)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,78 @@
+#include <benchmark/benchmark.h>
+
+#include <pdf/operator_parser.h>
+#include <pdf/page.h>
+
+/// a content stream with a mix of graphics and text operators, cut off after the last complete line
+static std::string create_content_stream(size_t sizeInBytes) {
+    auto result = std::string();
+    result.reserve(sizeInBytes);
+    for (size_t i = 0; result.size() < sizeInBytes; i++) {
+        auto x = std::to_string(i % 613);
+        auto y = std::to_string(i * 31 % 797);
+        result += "q 0.1 w 0 0 1 rg " + x + " " + y + " 20 10 re W* n Q\n";
+        result += "BT /F1 12 Tf " + x + " " + y + " Td (Hello) Tj T* [(W) 120 (orld)] TJ ET\n";
+    }
+    result.resize(result.rfind('\n', sizeInBytes) + 1);
+    return result;
+}
+
+static void BM_ParseOperators(benchmark::State &state) {
+    auto arenaResult = pdf::Arena::create();
+    assert(not arenaResult.has_error());
+    auto &arena = arenaResult.value();
+
+    auto data          = create_content_stream(state.range(0));
+    auto start         = arena.current_buffer_position();
+    auto operatorCount = size_t(0);
+    for (auto _ : state) {
+        {
+            auto textProvider = pdf::StringTextProvider(data);
+            auto lexer        = pdf::TextLexer(textProvider);
+            auto parser       = pdf::OperatorParser(lexer, arena);
+            while (auto op = parser.get_operator()) {
+                benchmark::DoNotOptimize(op);
+                operatorCount++;
+            }
+        }
+        arena.set_current_buffer_position(start);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(operatorCount));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+BENCHMARK(BM_ParseOperators)->Arg(10 * 1024 * 1024)->Unit(benchmark::kMillisecond);
+
+/// iterates the operators of a compressed content stream, after decoding it as a whole (0) or while decoding it (1)
+static void BM_IterateContentStream(benchmark::State &state) {
+    auto allocatorResult = pdf::Allocator::create();
+    assert(not allocatorResult.has_error());
+    auto &allocator = allocatorResult.value();
+
+    auto data   = create_content_stream(10 * 1024 * 1024);
+    auto stream = pdf::Stream::create_from_unencoded_data(
+                        allocator, pdf::UnorderedMap<std::string, pdf::Object *>(allocator), data)
+                        ->as<pdf::ContentStream>();
+
+    auto operatorCount = size_t(0);
+    auto countOperator = [&operatorCount](pdf::Operator *op) {
+        benchmark::DoNotOptimize(op);
+        operatorCount++;
+        return pdf::ForEachResult::CONTINUE;
+    };
+    for (auto _ : state) {
+        if (state.range(0) == 0) {
+            auto scope = pdf::PageArenaScope(allocator);
+            stream->for_each_operator(allocator, countOperator);
+            stream->forget_decoded_data(scope.start_position(), allocator.page().current_buffer_position());
+        } else {
+            stream->stream_operators(allocator, countOperator);
+        }
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(operatorCount));
+    state.counters["peak_bytes"] = static_cast<double>(allocator.page_statistics().peakUsedSizeInBytes +
+                                                       allocator.temporary_statistics().peakUsedSizeInBytes);
+    state.SetLabel(state.range(0) == 0 ? "decode" : "stream");
+}
+BENCHMARK(BM_IterateContentStream)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -1,6 +1,49 @@
 #include <benchmark/benchmark.h>
 
 #include <pdf/document.h>
+#include <pdf/parser.h>
+
+#if !WIN32
+#include <sys/resource.h>
+#endif
+
+static size_t page_fault_count() {
+#if WIN32
+    return 0;
+#else
+    rusage usage = {};
+    getrusage(RUSAGE_SELF, &usage);
+    return static_cast<size_t>(usage.ru_minflt + usage.ru_majflt);
+#endif
+}
+
+/// a document with objectCount small objects (a dictionary with an array of numbers each) and an empty page tree
+static std::string create_large_document(size_t objectCount) {
+    std::string result = "%PDF-1.7\n";
+    auto offsets       = std::vector<size_t>();
+    offsets.push_back(result.size());
+    result += "1 0 obj\n<</Type /Catalog /Pages 2 0 R>>\nendobj\n";
+    offsets.push_back(result.size());
+    result += "2 0 obj\n<</Type /Pages /Kids [] /Count 0>>\nendobj\n";
+    for (size_t i = 3; i < objectCount + 3; i++) {
+        offsets.push_back(result.size());
+        result += std::to_string(i) + " 0 obj\n<</Type /Test /Name (object " + std::to_string(i) + ") /Widths [";
+        for (size_t j = 0; j < 32; j++) {
+            result += std::to_string(500 + (i + j) % 100) + " ";
+        }
+        result += "]>>\nendobj\n";
+    }
+
+    const auto xrefOffset = result.size();
+    result += "xref\n0 " + std::to_string(offsets.size() + 1) + "\n0000000000 65535 f \n";
+    for (auto offset : offsets) {
+        auto number = std::to_string(offset);
+        result += std::string(10 - number.size(), '0') + number + " 00000 n \n";
+    }
+    result += "trailer\n<</Size " + std::to_string(offsets.size() + 1) + " /Root 1 0 R>>\n";
+    result += "startxref\n" + std::to_string(xrefOffset) + "\n%%EOF\n";
+    return result;
+}
 
 static void BM_Blank(benchmark::State &state) {
     auto allocatorResult = pdf::Allocator::create();
@@ -24,4 +67,60 @@ static void BM_HelloWorld(benchmark::State &state) {
 }
 BENCHMARK(BM_HelloWorld);
 
+/// arrays of numbers (e.g. /Widths of a font or /W of a cross reference stream) are very common
+static void BM_ParseNumberArray(benchmark::State &state) {
+    auto allocatorResult = pdf::Allocator::create();
+    assert(not allocatorResult.has_error());
+    auto &allocator = allocatorResult.value();
+
+    std::string input = "<</FirstChar 0 /LastChar " + std::to_string(state.range(0) - 1) + " /Widths [";
+    for (int64_t i = 0; i < state.range(0); i++) {
+        input += std::to_string(500 + i % 100) + " " + (i % 10 == 0 ? "0.5 " : "");
+    }
+    input += "]>>";
+
+    size_t usedBytes = 0;
+    for (auto _ : state) {
+        auto temp         = allocator.temporary();
+        auto before       = temp.arena().current_buffer_position();
+        auto textProvider = pdf::StringTextProvider(input);
+        auto lexer        = pdf::TextLexer(textProvider);
+        auto parser       = pdf::Parser(lexer, temp.arena());
+        auto result       = parser.parse();
+        benchmark::DoNotOptimize(result);
+        usedBytes = temp.arena().current_buffer_position() - before;
+    }
+    state.counters["arena_bytes"] = static_cast<double>(usedBytes);
+}
+BENCHMARK(BM_ParseNumberArray)->Arg(256)->Arg(4096);
+
+/// reads a large document with arenas that are backed by the kind of pages given as the first argument
+static void BM_ReadLargeDocument(benchmark::State &state) {
+    static const auto input = create_large_document(50000);
+    const auto pages        = static_cast<pdf::ArenaPages>(state.range(0));
+
+    size_t pageFaults = 0;
+    for (auto _ : state) {
+        const auto faultsBefore = page_fault_count();
+        auto allocatorResult    = pdf::Allocator::create(pages);
+        assert(not allocatorResult.has_error());
+        {
+            auto result = pdf::Document::read_from_memory(
+                  allocatorResult.value(), reinterpret_cast<const uint8_t *>(input.data()), input.size(), true);
+            assert(not result.has_error());
+            benchmark::DoNotOptimize(result);
+        }
+        pageFaults += page_fault_count() - faultsBefore;
+    }
+    state.counters["page_faults"] =
+          benchmark::Counter(static_cast<double>(pageFaults), benchmark::Counter::kAvgIterations);
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * input.size()));
+    state.SetLabel(pdf::arena_pages_name(pages));
+}
+BENCHMARK(BM_ReadLargeDocument)
+      ->Arg(static_cast<int64_t>(pdf::ArenaPages::NORMAL))
+      ->Arg(static_cast<int64_t>(pdf::ArenaPages::TRANSPARENT_HUGE))
+      ->Arg(static_cast<int64_t>(pdf::ArenaPages::EXPLICIT_HUGE))
+      ->Unit(benchmark::kMillisecond);
+
 BENCHMARK_MAIN();
@@ -13,6 +13,7 @@ static void BM_Blank(benchmark::State &state) {
         size_t size     = 0;
         auto result     = document.write_to_memory(buffer, size);
         benchmark::DoNotOptimize(result);
+        free(buffer);
     }
 }
 BENCHMARK(BM_Blank);
@@ -28,8 +29,105 @@ static void BM_HelloWorld(benchmark::State &state) {
         size_t size     = 0;
         auto result     = document.write_to_memory(buffer, size);
         benchmark::DoNotOptimize(result);
+        free(buffer);
     }
 }
 BENCHMARK(BM_HelloWorld);
 
+/// Creates a document with a page tree of the given size, where each page has its own content stream and resources
+static std::string create_large_document(int64_t pageCount) {
+    auto result  = std::string("%PDF-1.6\n");
+    auto offsets = std::vector<size_t>();
+    auto addObject = [&](const std::string &content) {
+        offsets.push_back(result.size());
+        result += std::to_string(offsets.size()) + " 0 obj\n" + content + "\nendobj\n";
+    };
+
+    auto kids = std::string();
+    for (int64_t i = 0; i < pageCount; i++) {
+        kids += std::to_string(3 + i * 2) + " 0 R ";
+    }
+    addObject("<</Type /Catalog /Pages 2 0 R>>");
+    addObject("<</Type /Pages /Count " + std::to_string(pageCount) + " /Kids [" + kids + "]>>");
+
+    for (int64_t i = 0; i < pageCount; i++) {
+        auto content = "BT /F1 12 Tf 56.8 " + std::to_string(700 - i % 600) + ".5 Td (Page " + std::to_string(i) +
+                       ") Tj ET";
+        addObject("<</Type /Page /Parent 2 0 R /MediaBox [0 0 612.0 792.0] /Contents " + std::to_string(4 + i * 2) +
+                  " 0 R /Resources <</Font <</F1 <</Type /Font /Subtype /Type1 /BaseFont /Helvetica>>>> "
+                  "/ProcSet [/PDF /Text]>> /Rotate 0 /UserUnit 1.25 /Tabs /S /Annots [] /Group <</S /Transparency "
+                  "/CS /DeviceRGB /I true>>>>");
+        addObject("<</Length " + std::to_string(content.size()) + ">>\nstream\n" + content + "\nendstream");
+    }
+
+    auto startXref = result.size();
+    result += "xref\n0 " + std::to_string(offsets.size() + 1) + "\n0000000000 65535 f \n";
+    for (auto offset : offsets) {
+        auto offsetStr = std::to_string(offset);
+        result += std::string(10 - offsetStr.size(), '0') + offsetStr + " 00000 n \n";
+    }
+    result += "trailer\n<</Size " + std::to_string(offsets.size() + 1) + " /Root 1 0 R>>\nstartxref\n" +
+              std::to_string(startXref) + "\n%%EOF\n";
+    return result;
+}
+
+static void BM_LargeDocument(benchmark::State &state) {
+    auto allocatorResult = pdf::Allocator::create();
+    assert(not allocatorResult.has_error());
+
+    auto data           = create_large_document(state.range(0));
+    auto documentResult = pdf::Document::read_from_memory(allocatorResult.value(), (uint8_t *)data.data(),
+                                                          data.size(), true);
+    assert(not documentResult.has_error());
+    auto &document = documentResult.value();
+
+    size_t bytesWritten = 0;
+    for (auto _ : state) {
+        uint8_t *buffer = nullptr;
+        size_t size     = 0;
+        auto result     = document.write_to_memory(buffer, size);
+        benchmark::DoNotOptimize(result);
+        bytesWritten += size;
+        free(buffer);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytesWritten));
+}
+BENCHMARK(BM_LargeDocument)->Range(1024, 64 * 1024)->Unit(benchmark::kMillisecond);
+
+static void BM_ParallelWrite(benchmark::State &state) {
+    auto allocatorResult = pdf::Allocator::create();
+    assert(not allocatorResult.has_error());
+
+    auto data           = create_large_document(state.range(0));
+    auto documentResult = pdf::Document::read_from_memory(allocatorResult.value(), (uint8_t *)data.data(),
+                                                          data.size(), true);
+    assert(not documentResult.has_error());
+    auto &document = documentResult.value();
+
+    // unmodified objects are copied verbatim, this benchmark is about serializing them
+    document.for_each_object([&document](pdf::IndirectObject *object) {
+        document.mark_dirty(object);
+        return pdf::ForEachResult::CONTINUE;
+    });
+
+    auto options        = pdf::WriteOptions();
+    options.threadCount = state.range(1);
+
+    size_t bytesWritten = 0;
+    for (auto _ : state) {
+        uint8_t *buffer = nullptr;
+        size_t size     = 0;
+        auto result     = document.write_to_memory(buffer, size, options);
+        benchmark::DoNotOptimize(result);
+        bytesWritten += size;
+        free(buffer);
+    }
+    state.SetBytesProcessed(static_cast<int64_t>(bytesWritten));
+}
+BENCHMARK(BM_ParallelWrite)
+      ->ArgsProduct({{64 * 1024}, {1, 2, 4, 8}})
+      ->ArgNames({"pages", "threads"})
+      ->Unit(benchmark::kMillisecond)
+      ->UseRealTime();
+
 BENCHMARK_MAIN();
@@ -247,7 +247,7 @@ CMap *CMapParser::parse() {
         currentTokenIdx++;
     }
 
-    auto charmap = UnorderedMap<uint8_t, std::string>(allocator);
+    auto charmap = UnorderedMap<uint8_t, std::string>(allocator.page());
 
     currentTokenIdx++;
     while (true) {
@@ -271,7 +271,7 @@ CMap *CMapParser::parse() {
         }
     }
 
-    return allocator.arena().push<CMap>(charmap);
+    return allocator.page().push<CMap>(charmap);
 }
 
 std::optional<CMap *> CMapStream::read_cmap(Allocator &allocator) {
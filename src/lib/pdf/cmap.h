@@ -25,9 +25,9 @@ struct CMapParser {
     Vector<Token> tokens;
 
     explicit CMapParser(Lexer &_lexer, Allocator &_allocator)
-        : lexer(_lexer), allocator(_allocator), tokens(allocator) {}
+        : lexer(_lexer), allocator(_allocator), tokens(allocator.page()) {}
 
-    /// Attempts to parse a CMap from the given lexer
+    /// Attempts to parse a CMap from the given lexer, the CMap is allocated in the page arena (see PageScope)
     CMap *parse(); // TODO maybe return by value instead of a pointer
 
   private:
@@ -0,0 +1,212 @@
+#include "compression.h"
+
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+namespace pdf {
+
+/// deflate keeps a window of the last 32 KB of input to find back references
+const size_t DEFLATE_WINDOW_SIZE = 32 * 1024;
+/// upper bound for what a sync flush adds to the compressed output of a block
+const size_t SYNC_FLUSH_OVERHEAD = 16;
+
+ValueResult<std::string_view> deflate_buffer_sequential(Allocator &allocator, const uint8_t *srcData, size_t srcSize,
+                                                        const CompressionOptions &options) {
+    z_stream stream = {};
+    stream.zalloc   = Z_NULL;
+    stream.zfree    = Z_NULL;
+    stream.opaque   = Z_NULL;
+
+    auto ret = deflateInit2(&stream, options.level, Z_DEFLATED, 15, options.memLevel, options.strategy);
+    if (ret != Z_OK) {
+        return ValueResult<std::string_view>::error("Failed to initialize deflate: {}", ret);
+    }
+
+    // NOTE the output is written straight into the arena, the unused rest of the allocation is popped afterwards
+    auto &arena      = allocator.arena();
+    auto bufferSize  = deflateBound(&stream, srcSize);
+    auto bufferData  = arena.push(bufferSize, CACHE_LINE_SIZE);
+    stream.avail_in  = (uInt)srcSize;       // size of input
+    stream.next_in   = (Bytef *)srcData;    // input char array
+    stream.avail_out = (uInt)bufferSize;    // size of output
+    stream.next_out  = (Bytef *)bufferData; // output char array
+
+    ret = deflate(&stream, Z_FINISH);
+    if (ret != Z_STREAM_END) {
+        deflateEnd(&stream);
+        arena.pop(bufferSize);
+        return ValueResult<std::string_view>::error("Failed to deflate buffer: {}", ret);
+    }
+
+    ret = deflateEnd(&stream);
+    if (ret != Z_OK) {
+        arena.pop(bufferSize);
+        return ValueResult<std::string_view>::error("Failed to finish deflating buffer: {}", ret);
+    }
+
+    auto resultSize = stream.total_out;
+    arena.pop(bufferSize - resultSize);
+    return ValueResult<std::string_view>::ok((char *)bufferData, resultSize);
+}
+
+struct CompressionBlock {
+    const uint8_t *input  = nullptr;
+    size_t inputSize      = 0;
+    uint8_t *output       = nullptr;
+    size_t outputCapacity = 0;
+    size_t outputSize     = 0;
+    uLong checksum        = 0;
+    bool hasError         = false;
+};
+
+void compress_block(CompressionBlock &block, const uint8_t *srcData, bool isLastBlock,
+                    const CompressionOptions &options) {
+    z_stream stream = {};
+    stream.zalloc   = Z_NULL;
+    stream.zfree    = Z_NULL;
+    stream.opaque   = Z_NULL;
+
+    // raw deflate (negative window bits), the zlib header and trailer are written once for the whole buffer
+    auto ret = deflateInit2(&stream, options.level, Z_DEFLATED, -15, options.memLevel, options.strategy);
+    if (ret != Z_OK) {
+        block.hasError = true;
+        return;
+    }
+
+    // prime the compressor with the end of the previous block, so that back references across blocks still work
+    if (block.input != srcData) {
+        auto dictionarySize = std::min(DEFLATE_WINDOW_SIZE, static_cast<size_t>(block.input - srcData));
+        deflateSetDictionary(&stream, block.input - dictionarySize, (uInt)dictionarySize);
+    }
+
+    stream.avail_in  = (uInt)block.inputSize;
+    stream.next_in   = (Bytef *)block.input;
+    stream.avail_out = (uInt)block.outputCapacity;
+    stream.next_out  = (Bytef *)block.output;
+
+    // every block but the last one ends with a sync flush, which byte-aligns the output and does not mark the deflate
+    // stream as finished, that way the compressed blocks can simply be concatenated
+    ret = deflate(&stream, isLastBlock ? Z_FINISH : Z_SYNC_FLUSH);
+    if ((isLastBlock && ret != Z_STREAM_END) || (!isLastBlock && ret != Z_OK) || stream.avail_in != 0) {
+        block.hasError = true;
+    }
+    deflateEnd(&stream);
+
+    block.outputSize = stream.total_out;
+    block.checksum   = adler32(adler32(0L, Z_NULL, 0), block.input, (uInt)block.inputSize);
+}
+
+/// returns an empty view if the blocks can't be compressed, the caller falls back to compressing sequentially
+std::string_view deflate_buffer_parallel(Allocator &allocator, const uint8_t *srcData, size_t srcSize,
+                                         const CompressionOptions &options) {
+    // the bound depends on the options (memLevel, strategy), deflateBound() knows them once the stream is initialized
+    z_stream boundStream = {};
+    if (deflateInit2(&boundStream, options.level, Z_DEFLATED, -15, options.memLevel, options.strategy) != Z_OK) {
+        return {};
+    }
+
+    auto temp       = allocator.temporary();
+    auto blockSize  = options.parallelBlockSizeInBytes;
+    auto blockCount = (srcSize + blockSize - 1) / blockSize;
+    auto blocks     = temp.arena().push_array<CompressionBlock>(blockCount);
+
+    // the output of all blocks lives in one allocation, the blocks are compacted once all of them are done
+    auto headerSize  = 2;
+    auto trailerSize = 4;
+    auto bufferSize  = static_cast<size_t>(headerSize + trailerSize);
+    for (size_t i = 0; i < blockCount; i++) {
+        auto block            = blocks + i;
+        block->input          = srcData + i * blockSize;
+        block->inputSize      = std::min(blockSize, srcSize - i * blockSize);
+        block->outputCapacity = deflateBound(&boundStream, (uLong)block->inputSize) + SYNC_FLUSH_OVERHEAD;
+        bufferSize += block->outputCapacity;
+    }
+    deflateEnd(&boundStream);
+
+    auto &arena     = allocator.arena();
+    auto bufferData = arena.push(bufferSize, CACHE_LINE_SIZE);
+    auto offset     = static_cast<size_t>(headerSize);
+    for (size_t i = 0; i < blockCount; i++) {
+        blocks[i].output = bufferData + offset;
+        offset += blocks[i].outputCapacity;
+    }
+
+    auto threadCount = options.threadCount;
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    threadCount = std::min(threadCount, blockCount);
+
+    auto nextBlock = std::atomic<size_t>(0);
+    auto worker    = [&]() {
+        for (auto i = nextBlock++; i < blockCount; i = nextBlock++) {
+            compress_block(blocks[i], srcData, i == blockCount - 1, options);
+        }
+    };
+    auto threads = std::vector<std::thread>();
+    threads.reserve(threadCount - 1);
+    for (size_t i = 0; i < threadCount - 1; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // zlib header (see RFC 1950): deflate with a 32K window and the level hint that zlib itself would have written
+    int levelFlags = 3;
+    if (options.strategy >= Z_HUFFMAN_ONLY || options.level < 2) {
+        levelFlags = 0;
+    } else if (options.level < 6) {
+        levelFlags = 1;
+    } else if (options.level == 6) {
+        levelFlags = 2;
+    }
+    uint32_t header = (0x78 << 8) | (levelFlags << 6);
+    header += 31 - (header % 31);
+    bufferData[0] = static_cast<uint8_t>(header >> 8);
+    bufferData[1] = static_cast<uint8_t>(header & 0xff);
+
+    auto checksum = adler32(0L, Z_NULL, 0);
+    auto position = bufferData + headerSize;
+    for (size_t i = 0; i < blockCount; i++) {
+        if (blocks[i].hasError) {
+            arena.pop(bufferSize);
+            return {};
+        }
+
+        std::memmove(position, blocks[i].output, blocks[i].outputSize);
+        position += blocks[i].outputSize;
+        checksum = adler32_combine(checksum, blocks[i].checksum, (z_off_t)blocks[i].inputSize);
+    }
+
+    position[0] = static_cast<uint8_t>(checksum >> 24);
+    position[1] = static_cast<uint8_t>(checksum >> 16);
+    position[2] = static_cast<uint8_t>(checksum >> 8);
+    position[3] = static_cast<uint8_t>(checksum);
+    position += trailerSize;
+
+    auto resultSize = static_cast<size_t>(position - bufferData);
+    arena.pop(bufferSize - resultSize);
+    return {(char *)bufferData, resultSize};
+}
+
+ValueResult<std::string_view> deflate_buffer(Allocator &allocator, const uint8_t *srcData, size_t srcSize,
+                                             const CompressionOptions &options) {
+    if (options.parallelThresholdInBytes != 0 && srcSize > options.parallelThresholdInBytes &&
+        srcSize > options.parallelBlockSizeInBytes) {
+        auto result = deflate_buffer_parallel(allocator, srcData, srcSize, options);
+        if (!result.empty()) {
+            return ValueResult<std::string_view>::ok(result);
+        }
+        spdlog::warn("Failed to compress buffer in parallel, compressing it sequentially instead");
+    }
+    return deflate_buffer_sequential(allocator, srcData, srcSize, options);
+}
+
+} // namespace pdf
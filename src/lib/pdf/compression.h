@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "pdf/memory/arena_allocator.h"
+#include "pdf/util/result.h"
+
+namespace pdf {
+
+const size_t PARALLEL_COMPRESSION_THRESHOLD  = 4 * 1024 * 1024; // 4 MB
+const size_t PARALLEL_COMPRESSION_BLOCK_SIZE = 1024 * 1024;     // 1 MB
+
+struct CompressionOptions {
+    /// zlib compression level (0 = no compression, 1 = fastest, 9 = smallest output)
+    int level = 9;
+    /// zlib compression strategy (0 = Z_DEFAULT_STRATEGY, 1 = Z_FILTERED, 2 = Z_HUFFMAN_ONLY, 3 = Z_RLE, 4 = Z_FIXED)
+    int strategy = 0;
+    /// how much memory zlib may use for its internal state (1 - 9)
+    int memLevel = 8;
+    /// buffers that are larger than this are split into blocks which are compressed in parallel (0 disables this)
+    size_t parallelThresholdInBytes = PARALLEL_COMPRESSION_THRESHOLD;
+    /// size of the blocks that are compressed in parallel
+    size_t parallelBlockSizeInBytes = PARALLEL_COMPRESSION_BLOCK_SIZE;
+    /// number of threads used for parallel compression (0 uses one thread per hardware thread)
+    size_t threadCount = 0;
+
+    /// produces the smallest output, this is what is used when saving a document
+    static CompressionOptions best() { return {}; }
+    /// optimized for latency, this is used for interactive edits
+    static CompressionOptions fast() {
+        auto result  = CompressionOptions();
+        result.level = 1;
+        return result;
+    }
+
+    bool operator==(const CompressionOptions &other) const = default;
+};
+
+/// Compresses the given buffer into a zlib stream that is allocated in the arena of the given allocator
+ValueResult<std::string_view> deflate_buffer(Allocator &allocator, const uint8_t *srcData, size_t srcSize,
+                                             const CompressionOptions &options = {});
+
+} // namespace pdf
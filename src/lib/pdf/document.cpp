@@ -1,9 +1,13 @@
 #include "document.h"
 
+#include <algorithm>
+#include <atomic>
 #include <bitset>
 #include <fstream>
+#include <numeric>
 #include <spdlog/spdlog.h>
 #include <sstream>
+#include <thread>
 #include <zlib.h>
 
 #include "pdf/hash/hex_string.h"
@@ -13,17 +17,34 @@
 
 namespace pdf {
 
-// TODO return a ValueResult instead, for better error messages
-std::pair<IndirectObject *, std::string_view> Document::load_object(int64_t objectNumber) {
-    CrossReferenceEntry *entry = nullptr;
+CrossReferenceEntry *CrossReferenceTable::find(int64_t objectNumber) {
+    size_t index = 0;
+    for (auto &subsection : subsections) {
+        if (objectNumber >= subsection.firstObjectNumber &&
+            objectNumber < subsection.firstObjectNumber + subsection.objectCount) {
+            index += objectNumber - subsection.firstObjectNumber;
+            return index < entries.size() ? &entries[index] : nullptr;
+        }
+        index += subsection.objectCount;
+    }
+    return nullptr;
+}
+
+CrossReferenceEntry *Document::find_cross_reference_entry(int64_t objectNumber) {
     for (Trailer *t = &file.trailer; t != nullptr; t = t->prev) {
-        if (objectNumber >= t->crossReferenceTable.firstObjectNumber &&
-            objectNumber < t->crossReferenceTable.objectCount) {
-            entry = &t->crossReferenceTable.entries[objectNumber - t->crossReferenceTable.firstObjectNumber];
-            break;
+        auto entry = t->crossReferenceTable.find(objectNumber);
+        if (entry != nullptr) {
+            return entry;
         }
     }
+    return nullptr;
+}
 
+// TODO return a ValueResult instead, for better error messages
+std::pair<IndirectObject *, std::string_view> Document::load_object(int64_t objectNumber) {
+    auto tagScope = AllocationTagScope(allocator, AllocationTag::PARSER);
+
+    auto entry = find_cross_reference_entry(objectNumber);
     if (entry == nullptr) {
         return {nullptr, {}};
     }
@@ -61,52 +82,70 @@ std::pair<IndirectObject *, std::string_view> Document::load_object(int64_t obje
         auto stream       = streamObject->object->as<Stream>();
         ASSERT(stream->dictionary->must_find<Name>("Type")->value == "ObjStm");
 
-        auto content      = stream->decode(allocator);
-        auto textProvider = StringTextProvider(content);
-        auto lexer        = TextLexer(textProvider);
-        auto parser       = Parser(lexer, allocator.arena(), this);
-        int64_t N         = stream->dictionary->must_find<Integer>("N")->value;
-
-        auto temp = allocator.temporary();
+        auto content = stream->decode(allocator);
+        int64_t N    = stream->dictionary->must_find<Integer>("N")->value;
+        if (static_cast<int64_t>(entry->compressed.indexInStream) >= N) {
+            return {nullptr, {}};
+        }
 
-        // TODO cache objectNumbers and corresponding objects
-        auto objectNumbers = Vector<int64_t>(N, temp);
-        for (int i = 0; i < N; i++) {
-            auto objNum      = parser.parse()->as<Integer>();
-            objectNumbers[i] = objNum->value;
-            // parse the byteOffset as well
-            parser.parse();
+        // only the header is parsed, the object itself is found through its byte offset
+        int64_t objectNumber = 0;
+        int64_t byteOffset   = 0;
+        {
+            auto textProvider = StringTextProvider(content);
+            auto lexer        = TextLexer(textProvider);
+            auto parser       = Parser(lexer, allocator.arena(), this);
+            for (uint64_t i = 0; i <= entry->compressed.indexInStream; i++) {
+                auto objNum = parser.parse();
+                auto offset = parser.parse();
+                if (objNum == nullptr || offset == nullptr || !objNum->is<Integer>() || !offset->is<Integer>()) {
+                    return {nullptr, {}};
+                }
+                objectNumber = objNum->as<Integer>()->value;
+                byteOffset   = offset->as<Integer>()->value;
+            }
         }
 
-        auto objs = Vector<Object *>(N, temp);
-        for (int i = 0; i < N; i++) {
-            auto obj = parser.parse();
-            objs[i]  = obj;
+        auto first = stream->dictionary->must_find<Integer>("First")->value;
+        if (first + byteOffset >= static_cast<int64_t>(content.size())) {
+            return {nullptr, {}};
         }
 
-        auto object = allocator.arena().push<IndirectObject>(objectNumbers[entry->compressed.indexInStream], 0,
-                                                             objs[entry->compressed.indexInStream]);
+        auto textProvider = StringTextProvider(content.substr(first + byteOffset));
+        auto lexer        = TextLexer(textProvider);
+        auto parser       = Parser(lexer, allocator.arena(), this);
+        auto object       = allocator.arena().push<IndirectObject>(objectNumber, 0, parser.parse());
         // TODO the content does not refer to the original PDF document, but instead to a decoded stream
         return {object, content};
     }
     ASSERT(false);
+    return {nullptr, {}};
 }
 
 IndirectObject *Document::get_object(int64_t objectNumber) {
+    // the loaded objects are shared between the threads of parallel_for_each_page
+    auto shared = SharedAllocationScope(allocator);
     if (objectList[objectNumber] != nullptr) {
         return objectList[objectNumber];
     }
 
     auto object              = load_object(objectNumber);
     objectList[objectNumber] = object.first;
+    if (object.first == nullptr) {
+        return nullptr;
+    }
+    add_to_index(object.first);
 
-    // TODO determine whether this obj is from an object stream or not
-    file.metadata.objects[object.first] = {object.second, false};
+    auto entry                          = find_cross_reference_entry(objectNumber);
+    auto isInObjectStream               = entry != nullptr && entry->type == CrossReferenceEntryType::COMPRESSED;
+    file.metadata.objects[object.first] = {
+          .data = object.second, .isInObjectStream = isInObjectStream, .contentHash = content_hash(object.first)};
 
     return object.first;
 }
 
 IndirectObject *Document::resolve(const IndirectReference *ref) {
+    auto shared = SharedAllocationScope(allocator);
     if (currentResolutionObjectNumber == ref->objectNumber) {
         return nullptr;
     }
@@ -119,46 +158,108 @@ IndirectObject *Document::resolve(const IndirectReference *ref) {
     return result;
 }
 
-std::vector<IndirectObject *> Document::objects() {
-    std::vector<IndirectObject *> result = {};
-    for_each_object([&result](IndirectObject *obj) {
-        result.push_back(obj);
-        return ForEachResult::CONTINUE;
-    });
+ObjectRange::ObjectRange(Document &_document) : document(&_document), objectNumberEnd(0) {
+    for (Trailer *t = &document->file.trailer; t != nullptr; t = t->prev) {
+        for (auto &subsection : t->crossReferenceTable.subsections) {
+            objectNumberEnd = std::max(objectNumberEnd, subsection.firstObjectNumber + subsection.objectCount);
+        }
+    }
+}
+
+ObjectRange::Iterator ObjectRange::begin() const {
+    auto result = Iterator{.document = document, .objectNumber = 0, .objectNumberEnd = objectNumberEnd};
+    result.skip_to_next_object();
     return result;
 }
 
-void Document::for_each_object(const std::function<ForEachResult(IndirectObject *)> &func) {
-    // FIXME this does not consider objects from 'Prev'-ious trailers
-    for (int64_t i = 0; i < static_cast<int64_t>(file.trailer.crossReferenceTable.entries.size()); i++) {
-        auto object = get_object(i);
-        if (object == nullptr) {
+ObjectRange::Iterator ObjectRange::end() const {
+    return Iterator{.document = document, .objectNumber = objectNumberEnd, .objectNumberEnd = objectNumberEnd};
+}
+
+size_t ObjectRange::size() const { return document->object_count(false); }
+
+ObjectRange::Iterator &ObjectRange::Iterator::operator++() {
+    objectNumber++;
+    skip_to_next_object();
+    return *this;
+}
+
+ObjectRange::Iterator ObjectRange::Iterator::operator++(int) {
+    auto result = *this;
+    ++*this;
+    return result;
+}
+
+void ObjectRange::Iterator::skip_to_next_object() {
+    for (skip_to_next_subsection(); objectNumber < objectNumberEnd; objectNumber++, skip_to_next_subsection()) {
+        // object numbers without an entry are not passed to get_object, which would register them in the object list
+        if (document->find_cross_reference_entry(objectNumber) == nullptr) {
             continue;
         }
 
-        ForEachResult result = func(object);
-        if (result == ForEachResult::BREAK) {
-            break;
+        object = document->get_object(objectNumber);
+        if (object != nullptr) {
+            return;
         }
     }
+    object = nullptr;
+}
+
+void ObjectRange::Iterator::skip_to_next_subsection() {
+    if (objectNumber < subsectionEnd) {
+        return;
+    }
+
+    // the subsections are neither sorted nor disjoint, the one that starts first (and ends last) wins
+    auto next    = objectNumberEnd;
+    auto nextEnd = objectNumberEnd;
+    for (Trailer *t = &document->file.trailer; t != nullptr; t = t->prev) {
+        auto &table      = t->crossReferenceTable;
+        size_t available = table.entries.size();
+        for (auto &subsection : table.subsections) {
+            // a subsection can't cover more objects than there are entries left in the table
+            const auto objectCount = std::clamp(subsection.objectCount, int64_t(0), static_cast<int64_t>(available));
+            const auto start       = std::max(subsection.firstObjectNumber, objectNumber);
+            const auto end         = subsection.firstObjectNumber + objectCount;
+            available -= static_cast<size_t>(objectCount);
+            if (end <= start || start > next) {
+                continue;
+            }
+            nextEnd = start < next ? end : std::max(nextEnd, end);
+            next    = start;
+        }
+    }
+    objectNumber  = next;
+    subsectionEnd = nextEnd;
+}
+
+void Document::for_each_object(const std::function<ForEachResult(IndirectObject *)> &func) {
+    for_each_object<const std::function<ForEachResult(IndirectObject *)> &>(func);
 }
 
 size_t Document::object_count(const bool parseObjects) {
-    size_t result = 0;
     if (parseObjects) {
+        size_t result = 0;
         for_each_object([&result](IndirectObject *) {
             result++;
             return ForEachResult::CONTINUE;
         });
-    } else {
-        for (auto &entry : file.trailer.crossReferenceTable.entries) {
-            if (entry.type == CrossReferenceEntryType::FREE) {
-                continue;
-            }
-            result++;
+        return result;
+    }
+
+    // the cross reference tables don't change after the document has been read
+    if (crossReferenceObjectCount < 0) {
+        crossReferenceObjectCount = 0;
+        for (Trailer *t = &file.trailer; t != nullptr; t = t->prev) {
+            t->crossReferenceTable.for_each_entry([this](int64_t objectNumber, CrossReferenceEntry &entry) {
+                // an object that is in several tables is counted with the entry of the newest one
+                if (entry.type != CrossReferenceEntryType::FREE && find_cross_reference_entry(objectNumber) == &entry) {
+                    crossReferenceObjectCount++;
+                }
+            });
         }
     }
-    return result;
+    return static_cast<size_t>(crossReferenceObjectCount);
 }
 
 PageTreeNode *PageTreeNode::parent(Document &document) {
@@ -170,28 +271,24 @@ PageTreeNode *PageTreeNode::parent(Document &document) {
 }
 
 void Document::for_each_page(const std::function<ForEachResult(Page *)> &func) {
+    for_each_page<const std::function<ForEachResult(Page *)> &>(func);
+}
+
+const Vector<Page *> &Document::load_pages() {
     if (!cachedPages.empty()) {
-        for (auto page : cachedPages) {
-            ForEachResult result = func(page);
-            if (result == ForEachResult::BREAK) {
-                return;
-            }
-        }
-        return;
+        return cachedPages;
     }
 
     auto c            = catalog();
     auto pageTreeRoot = c->page_tree_root(*this);
     if (pageTreeRoot == nullptr) {
         spdlog::warn("Document did not have any pages");
-        return;
+        return cachedPages;
     }
 
     if (pageTreeRoot->is_page()) {
-        auto page = allocator.arena().push<Page>(*this, pageTreeRoot);
-        cachedPages.push_back(page);
-        func(page);
-        return;
+        cachedPages.push_back(allocator.arena().push<Page>(*this, pageTreeRoot));
+        return cachedPages;
     }
 
     std::vector<PageTreeNode *> queue = {pageTreeRoot};
@@ -199,22 +296,17 @@ void Document::for_each_page(const std::function<ForEachResult(Page *)> &func) {
         PageTreeNode *current = queue.front();
         queue.erase(queue.begin());
 
-        for (auto kid : current->kids()->values) {
+        for (auto &kid : current->kids()->values) {
             auto resolvedKid = get<PageTreeNode>(kid);
             if (!resolvedKid->is_page()) {
                 queue.push_back(resolvedKid);
                 continue;
             }
 
-            auto page = allocator.arena().push<Page>(*this, resolvedKid);
-            cachedPages.push_back(page);
-            ForEachResult result = func(page);
-            if (result == ForEachResult::BREAK) {
-                cachedPages.clear();
-                return;
-            }
+            cachedPages.push_back(allocator.arena().push<Page>(*this, resolvedKid));
         }
     }
+    return cachedPages;
 }
 
 DocumentCatalog *Document::catalog() {
@@ -234,22 +326,76 @@ DocumentCatalog *Document::catalog() {
     return cachedRoot;
 }
 
-std::vector<Page *> Document::pages() {
-    auto result = std::vector<Page *>();
-    for_each_page([&result](auto page) {
-        result.push_back(page);
-        return ForEachResult::CONTINUE;
-    });
-    return result;
+void Document::for_each_page_in_parallel(size_t threadCount, const std::function<void(size_t, Page *)> &func) {
+    // the list of pages is built up front, for_each_page() is not safe to be called from multiple threads
+    auto &allPages = load_pages();
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+    threadCount = std::min(threadCount, allPages.size());
+
+    auto workerArenas = std::vector<WorkerArenas>();
+    for (size_t i = 0; threadCount > 1 && i < threadCount; i++) {
+        auto arenasResult = WorkerArenas::create(allocator);
+        if (arenasResult.has_error()) {
+            spdlog::warn("Processing pages on {} instead of {} threads: {}", i, threadCount, arenasResult.message());
+            break;
+        }
+        workerArenas.push_back(std::move(arenasResult.value()));
+    }
+
+    if (workerArenas.size() <= 1) {
+        for (size_t i = 0; i < allPages.size(); i++) {
+            auto scope = PageScope(*allPages[i]);
+            func(i, allPages[i]);
+        }
+        return;
+    }
+
+    // pages are handed out one at a time, which keeps all threads busy even if some pages take much longer than others
+    auto nextPage = std::atomic<size_t>(0);
+    auto worker   = [&allPages, &func, &nextPage](WorkerArenas &arenas) {
+        auto workerScope = WorkerScope(arenas);
+        for (auto i = nextPage++; i < allPages.size(); i = nextPage++) {
+            auto scope = PageScope(*allPages[i]);
+            func(i, allPages[i]);
+        }
+    };
+    auto threads = std::vector<std::thread>();
+    threads.reserve(workerArenas.size() - 1);
+    for (size_t i = 1; i < workerArenas.size(); i++) {
+        threads.emplace_back(worker, std::ref(workerArenas[i]));
+    }
+    worker(workerArenas[0]);
+    for (auto &thread : threads) {
+        thread.join();
+    }
 }
 
-size_t Document::page_count() {
-    size_t result = 0;
-    for_each_page([&result](auto) {
-        result++;
-        return ForEachResult::CONTINUE;
-    });
-    return result;
+Vector<Page *>::const_iterator PageRange::begin() const { return document->load_pages().begin(); }
+
+Vector<Page *>::const_iterator PageRange::end() const { return document->load_pages().end(); }
+
+size_t PageRange::size() const { return document->load_pages().size(); }
+
+Page *PageRange::operator[](size_t index) const { return document->load_pages()[index]; }
+
+size_t Document::page_count() { return load_pages().size(); }
+
+std::optional<size_t> Document::declared_page_count() {
+    auto pageTreeRoot = catalog()->page_tree_root(*this);
+    if (pageTreeRoot == nullptr) {
+        return {};
+    }
+    if (pageTreeRoot->is_page()) {
+        return 1;
+    }
+
+    auto countOpt = get<Integer>(pageTreeRoot->find<Object>("Count"));
+    if (!countOpt.has_value() || countOpt.value()->value < 0) {
+        return {};
+    }
+    return static_cast<size_t>(countOpt.value()->value);
 }
 
 Result Document::delete_page(size_t pageNum) {
@@ -275,20 +421,11 @@ Result Document::delete_page(size_t pageNum) {
         if (parent->kids()->values.size() == 1) {
             // TODO deal with this case by deleting parent nodes until there are more than one kid
         } else {
-            IndirectObject *o = nullptr;
-            for (auto obj : objectList) {
-                if (obj.second == nullptr) {
-                    continue;
-                }
-                if (page->node == obj.second->object) {
-                    o = obj.second;
-                    break;
-                }
-            }
+            IndirectObject *o = find_existing_object(page->node);
             ASSERT(o != nullptr);
 
             size_t childToDeleteIndex = 0;
-            for (auto kid : parent->kids()->values) {
+            for (auto &kid : parent->kids()->values) {
                 // TODO should the generation number also be compared?
                 if (kid->as<IndirectReference>()->objectNumber == o->objectNumber) {
                     break;
@@ -296,7 +433,13 @@ Result Document::delete_page(size_t pageNum) {
                 childToDeleteIndex++;
             }
             parent->kids()->remove_element(*this, childToDeleteIndex);
-            parent->count()->set(*this, static_cast<int64_t>(parent->kids()->values.size()));
+
+            // /Count is the number of pages below a node
+            for (auto node = parent; node != nullptr; node = node->parent(*this)) {
+                if (auto count = node->count(); count != nullptr) {
+                    count->set(*this, count->value - 1);
+                }
+            }
         }
 
         return ForEachResult::BREAK;
@@ -304,7 +447,7 @@ Result Document::delete_page(size_t pageNum) {
 
     cachedPages.clear();
 
-    // TODO clean up objects that are no longer required
+    // objects that are no longer required are dropped on save with WriteOptions::removeUnusedObjects
 
     return Result::ok();
 }
@@ -332,57 +475,56 @@ size_t Document::word_count() {
     return 0;
 }
 
-size_t Document::character_count() {
-    size_t result = 0;
-    for_each_page([&result](Page *page) {
-        result += page->character_count();
-        return ForEachResult::CONTINUE;
-    });
-    return result;
+size_t Document::character_count(size_t threadCount) {
+    auto counts = parallel_for_each_page(threadCount, [](Page *page) { return page->character_count(); });
+    return std::accumulate(counts.begin(), counts.end(), size_t(0));
 }
 
 void Document::for_each_image(const std::function<ForEachResult(Image &)> &func) {
-    for_each_object([&func](IndirectObject *obj) {
-        if (!obj->object->is<Stream>()) {
-            return ForEachResult::CONTINUE;
-        }
+    for_each_image<const std::function<ForEachResult(Image &)> &>(func);
+}
 
-        const auto stream  = obj->object->as<Stream>();
-        const auto typeOpt = stream->dictionary->find<Name>("Type");
-        if (!typeOpt.has_value() || typeOpt.value()->value != "XObject") {
-            return ForEachResult::CONTINUE;
-        }
+std::optional<Image> Document::as_image(IndirectObject *object) {
+    if (!object->object->is<Stream>()) {
+        return {};
+    }
 
-        const auto subtypeOpt = stream->dictionary->find<Name>("Subtype");
-        if (!subtypeOpt.has_value() || subtypeOpt.value()->value != "Image") {
-            return ForEachResult::CONTINUE;
-        }
+    const auto stream  = object->object->as<Stream>();
+    const auto typeOpt = stream->dictionary->find<Name>("Type");
+    if (!typeOpt.has_value() || typeOpt.value()->value != "XObject") {
+        return {};
+    }
 
-        const auto widthOpt = stream->dictionary->find<Integer>("Width");
-        if (!widthOpt.has_value()) {
-            return ForEachResult::CONTINUE;
-        }
+    const auto subtypeOpt = stream->dictionary->find<Name>("Subtype");
+    if (!subtypeOpt.has_value() || subtypeOpt.value()->value != "Image") {
+        return {};
+    }
 
-        const auto heightOpt = stream->dictionary->find<Integer>("Height");
-        if (!heightOpt.has_value()) {
-            return ForEachResult::CONTINUE;
-        }
+    const auto widthOpt = stream->dictionary->find<Integer>("Width");
+    if (!widthOpt.has_value()) {
+        return {};
+    }
 
-        const auto bitsPerComponentOpt = stream->dictionary->find<Integer>("BitsPerComponent");
-        if (!bitsPerComponentOpt.has_value()) {
-            return ForEachResult::CONTINUE;
-        }
+    const auto heightOpt = stream->dictionary->find<Integer>("Height");
+    if (!heightOpt.has_value()) {
+        return {};
+    }
 
-        auto image             = Image();
-        image.width            = widthOpt.value()->value;
-        image.height           = heightOpt.value()->value;
-        image.bitsPerComponent = bitsPerComponentOpt.value()->value;
-        image.stream           = stream;
-        return func(image);
-    });
+    const auto bitsPerComponentOpt = stream->dictionary->find<Integer>("BitsPerComponent");
+    if (!bitsPerComponentOpt.has_value()) {
+        return {};
+    }
+
+    auto image             = Image();
+    image.width            = widthOpt.value()->value;
+    image.height           = heightOpt.value()->value;
+    image.bitsPerComponent = bitsPerComponentOpt.value()->value;
+    image.stream           = stream;
+    return image;
 }
 
-ValueResult<Stream *> create_embedded_file_stream(Allocator &allocator, const std::string &filePath) {
+ValueResult<Stream *> create_embedded_file_stream(Allocator &allocator, const std::string &filePath,
+                                                  const CompressionOptions &compression) {
     auto is = std::ifstream();
     is.open(filePath, std::ios::in | std::ifstream::ate | std::ios::binary);
 
@@ -403,7 +545,7 @@ ValueResult<Stream *> create_embedded_file_stream(Allocator &allocator, const st
     auto checksumStr   = hash::to_hex_string(checksum);
     auto params        = UnorderedMap<std::string, Object *>(allocator);
     params["Size"]     = allocator.arena().push<Integer>(fileSize);
-    params["CheckSum"] = allocator.arena().push<LiteralString>(checksumStr);
+    params["CheckSum"] = allocator.arena().push<HexadecimalString>(checksumStr);
     // TODO add CreationDate
     // TODO add ModDate
 
@@ -412,12 +554,13 @@ ValueResult<Stream *> create_embedded_file_stream(Allocator &allocator, const st
     // dict["SubType"] = MIME type; // TODO parse MIME type and add as SubType
     dict["Params"] = allocator.arena().push<Dictionary>(params);
 
-    auto result = Stream::create_from_unencoded_data(allocator, dict, std::string_view((char *)fileData, fileSize));
+    auto result = Stream::create_from_unencoded_data(allocator, dict, std::string_view((char *)fileData, fileSize),
+                                                     compression);
     return ValueResult<Stream *>::ok(result);
 }
 
 Result Document::embed_file(const std::string &filePath) {
-    auto result = create_embedded_file_stream(allocator, filePath);
+    auto result = create_embedded_file_stream(allocator, filePath, compression);
     if (result.has_error()) {
         return result.drop_value();
     }
@@ -430,41 +573,250 @@ Result Document::embed_file(const std::string &filePath) {
 int64_t Document::add_object(Object *object) {
     auto objectNumber        = next_object_number();
     objectList[objectNumber] = allocator.arena().push<IndirectObject>(objectNumber, 0, object);
+    add_to_index(objectList[objectNumber]);
     return objectNumber;
 }
 
 int64_t Document::next_object_number() const { return objectList.size(); }
 
+/// Checks whether needle is part of haystack, without following indirect references
+static bool contains_object(Object *haystack, Object *needle) {
+    if (haystack == needle) {
+        return true;
+    }
+
+    switch (haystack->type) {
+    case Object::Type::ARRAY:
+        for (auto &value : haystack->as<Array>()->values) {
+            if (contains_object(value, needle)) {
+                return true;
+            }
+        }
+        return false;
+    case Object::Type::DICTIONARY:
+        for (auto &entry : haystack->as<Dictionary>()->values) {
+            if (contains_object(entry.second, needle)) {
+                return true;
+            }
+        }
+        return false;
+    case Object::Type::STREAM:
+        return contains_object(haystack->as<Stream>()->dictionary, needle);
+    default:
+        return false;
+    }
+}
+
 IndirectObject *Document::find_existing_object(Object *object) {
+    auto itr = owners.find(object);
+    if (itr != owners.end()) {
+        return itr->second;
+    }
+
+    // objects that have been inserted into a loaded object after it was indexed are not known yet
     for (auto &entry : objectList) {
-        if (entry.second->object == object) {
+        if (entry.second != nullptr && contains_object(entry.second->object, object)) {
+            add_to_index(entry.second);
             return entry.second;
         }
     }
     return nullptr;
 }
 
-void Document::for_each_embedded_file(const std::function<ForEachResult(EmbeddedFile *)> &func) {
-    // TODO iterate file specifications instead and pass file name and EmbeddedFile to func
+void Document::for_each_referrer(int64_t objectNumber, const std::function<ForEachResult(IndirectObject *)> &func) {
+    auto itr = referrers.find(static_cast<uint64_t>(objectNumber));
+    if (itr == referrers.end()) {
+        return;
+    }
 
-    for_each_object([&func](pdf::IndirectObject *obj) {
-        if (!obj->object->is<Stream>()) {
-            return ForEachResult::CONTINUE;
+    for (auto referrer : itr->second) {
+        if (func(referrer) == ForEachResult::BREAK) {
+            break;
         }
+    }
+}
 
-        const auto stream   = obj->object->as<Stream>();
-        const auto dictType = stream->dictionary->find<Name>("Type");
-        if (!dictType.has_value()) {
-            return ForEachResult::CONTINUE;
+/// Calls func with the object and everything nested inside of it (without following indirect references), except for
+/// the objects inside of skip. Inline values are left out, since their addresses change when their container changes.
+template <typename Func>
+static void for_each_indexed_object(Object *object, Object *skip, TemporaryAllocator &temp, Func func) {
+    auto worklist = Vector<Object *>(temp);
+    worklist.push_back(object);
+    while (!worklist.empty()) {
+        auto current = worklist.back();
+        worklist.pop_back();
+        if (current == nullptr || current == skip) {
+            continue;
         }
-        if (dictType.value()->value != "EmbeddedFile") {
-            return ForEachResult::CONTINUE;
+        func(current);
+
+        switch (current->type) {
+        case Object::Type::ARRAY:
+            for (auto &value : current->as<Array>()->values) {
+                if (!value.is_inline()) {
+                    worklist.push_back(value);
+                }
+            }
+            break;
+        case Object::Type::DICTIONARY:
+            for (auto &entry : current->as<Dictionary>()->values) {
+                if (!entry.second.is_inline()) {
+                    worklist.push_back(entry.second);
+                }
+            }
+            break;
+        case Object::Type::STREAM:
+            worklist.push_back(current->as<Stream>()->dictionary);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void Document::add_to_index(IndirectObject *object) {
+    auto temp = allocator.temporary();
+    for_each_indexed_object(object->object, nullptr, temp, [this, object](Object *current) {
+        owners[current] = object;
+        if (!current->is<IndirectReference>()) {
+            return;
+        }
+
+        auto objectNumber = static_cast<uint64_t>(current->as<IndirectReference>()->objectNumber);
+        auto &list        = referrers.try_emplace(objectNumber, allocator).first->second;
+        if (std::find(list.begin(), list.end(), object) == list.end()) {
+            list.push_back(object);
         }
+    });
+}
 
-        func(stream->as<EmbeddedFile>());
+void Document::remove_from_index(Object *object) {
+    auto ownerItr = owners.find(object);
+    if (ownerItr == owners.end()) {
+        // inline values are not indexed, they can't contain references either
+        return;
+    }
+
+    auto owner          = ownerItr->second;
+    auto temp           = allocator.temporary();
+    auto removedNumbers = UnorderedSet<uint64_t>(temp);
+    for_each_indexed_object(object, nullptr, temp, [this, &removedNumbers](Object *current) {
+        owners.erase(current);
+        if (current->is<IndirectReference>()) {
+            removedNumbers.insert(static_cast<uint64_t>(current->as<IndirectReference>()->objectNumber));
+        }
+    });
 
-        return ForEachResult::CONTINUE;
+    // the owner might still refer to some of the removed object numbers from somewhere else
+    for_each_indexed_object(owner->object, object, temp, [&removedNumbers](Object *current) {
+        if (current->is<IndirectReference>()) {
+            removedNumbers.erase(static_cast<uint64_t>(current->as<IndirectReference>()->objectNumber));
+        }
     });
+
+    for (auto objectNumber : removedNumbers) {
+        auto referrerItr = referrers.find(objectNumber);
+        if (referrerItr != referrers.end()) {
+            auto &list = referrerItr->second;
+            list.erase(std::remove(list.begin(), list.end(), owner), list.end());
+        }
+    }
+}
+
+void Document::mark_dirty(Object *object) {
+    IndirectObject *owner = nullptr;
+    if (object->is<IndirectObject>()) {
+        owner = object->as<IndirectObject>();
+    } else {
+        owner = find_existing_object(object);
+    }
+
+    if (owner == nullptr) {
+        // the object is not part of the document yet, it is going to be serialized anyway
+        return;
+    }
+
+    auto itr = file.metadata.objects.find(owner);
+    if (itr != file.metadata.objects.end()) {
+        itr->second.isDirty = true;
+    }
+}
+
+bool Document::is_dirty(IndirectObject *object) const {
+    auto itr = file.metadata.objects.find(object);
+    if (itr == file.metadata.objects.end()) {
+        // objects without metadata have been added after the document was read
+        return true;
+    }
+    return itr->second.isDirty || itr->second.contentHash != content_hash(object);
+}
+
+UnorderedSet<uint64_t> Document::find_reachable_objects(TemporaryAllocator &allocator) {
+    auto result   = UnorderedSet<uint64_t>(allocator);
+    auto worklist = Vector<Object *>(allocator);
+    if (file.trailer.dict != nullptr) {
+        worklist.push_back(file.trailer.dict);
+    } else if (file.trailer.streamObject != nullptr) {
+        worklist.push_back(file.trailer.streamObject->object->as<Stream>()->dictionary);
+    }
+
+    // the objects are traversed with an explicit worklist instead of recursion, so that deep object graphs (e.g. long
+    // chains of outline items) cannot overflow the stack
+    while (!worklist.empty()) {
+        auto object = worklist.back();
+        worklist.pop_back();
+
+        switch (object->type) {
+        case Object::Type::ARRAY:
+            for (auto &value : object->as<Array>()->values) {
+                worklist.push_back(value);
+            }
+            break;
+        case Object::Type::DICTIONARY:
+            for (auto &entry : object->as<Dictionary>()->values) {
+                worklist.push_back(entry.second);
+            }
+            break;
+        case Object::Type::STREAM:
+            worklist.push_back(object->as<Stream>()->dictionary);
+            break;
+        case Object::Type::INDIRECT_OBJECT:
+            worklist.push_back(object->as<IndirectObject>()->object);
+            break;
+        case Object::Type::INDIRECT_REFERENCE: {
+            auto objectNumber = object->as<IndirectReference>()->objectNumber;
+            if (objectNumber < 0 || !result.insert(static_cast<uint64_t>(objectNumber)).second) {
+                break;
+            }
+
+            auto referencedObject = get_object(objectNumber);
+            if (referencedObject != nullptr) {
+                worklist.push_back(referencedObject->object);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return result;
+}
+
+void Document::for_each_embedded_file(const std::function<ForEachResult(EmbeddedFile *)> &func) {
+    for_each_embedded_file<const std::function<ForEachResult(EmbeddedFile *)> &>(func);
+}
+
+EmbeddedFile *Document::as_embedded_file(IndirectObject *object) {
+    if (!object->object->is<Stream>()) {
+        return nullptr;
+    }
+
+    const auto stream   = object->object->as<Stream>();
+    const auto dictType = stream->dictionary->find<Name>("Type");
+    if (!dictType.has_value() || dictType.value()->value != "EmbeddedFile") {
+        return nullptr;
+    }
+    return stream->as<EmbeddedFile>();
 }
 
 } // namespace pdf
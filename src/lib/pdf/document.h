@@ -1,12 +1,16 @@
 #pragma once
 
 #include <functional>
+#include <iterator>
 #include <stddef.h>
+#include <type_traits>
 #include <unordered_set>
+#include <vector>
 
 #include "pdf/font.h"
 #include "pdf/image.h"
 #include "pdf/memory/arena_allocator.h"
+#include "pdf/memory/arena_vector.h"
 #include "pdf/memory/stl_allocator.h"
 #include "pdf/objects.h"
 #include "pdf/parser.h"
@@ -57,12 +61,30 @@ struct CrossReferenceEntry {
     };
 };
 
-struct CrossReferenceTable {
+struct CrossReferenceSubsection {
     int64_t firstObjectNumber = 0;
     int64_t objectCount       = 0;
-    Vector<CrossReferenceEntry> entries;
+};
 
-    CrossReferenceTable(Allocator &allocator) : entries(StlAllocator<CrossReferenceEntry>(allocator)) {}
+struct CrossReferenceTable {
+    Vector<CrossReferenceSubsection> subsections;
+    /// entries of all subsections, in the same order as the subsections
+    ArenaVector<CrossReferenceEntry> entries;
+
+    CrossReferenceTable(Allocator &allocator)
+        : subsections(StlAllocator<CrossReferenceSubsection>(allocator)), entries(allocator) {}
+
+    /// Returns the entry for the given object number, or nullptr if this table does not contain the object
+    CrossReferenceEntry *find(int64_t objectNumber);
+    /// Calls func with the object number and the entry of every entry in this table
+    template <typename Func> void for_each_entry(Func func) {
+        size_t index = 0;
+        for (auto &subsection : subsections) {
+            for (int64_t i = 0; i < subsection.objectCount && index < entries.size(); i++) {
+                func(subsection.firstObjectNumber + i, entries[index++]);
+            }
+        }
+    }
 };
 
 struct Trailer {
@@ -77,6 +99,10 @@ struct Trailer {
 struct ObjectMetadata {
     std::string_view data = {};
     bool isInObjectStream = false;
+    /// the object has been modified since it was read, which means that data no longer reflects its content
+    bool isDirty = false;
+    /// content_hash() of the object right after it was read, it catches modifications that have not been marked
+    uint64_t contentHash = 0;
 };
 
 struct DocumentFileMetadata {
@@ -115,11 +141,104 @@ struct ReadMetadata {
     ReadMetadata(Allocator &allocator) : trailers(allocator), objects(allocator) {}
 };
 
+const size_t OBJECT_STREAM_SIZE = 100;
+
+struct WriteOptions {
+    /// streams that have been compressed with a lower level than this are compressed again before they are written
+    CompressionOptions compression = CompressionOptions::best();
+    /// keeps the original file as it is and only appends the new and modified objects together with a new cross
+    /// reference section (a table or a stream, depending on what the original file uses)
+    /// writing to the file the document has been read from appends to it in place, after that the document has to be
+    /// read again before it can be saved incrementally another time
+    bool incremental = false;
+    /// number of threads that serialize objects (0 uses one thread per hardware thread), the output is the same
+    /// regardless of the number of threads
+    size_t threadCount = 1;
+    /// packs all objects except for streams into compressed object streams and writes a cross reference stream instead
+    /// of a cross reference table (PDF 1.5), this is not used for incremental updates
+    bool useObjectStreams = false;
+    /// maximum number of objects in one object stream
+    size_t objectStreamSize = OBJECT_STREAM_SIZE;
+    /// drops all objects that cannot be reached from the trailer (e.g. the content of deleted pages), this loads every
+    /// reachable object and is not used for incremental updates
+    bool removeUnusedObjects = false;
+    /// merges objects that have the same content (e.g. a font program or an image that has been embedded multiple
+    /// times) and makes all references point to the remaining object, this is not used for incremental updates
+    bool deduplicateObjects = false;
+    /// assigns consecutive object numbers (starting at 1) to the written objects, which means that every object has
+    /// to be serialized again instead of being copied from the original file
+    bool renumberObjects = false;
+};
+
+/// Lazy range over the objects in the cross reference tables of a document, in the order of their object numbers. The
+/// objects are loaded while iterating, objects that fail to load are skipped. Nothing else is allocated.
+struct ObjectRange {
+    struct Iterator {
+        using iterator_category = std::input_iterator_tag;
+        using value_type        = IndirectObject *;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = IndirectObject **;
+        using reference         = IndirectObject *;
+
+        Document *document      = nullptr;
+        int64_t objectNumber    = 0;
+        int64_t objectNumberEnd = 0;
+        /// the object numbers from objectNumber up to here are covered by a subsection of a cross reference table
+        int64_t subsectionEnd  = 0;
+        IndirectObject *object = nullptr;
+
+        IndirectObject *operator*() const { return object; }
+        Iterator &operator++();
+        Iterator operator++(int);
+        bool operator==(const Iterator &other) const { return objectNumber == other.objectNumber; }
+
+        /// moves to the first object that can be loaded, starting at objectNumber
+        void skip_to_next_object();
+        /// moves to the first object number that has an entry in a cross reference table, starting at objectNumber,
+        /// the gaps between the subsections are skipped without looking at every object number in them
+        void skip_to_next_subsection();
+    };
+
+    explicit ObjectRange(Document &_document);
+
+    [[nodiscard]] Iterator begin() const;
+    [[nodiscard]] Iterator end() const;
+    /// number of objects that are in use according to the cross reference tables, without loading them (O(1) after the
+    /// first call), this only differs from the number of iterated objects if some of them fail to load
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] bool empty() const { return begin() == end(); }
+
+  private:
+    Document *document;
+    /// one past the highest object number in the cross reference tables
+    int64_t objectNumberEnd;
+};
+
+/// Range over the pages of a document. The page tree is walked once, when the pages are accessed for the first time, and
+/// the pages are kept by the document.
+struct PageRange {
+    explicit PageRange(Document &_document) : document(&_document) {}
+
+    [[nodiscard]] Vector<Page *>::const_iterator begin() const;
+    [[nodiscard]] Vector<Page *>::const_iterator end() const;
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] bool empty() const { return size() == 0; }
+    Page *operator[](size_t index) const;
+
+  private:
+    Document *document;
+};
+
 struct Document : public ReferenceResolver {
     Allocator &allocator;
     DocumentFile file;
     UnorderedMap<uint64_t, IndirectObject *> objectList;
 
+    /// compression policy for new streams and for saving the document
+    CompressionOptions compression = CompressionOptions::best();
+    /// compression policy for interactive edits (e.g. moving an element around), which trades size for latency
+    CompressionOptions editCompression = CompressionOptions::fast();
+
     virtual ~Document() = default;
 
     template <typename T> T *get(Object *object) {
@@ -135,6 +254,7 @@ struct Document : public ReferenceResolver {
         }
         ASSERT(false);
     }
+    template <typename T> T *get(const Value &value) { return get<T>(value.get()); }
     template <typename T> std::optional<T *> get(std::optional<Object *> object) {
         if (object.has_value()) {
             return get<T>(object.value());
@@ -146,36 +266,91 @@ struct Document : public ReferenceResolver {
 
     /// The document catalog of this document
     DocumentCatalog *catalog();
-    /// List of pages
-    std::vector<Page *> pages();
+    /// Pages of the document
+    PageRange pages() { return PageRange(*this); }
     /// Iterates over all pages in the document
     void for_each_page(const std::function<ForEachResult(Page *)> &func);
-    /// List of objects
-    std::vector<IndirectObject *> objects();
+    /// Same as above, but func is called directly (and can be inlined) instead of through a std::function
+    template <typename Func> void for_each_page(Func &&func) {
+        for (auto page : load_pages()) {
+            if (func(page) == ForEachResult::BREAK) {
+                break;
+            }
+        }
+    }
+    /// Calls func for every page on threadCount threads (0 uses one thread per hardware thread) and returns the results
+    /// in the order of the pages. Every page is processed inside of a PageScope, which means that the results have to
+    /// be copied out of the page. Objects are loaded and streams are decoded safely from all threads, but func must not
+    /// modify the document.
+    template <typename Func> auto parallel_for_each_page(size_t threadCount, Func func) {
+        using PageResult = std::invoke_result_t<Func, Page *>;
+        static_assert(!std::is_same_v<PageResult, bool>, "std::vector<bool> can't be written from multiple threads");
+
+        auto results = std::vector<PageResult>(load_pages().size());
+        for_each_page_in_parallel(threadCount, [&results, &func](size_t pageIndex, Page *page) {
+            results[pageIndex] = func(page);
+        });
+        return results;
+    }
+    /// Objects of the document, they are loaded lazily while iterating over the range
+    ObjectRange objects() { return ObjectRange(*this); }
     /// Iterates over all objects in the document
     void for_each_object(const std::function<ForEachResult(IndirectObject *)> &func);
+    /// Same as above, but func is called directly (and can be inlined) instead of through a std::function
+    template <typename Func> void for_each_object(Func &&func) {
+        for (auto object : objects()) {
+            if (func(object) == ForEachResult::BREAK) {
+                break;
+            }
+        }
+    }
 
-    /// Number of indirect objects
+    /// Number of indirect objects, either the objects that can be loaded or (without loading them) the ones that are in
+    /// use according to the cross reference tables
     size_t object_count(bool parseObjects = true);
     /// Number of pages
     size_t page_count();
+    /// Number of pages according to /Count of the page tree root, without walking the page tree. This is only
+    /// informational, the value comes straight from the file and might be wrong.
+    std::optional<size_t> declared_page_count();
     /// Number of lines
     size_t line_count();
     /// Number of words
     size_t word_count();
-    /// Number of characters
-    size_t character_count();
+    /// Number of characters, counted on threadCount threads (0 uses one thread per hardware thread)
+    size_t character_count(size_t threadCount = 1);
 
     /// Iterates over all images in the document
     void for_each_image(const std::function<ForEachResult(Image &)> &func);
+    template <typename Func> void for_each_image(Func &&func) {
+        for_each_object([&func](IndirectObject *object) {
+            auto image = as_image(object);
+            if (!image.has_value()) {
+                return ForEachResult::CONTINUE;
+            }
+            return func(image.value());
+        });
+    }
     /// Iterates over all embedded files in the document
     void for_each_embedded_file(const std::function<ForEachResult(EmbeddedFile *)> &func);
+    template <typename Func> void for_each_embedded_file(Func &&func) {
+        // TODO iterate file specifications instead and pass file name and EmbeddedFile to func
+        for_each_object([&func](IndirectObject *object) {
+            auto embeddedFile = as_embedded_file(object);
+            if (embeddedFile == nullptr) {
+                return ForEachResult::CONTINUE;
+            }
+            return func(embeddedFile);
+        });
+    }
 
-    /// Writes the PDF-document to the given filePath
+    /// Writes the PDF-document to the given filePath, using the compression policy of the document
     [[nodiscard]] Result write_to_file(const std::string &filePath);
-    /// Writes the PDF-document to a newly allocated buffer
-    /// TODO think about who owns the memory
+    [[nodiscard]] Result write_to_file(const std::string &filePath, const WriteOptions &options);
+    /// Writes the PDF-document to a newly allocated buffer, using the compression policy of the document
+    /// The caller takes ownership of the buffer and has to release it with free()
     [[nodiscard]] Result write_to_memory(uint8_t *&buffer, size_t &size);
+    [[nodiscard]] Result write_to_memory(uint8_t *&buffer, size_t &size, const WriteOptions &options);
     /// Reads the PDF-document specified by the given filePath
     static ValueResult<Document> read_from_file(Allocator &allocator, const std::string &filePath,
                                                 bool loadAllObjects = false);
@@ -193,19 +368,55 @@ struct Document : public ReferenceResolver {
     int64_t next_object_number() const;
     int64_t add_object(Object *object);
 
-    // Finds the IndirectObject that wraps the given Object
+    /// Finds the IndirectObject that contains the given Object (directly or nested inside of arrays and dictionaries),
+    /// inline values are not indexed and have to be searched for
     IndirectObject *find_existing_object(Object *object);
+    /// Calls func with every loaded object that contains a reference to the given object number
+    void for_each_referrer(int64_t objectNumber, const std::function<ForEachResult(IndirectObject *)> &func);
+    /// Adds the object and everything it contains to the owner and referrer index, this happens whenever an object is
+    /// loaded or added to the document
+    void add_to_index(IndirectObject *object);
+    /// Removes an Object from the index, this has to happen right before it is taken out of its IndirectObject
+    void remove_from_index(Object *object);
+    /// Marks the IndirectObject that contains the given Object as modified, so that it is serialized again on save.
+    /// Objects that have been modified without being marked are found by comparing their content_hash() on save.
+    void mark_dirty(Object *object);
+    /// Returns true if the given object has been modified or added since the document was read, either because it has
+    /// been marked or because its content differs from what was read
+    bool is_dirty(IndirectObject *object) const;
+
+    /// Finds the most recent cross reference entry for the given object number
+    CrossReferenceEntry *find_cross_reference_entry(int64_t objectNumber);
+    /// Returns the object with the given object number, loading it from the file if necessary
+    IndirectObject *get_object(int64_t objectNumber);
+    /// Object numbers of all objects that can be reached from the trailer, following indirect references
+    UnorderedSet<uint64_t> find_reachable_objects(TemporaryAllocator &allocator);
 
   private:
+    friend PageRange;
+
     int64_t currentResolutionObjectNumber = 0;
     DocumentCatalog *cachedRoot           = nullptr;
     Vector<Page *> cachedPages;
+    /// number of objects that are in use according to the cross reference tables, -1 if it has not been counted yet
+    int64_t crossReferenceObjectCount = -1;
+    /// IndirectObject that contains an Object, for all loaded objects except for inline values (see Value)
+    UnorderedMap<Object *, IndirectObject *> owners;
+    /// loaded objects that refer to an object number
+    UnorderedMap<uint64_t, Vector<IndirectObject *>> referrers;
 
     Document(Allocator &allocator_)
-        : allocator(allocator_), file(allocator), objectList(allocator), cachedPages(allocator) {}
+        : allocator(allocator_), file(allocator), objectList(allocator), cachedPages(allocator), owners(allocator),
+          referrers(allocator) {}
 
-    IndirectObject *get_object(int64_t objectNumber);
     [[nodiscard]] std::pair<IndirectObject *, std::string_view> load_object(int64_t objectNumber);
+    /// walks the page tree on the first call, the pages are kept until the page tree is modified
+    const Vector<Page *> &load_pages();
+    /// the image XObject in the given object, if there is one
+    static std::optional<Image> as_image(IndirectObject *object);
+    /// the embedded file in the given object or nullptr
+    static EmbeddedFile *as_embedded_file(IndirectObject *object);
+    void for_each_page_in_parallel(size_t threadCount, const std::function<void(size_t, Page *)> &func);
 };
 
 } // namespace pdf
@@ -1,5 +1,6 @@
 #include "document.h"
 
+#include <charconv>
 #include <fstream>
 #include <spdlog/spdlog.h>
 #include <sstream>
@@ -78,37 +79,39 @@ Result read_cross_reference_stream(Document &document, IndirectObject *streamObj
     auto sizeField2 = W->values[2]->as<Integer>()->value;
     auto content    = stream->decode(document.allocator);
 
-    // verify that the content of the stream matches the size in the dictionary
-    size_t countInDict        = stream->dictionary->must_find<Integer>("Size")->value - 1;
-    size_t crossRefEntryCount = content.size() / (sizeField0 + sizeField1 + sizeField2);
-    if (countInDict != crossRefEntryCount) {
-        spdlog::warn(
-              "Cross reference stream has mismatched entry counts: {} (count in dictionary) vs {} (actual count)",
-              countInDict, crossRefEntryCount);
-    }
-
+    auto &crt     = currentTrailer->crossReferenceTable;
     auto indexOpt = stream->dictionary->find<Array>("Index");
     if (indexOpt.has_value()) {
         auto index = indexOpt.value();
-        if (index->values.size() == 2) {
-            currentTrailer->crossReferenceTable.firstObjectNumber = index->values[0]->as<Integer>()->value;
-            // TODO the second value is the number of entries and not necessarily the number of objects
-            currentTrailer->crossReferenceTable.objectCount = index->values[1]->as<Integer>()->value;
-        } else {
-            // TODO streams can define subsections of entries
-            spdlog::warn("Stream subsections are not implemented yet");
+        if (index->values.size() % 2 != 0) {
+            return Result::error("Index of cross reference stream has to consist of pairs of integers");
+        }
+        for (size_t i = 0; i < index->values.size(); i += 2) {
+            crt.subsections.push_back({.firstObjectNumber = index->values[i]->as<Integer>()->value,
+                                       .objectCount       = index->values[i + 1]->as<Integer>()->value});
         }
     } else {
-        currentTrailer->crossReferenceTable.firstObjectNumber = 0;
-        currentTrailer->crossReferenceTable.objectCount       = static_cast<int64_t>(countInDict);
+        crt.subsections.push_back({.firstObjectNumber = 0,
+                                   .objectCount       = stream->dictionary->must_find<Integer>("Size")->value});
     }
 
-    if (currentTrailer->crossReferenceTable.objectCount < 0) {
-        return Result::error("Object count in cross reference table cannot be negative");
+    int64_t countInIndex = 0;
+    for (auto &subsection : crt.subsections) {
+        if (subsection.objectCount < 0) {
+            return Result::error("Object count in cross reference table cannot be negative");
+        }
+        countInIndex += subsection.objectCount;
     }
-    if (currentTrailer->crossReferenceTable.objectCount > 1000000) {
-        return Result::error("Too many objects in cross reference table: {}",
-                             currentTrailer->crossReferenceTable.objectCount);
+    if (countInIndex > 1000000) {
+        return Result::error("Too many objects in cross reference table: {}", countInIndex);
+    }
+
+    // verify that the content of the stream matches the size in the dictionary
+    auto crossRefEntryCount = static_cast<int64_t>(content.size() / (sizeField0 + sizeField1 + sizeField2));
+    if (countInIndex != crossRefEntryCount) {
+        spdlog::warn(
+              "Cross reference stream has mismatched entry counts: {} (count in dictionary) vs {} (actual count)",
+              countInIndex, crossRefEntryCount);
     }
 
     auto unknownEntryCount = 0;
@@ -158,11 +161,16 @@ Result read_cross_reference_stream(Document &document, IndirectObject *streamObj
             unknownEntryCount++;
             break;
         }
-        currentTrailer->crossReferenceTable.entries.push_back(entry);
+        crt.entries.push_back(entry);
     }
 
     spdlog::warn("Encountered {} unknown cross reference stream entries", unknownEntryCount);
 
+    // register the objects without loading them (same as for cross reference tables)
+    crt.for_each_entry([&document](int64_t objectNumber, CrossReferenceEntry &) {
+        document.objectList.try_emplace(objectNumber, nullptr);
+    });
+
     auto opt = stream->dictionary->find<Integer>("Prev");
     if (!opt.has_value()) {
         return Result::ok();
@@ -200,95 +208,101 @@ Result read_trailers(Document &document, uint8_t *crossRefStartPtr, Trailer *cur
     }
 
     //  table -> parse table and parse trailer dict
-    auto crossRefPtr = crossRefStartPtr + 4;
-    ignoreNewLines(crossRefPtr);
+    auto &crt           = currentTrailer->crossReferenceTable;
+    auto currentReadPtr = crossRefStartPtr + 4;
+    ignoreNewLines(currentReadPtr);
 
-    int64_t spaceLocation   = -1;
-    uint8_t *currentReadPtr = crossRefPtr;
-    while (*currentReadPtr != '\n' && *currentReadPtr != '\r') {
-        if (*currentReadPtr == ' ') {
-            spaceLocation = currentReadPtr - crossRefPtr;
+    // the table consists of one or more subsections, each starting with a line "<first object number> <count>"
+    int64_t totalObjectCount = 0;
+    while (!document.file.is_out_of_range(currentReadPtr, 7) &&
+           std::string_view((char *)currentReadPtr, 7) != "trailer") {
+        auto lineStart = currentReadPtr;
+        while (*currentReadPtr != '\n' && *currentReadPtr != '\r') {
+            currentReadPtr++;
+            if (document.file.is_out_of_range(currentReadPtr)) {
+                return Result::error("Unexpectedly reached end of file");
+            }
         }
-        currentReadPtr++;
-    }
 
-    auto metaData = std::string((char *)crossRefPtr, currentReadPtr - crossRefPtr);
-    // TODO parse other cross-reference sections
+        auto metaData      = std::string_view((char *)lineStart, currentReadPtr - lineStart);
+        auto spaceLocation = metaData.find(' ');
+        if (spaceLocation == std::string_view::npos) {
+            return Result::error("Failed to parse cross reference subsection header: '{}'", metaData);
+        }
 
-    try {
-        currentTrailer->crossReferenceTable.firstObjectNumber = std::stoll(metaData.substr(0, spaceLocation));
-    } catch (std::invalid_argument &err) {
-        return Result::error("Failed to parse first object number of cross reference table (std::invalid_argument): {}",
-                             err.what());
-    } catch (std::out_of_range &err) {
-        return Result::error("Failed to parse first object number of cross reference table (std::out_of_range): {}",
-                             err.what());
-    }
+        auto subsection       = CrossReferenceSubsection();
+        auto firstNumberStart = metaData.data();
+        auto firstNumberEnd   = metaData.data() + spaceLocation;
+        if (std::from_chars(firstNumberStart, firstNumberEnd, subsection.firstObjectNumber).ec != std::errc()) {
+            return Result::error("Failed to parse first object number of cross reference table: '{}'", metaData);
+        }
 
-    try {
-        currentTrailer->crossReferenceTable.objectCount = std::stoll(metaData.substr(spaceLocation));
-    } catch (std::invalid_argument &err) {
-        return Result::error("Failed to parse object count of cross reference table (std::invalid_argument): {}",
-                             err.what());
-    } catch (std::out_of_range &err) {
-        return Result::error("Failed to parse object count of cross reference table (std::out_of_range): {}",
-                             err.what());
-    }
+        auto countLocation = metaData.find_first_not_of(' ', spaceLocation);
+        if (countLocation == std::string_view::npos ||
+            std::from_chars(metaData.data() + countLocation, metaData.data() + metaData.size(), subsection.objectCount)
+                        .ec != std::errc()) {
+            return Result::error("Failed to parse object count of cross reference table: '{}'", metaData);
+        }
 
-    if (currentTrailer->crossReferenceTable.objectCount < 0) {
-        return Result::error("Object count in cross reference table cannot be negative");
-    }
-    if (currentTrailer->crossReferenceTable.objectCount > 1000000) {
-        return Result::error("Too many objects in cross reference table: {}",
-                             currentTrailer->crossReferenceTable.objectCount);
-    }
+        if (subsection.objectCount < 0) {
+            return Result::error("Object count in cross reference table cannot be negative");
+        }
+        totalObjectCount += subsection.objectCount;
+        if (totalObjectCount > 1000000) {
+            return Result::error("Too many objects in cross reference table: {}", totalObjectCount);
+        }
 
-    for (int64_t objectNumber = currentTrailer->crossReferenceTable.firstObjectNumber;
-         objectNumber <
-         currentTrailer->crossReferenceTable.firstObjectNumber + currentTrailer->crossReferenceTable.objectCount;
-         objectNumber++) {
-        document.objectList[objectNumber] = nullptr;
-    }
+        for (int64_t objectNumber = subsection.firstObjectNumber;
+             objectNumber < subsection.firstObjectNumber + subsection.objectCount; objectNumber++) {
+            document.objectList.try_emplace(objectNumber, nullptr);
+        }
+        crt.subsections.push_back(subsection);
 
-    ignoreNewLines(currentReadPtr);
+        ignoreNewLines(currentReadPtr);
 
-    for (int i = 0; i < currentTrailer->crossReferenceTable.objectCount; i++) {
-        if (document.file.is_out_of_range(currentReadPtr, 20)) {
-            return Result::error("Invalid cross reference table");
-        }
+        for (int i = 0; i < subsection.objectCount; i++) {
+            if (document.file.is_out_of_range(currentReadPtr, 20)) {
+                return Result::error("Invalid cross reference table");
+            }
 
-        // nnnnnnnnnn ggggg f__
-        auto s = std::string((char *)currentReadPtr, 20);
+            // nnnnnnnnnn ggggg f__
+            auto s = std::string((char *)currentReadPtr, 20);
+
+            // TODO improve error messages (switch on entry type and add separate try/catch for each num)
+            uint64_t num0, num1;
+            try {
+                num0 = std::stoll(s.substr(0, 10));
+                num1 = std::stoll(s.substr(11, 16));
+            } catch (std::invalid_argument &err) {
+                return Result::error("Failed to parse number in cross reference table (std::invalid_argument): {}",
+                                     err.what());
+            } catch (std::out_of_range &err) {
+                return Result::error("Failed to parse number in cross reference table (std::out_of_range): {}",
+                                     err.what());
+            }
 
-        // TODO improve error messages (switch on entry type and add separate try/catch for each num)
-        uint64_t num0, num1;
-        try {
-            num0 = std::stoll(s.substr(0, 10));
-            num1 = std::stoll(s.substr(11, 16));
-        } catch (std::invalid_argument &err) {
-            return Result::error("Failed to parse number in cross reference table (std::invalid_argument): {}",
-                                 err.what());
-        } catch (std::out_of_range &err) {
-            return Result::error("Failed to parse number in cross reference table (std::out_of_range): {}", err.what());
-        }
+            CrossReferenceEntry entry = {};
+            if (s[17] == 'f') {
+                entry.type                                = CrossReferenceEntryType ::FREE;
+                entry.free.nextFreeObjectNumber           = num0;
+                entry.free.nextFreeObjectGenerationNumber = num1;
+            } else {
+                entry.type                    = CrossReferenceEntryType::NORMAL;
+                entry.normal.byteOffset       = num0;
+                entry.normal.generationNumber = num1;
+            }
 
-        CrossReferenceEntry entry = {};
-        if (s[17] == 'f') {
-            entry.type                                = CrossReferenceEntryType ::FREE;
-            entry.free.nextFreeObjectNumber           = num0;
-            entry.free.nextFreeObjectGenerationNumber = num1;
-        } else {
-            entry.type                    = CrossReferenceEntryType::NORMAL;
-            entry.normal.byteOffset       = num0;
-            entry.normal.generationNumber = num1;
+            crt.entries.push_back(entry);
+            currentReadPtr += 20;
         }
 
-        currentTrailer->crossReferenceTable.entries.push_back(entry);
-        currentReadPtr += 20;
+        // entries are 20 bytes long including the line break, but some writers still add another one
+        while (!document.file.is_out_of_range(currentReadPtr) &&
+               (*currentReadPtr == ' ' || *currentReadPtr == '\r' || *currentReadPtr == '\n')) {
+            currentReadPtr++;
+        }
     }
 
-    ignoreNewLines(currentReadPtr);
-
     // parse trailer dict
     auto view = std::string_view((char *)currentReadPtr, 7);
     while (view != "trailer") {
@@ -425,26 +439,30 @@ LoadObjectResult load_object(Document &document, CrossReferenceEntry &entry) {
     ASSERT(false);
 }
 
-Result load_all_objects(Document &document, Trailer *trailer) {
-    if (trailer == nullptr) {
-        return Result::error("Cannot load objects without trailer information (trailer=nullptr)");
-    }
-
+Result load_all_objects(Document &document) {
     struct NumberedCrossReferenceEntry {
         CrossReferenceEntry entry;
         uint64_t objectNumber;
     };
     auto temp              = document.allocator.temporary();
     auto compressedEntries = Vector<NumberedCrossReferenceEntry>(temp);
-    auto &crt              = trailer->crossReferenceTable;
 
-    for (uint64_t objectNumber = crt.firstObjectNumber;
-         objectNumber < static_cast<uint64_t>(crt.firstObjectNumber + crt.objectCount); objectNumber++) {
-        auto itr = document.objectList.find(objectNumber);
-        if (itr != document.objectList.end() && itr->second != nullptr) {
+    // the objectList contains the object numbers of all cross reference sections, newer sections take precedence
+    auto objectNumbers = Vector<uint64_t>(temp);
+    objectNumbers.reserve(document.objectList.size());
+    for (auto &entry : document.objectList) {
+        if (entry.second == nullptr) {
+            objectNumbers.push_back(entry.first);
+        }
+    }
+
+    for (auto objectNumber : objectNumbers) {
+        auto entryPtr = document.find_cross_reference_entry(static_cast<int64_t>(objectNumber));
+        if (entryPtr == nullptr) {
             continue;
         }
-        CrossReferenceEntry &entry = crt.entries[objectNumber - crt.firstObjectNumber];
+
+        CrossReferenceEntry &entry = *entryPtr;
         if (entry.type == CrossReferenceEntryType::COMPRESSED) {
             compressedEntries.push_back({.entry = entry, .objectNumber = objectNumber});
             continue;
@@ -455,9 +473,14 @@ Result load_all_objects(Document &document, Trailer *trailer) {
             return result.drop_value();
         }
 
-        const auto &object                           = result.value();
+        const auto &object = result.value();
+        if (object.first == nullptr) {
+            continue;
+        }
         document.objectList[objectNumber]            = object.first;
-        document.file.metadata.objects[object.first] = {.data = object.second, .isInObjectStream = false};
+        document.file.metadata.objects[object.first] = {
+              .data = object.second, .isInObjectStream = false, .contentHash = content_hash(object.first)};
+        document.add_to_index(object.first);
     }
 
     for (auto &compressedEntry : compressedEntries) {
@@ -468,13 +491,17 @@ Result load_all_objects(Document &document, Trailer *trailer) {
 
         const auto &object                                = result.value();
         document.objectList[compressedEntry.objectNumber] = object.first;
-        document.file.metadata.objects[object.first]      = {.data = object.second, .isInObjectStream = true};
+        document.file.metadata.objects[object.first]      = {
+              .data = object.second, .isInObjectStream = true, .contentHash = content_hash(object.first)};
+        document.add_to_index(object.first);
     }
 
     return Result::ok();
 }
 
 Result read_data(Document &document, bool loadAllObjects) {
+    auto tagScope = AllocationTagScope(document.allocator, AllocationTag::PARSER);
+
     if (document.file.sizeInBytes < 12) {
         return Result::error("File is too short: {} bytes", document.file.sizeInBytes);
     }
@@ -533,7 +560,7 @@ Result read_data(Document &document, bool loadAllObjects) {
         return Result::ok();
     }
 
-    return load_all_objects(document, &document.file.trailer);
+    return load_all_objects(document);
 }
 
 ValueResult<Document> Document::read_from_file(Allocator &allocator, const std::string &filePath, bool loadAllObjects) {
@@ -545,7 +572,7 @@ ValueResult<Document> Document::read_from_file(Allocator &allocator, const std::
     auto document             = Document(allocator);
     document.file.path        = filePath;
     document.file.sizeInBytes = is.tellg();
-    document.file.data        = document.allocator.arena().push(document.file.sizeInBytes);
+    document.file.data        = document.allocator.arena().push(document.file.sizeInBytes, CACHE_LINE_SIZE);
 
     is.seekg(0);
     is.read((char *)document.file.data, static_cast<std::streamsize>(document.file.sizeInBytes));
@@ -562,7 +589,7 @@ ValueResult<Document> Document::read_from_file(Allocator &allocator, const std::
 ValueResult<Document> Document::read_from_memory(Allocator &allocator, const uint8_t *buffer, size_t size,
                                                  bool loadAllObjects) {
     auto document             = Document(allocator);
-    document.file.data        = document.allocator.arena().push(size);
+    document.file.data        = document.allocator.arena().push(size, CACHE_LINE_SIZE);
     document.file.sizeInBytes = size;
 
     memcpy(document.file.data, buffer, size);
@@ -1,26 +1,23 @@
 #include "document.h"
 
-#include <fstream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <filesystem>
 #include <spdlog/spdlog.h>
-#include <sstream>
+#include <thread>
 
-namespace pdf {
-
-void write_zero_padded_number(std::ostream &s, uint64_t num, int64_t maxNumDigits) {
-    int64_t numDigits = 0;
-    if (num != 0) {
-        numDigits = static_cast<int64_t>(std::log10(num) + 1);
-    }
-    ASSERT(numDigits <= maxNumDigits);
+#include "pdf/compression.h"
+#include "pdf/output_buffer.h"
 
-    for (int i = 0; i < maxNumDigits - numDigits; i++) {
-        s << "0";
-    }
+namespace pdf {
 
-    if (num != 0) {
-        s << std::to_string(num);
-    }
-}
+/// if fewer objects than this have to be serialized, they are always written on a single thread
+const size_t PARALLEL_WRITE_MIN_OBJECT_COUNT = 256;
+/// number of consecutive objects that are serialized into the same buffer
+const size_t PARALLEL_WRITE_BLOCK_SIZE  = 64;
+const size_t PARALLEL_WRITE_BUFFER_SIZE = 16 * 1024; // 16 KB
 
 size_t count_digits(int64_t number) {
     size_t result = 0;
@@ -31,34 +28,31 @@ size_t count_digits(int64_t number) {
     return result;
 }
 
-void write_header(std::ostream &s) { s << "%PDF-1.6\n%äüöß\n"; }
+void write_header(OutputBuffer &s) { s << "%PDF-1.6\n%äüöß\n"; }
 
-void write_object(std::ostream &s, Object *object);
-void write_boolean_object(std::ostream &s, Boolean *boolean) {
+void write_object(OutputBuffer &s, Object *object);
+void write_boolean_object(OutputBuffer &s, Boolean *boolean) {
     if (boolean->value) {
         s << "true";
     } else {
         s << "false";
     }
 }
-void write_null_object(std::ostream &s, Null *) {
+void write_null_object(OutputBuffer &s, Null *) {
     // TODO check with the spec again
     s << "null";
 }
-void write_integer_object(std::ostream &s, Integer *integer) { s << integer->value; }
-void write_real_object(std::ostream &s, Real *real) {
-    auto str = std::to_string(real->value);
-    s << str;
-}
-void write_hexadecimal_string_object(std::ostream &s, HexadecimalString *hexadecimal) {
+void write_integer_object(OutputBuffer &s, Integer *integer) { s << integer->value; }
+void write_real_object(OutputBuffer &s, Real *real) { s.write_real(real->value); }
+void write_hexadecimal_string_object(OutputBuffer &s, HexadecimalString *hexadecimal) {
     s << "<" << hexadecimal->value << ">";
 }
-void write_literal_string_object(std::ostream &s, LiteralString *literal) { s << "(" << literal->value << ")"; }
-void write_name_object(std::ostream &s, Name *name) { s << "/" << name->value; }
-void write_array_object(std::ostream &s, Array *array) {
+void write_literal_string_object(OutputBuffer &s, LiteralString *literal) { s << "(" << literal->value << ")"; }
+void write_name_object(OutputBuffer &s, Name *name) { s << "/" << name->value; }
+void write_array_object(OutputBuffer &s, Array *array) {
     s << "[";
     for (size_t i = 0; i < array->values.size(); i++) {
-        const auto obj = array->values[i];
+        const auto &obj = array->values[i];
         write_object(s, obj);
         if (i < array->values.size() - 1) {
             s << " ";
@@ -66,7 +60,7 @@ void write_array_object(std::ostream &s, Array *array) {
     }
     s << "]";
 }
-void write_dictionary_object(std::ostream &s, Dictionary *dictionary) {
+void write_dictionary_object(OutputBuffer &s, Dictionary *dictionary) {
     s << "<<";
     int i = 0;
     for (const auto &itr : dictionary->values) {
@@ -79,22 +73,22 @@ void write_dictionary_object(std::ostream &s, Dictionary *dictionary) {
     }
     s << ">>";
 }
-void write_indirect_reference_object(std::ostream &s, IndirectReference *reference) {
+void write_indirect_reference_object(OutputBuffer &s, IndirectReference *reference) {
     s << reference->objectNumber << " " << reference->generationNumber << " R";
 }
-void write_indirect_object(std::ostream &s, IndirectObject *object) {
+void write_indirect_object(OutputBuffer &s, IndirectObject *object) {
     s << object->objectNumber << " " << object->generationNumber << " obj\n";
     write_object(s, object->object);
     s << "\nendobj\n";
 }
-void write_stream_object(std::ostream &s, Stream *stream) {
+void write_stream_object(OutputBuffer &s, Stream *stream) {
     write_dictionary_object(s, stream->dictionary);
     s << "\nstream\n";
     s << stream->streamData;
     s << "\nendstream";
 }
-void write_object_stream_content_object(std::ostream &, ObjectStreamContent *) { ASSERT(false); }
-void write_object(std::ostream &s, Object *object) {
+void write_object_stream_content_object(OutputBuffer &, ObjectStreamContent *) { ASSERT(false); }
+void write_object(OutputBuffer &s, Object *object) {
     switch (object->type) {
     case Object::Type::BOOLEAN:
         write_boolean_object(s, object->as<Boolean>());
@@ -140,77 +134,1080 @@ void write_object(std::ostream &s, Object *object) {
     }
 }
 
-void write_objects(Document &document, std::ostream &s, UnorderedMap<uint64_t, uint64_t> &byteOffsets) {
+/// Object streams and cross reference streams of the original file are not written, since the output uses a cross
+/// reference table and all compressed objects are written as regular objects
+UnorderedSet<uint64_t> find_container_objects(Document &document, TemporaryAllocator &allocator) {
+    auto result = UnorderedSet<uint64_t>(allocator);
+    for (Trailer *t = &document.file.trailer; t != nullptr; t = t->prev) {
+        if (t->streamObject != nullptr) {
+            result.insert(t->streamObject->objectNumber);
+        }
+        for (auto &entry : t->crossReferenceTable.entries) {
+            if (entry.type == CrossReferenceEntryType::COMPRESSED) {
+                result.insert(entry.compressed.objectNumberOfStream);
+            }
+        }
+    }
+    return result;
+}
+
+/// Sorted byte offsets of everything that could follow an object in the original file (other objects, cross reference
+/// sections and the end of the file), which is used to find the end of an object without parsing it
+Vector<uint64_t> find_object_boundaries(Document &document, TemporaryAllocator &allocator) {
+    auto result = Vector<uint64_t>(allocator);
+    for (Trailer *t = &document.file.trailer; t != nullptr; t = t->prev) {
+        for (auto &entry : t->crossReferenceTable.entries) {
+            if (entry.type == CrossReferenceEntryType::NORMAL) {
+                result.push_back(entry.normal.byteOffset);
+            }
+        }
+    }
+    for (auto &entry : document.file.metadata.trailers) {
+        result.push_back(reinterpret_cast<const uint8_t *>(entry.second.data()) - document.file.data);
+    }
+    result.push_back(document.file.sizeInBytes);
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+/// Finds the bytes of an object that has not been loaded, by looking for the last "endobj" before the next boundary
+std::string_view find_raw_object(Document &document, const Vector<uint64_t> &boundaries, uint64_t objectNumber,
+                                 uint64_t byteOffset) {
+    auto boundary = std::upper_bound(boundaries.begin(), boundaries.end(), byteOffset);
+    if (byteOffset >= document.file.sizeInBytes || boundary == boundaries.end()) {
+        return {};
+    }
+
+    auto start = reinterpret_cast<const char *>(document.file.data + byteOffset);
+    auto data  = std::string_view(start, *boundary - byteOffset);
+    auto end   = data.rfind("endobj");
+    if (end == std::string_view::npos) {
+        return {};
+    }
+    data = data.substr(0, end + 6);
+
+    // make sure that the cross reference entry actually points to the object we are looking for
+    uint64_t number = 0;
+    auto result     = std::from_chars(data.data(), data.data() + data.size(), number);
+    if (result.ec != std::errc() || number != objectNumber) {
+        return {};
+    }
+    return data;
+}
+
+/// An object that is going to be written, either as a verbatim copy of its original bytes or by serializing it
+struct ObjectToWrite {
+    uint64_t objectNumber     = 0;
+    uint64_t generationNumber = 0;
+    IndirectObject *object    = nullptr;
+    std::string_view raw      = {};
+    /// position of the object in the output
+    uint64_t byteOffset = 0;
+    /// position of the serialized object in the buffer of its block (only used when serializing in parallel)
+    size_t serializedOffset = 0;
+    size_t serializedSize   = 0;
+};
+
+void write_object_to_write(OutputBuffer &s, const ObjectToWrite &objectToWrite) {
+    if (!objectToWrite.raw.empty()) {
+        s << objectToWrite.raw << "\n";
+    } else {
+        write_object(s, objectToWrite.object);
+    }
+}
+
+/// Serializes blocks of consecutive objects into separate buffers on multiple threads, the buffers are then
+/// concatenated in order, which results in exactly the same output as writing the objects one after the other
+void write_objects_parallel(OutputBuffer &s, Vector<ObjectToWrite> &objectsToWrite, uint64_t startOffset,
+                            size_t threadCount, TemporaryAllocator &allocator) {
+    auto blockCount = (objectsToWrite.size() + PARALLEL_WRITE_BLOCK_SIZE - 1) / PARALLEL_WRITE_BLOCK_SIZE;
+    auto buffers    = reinterpret_cast<OutputBuffer *>(
+          allocator.arena().push(sizeof(OutputBuffer) * blockCount, alignof(OutputBuffer)));
+    for (size_t i = 0; i < blockCount; i++) {
+        new (buffers + i) OutputBuffer(PARALLEL_WRITE_BUFFER_SIZE);
+    }
+
+    threadCount = std::min(threadCount, blockCount);
+
+    auto nextBlock = std::atomic<size_t>(0);
+    auto worker    = [&]() {
+        for (auto i = nextBlock++; i < blockCount; i = nextBlock++) {
+            auto &buffer = buffers[i];
+            auto end     = std::min((i + 1) * PARALLEL_WRITE_BLOCK_SIZE, objectsToWrite.size());
+            for (auto j = i * PARALLEL_WRITE_BLOCK_SIZE; j < end; j++) {
+                auto &objectToWrite = objectsToWrite[j];
+                if (!objectToWrite.raw.empty()) {
+                    // verbatim copies are written straight to the output, there is nothing to gain from copying twice
+                    continue;
+                }
+                objectToWrite.serializedOffset = buffer.size();
+                write_object(buffer, objectToWrite.object);
+                objectToWrite.serializedSize = buffer.size() - objectToWrite.serializedOffset;
+            }
+        }
+    };
+    auto threads = std::vector<std::thread>();
+    threads.reserve(threadCount - 1);
+    for (size_t i = 0; i < threadCount - 1; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < blockCount; i++) {
+        if (buffers[i].has_error()) {
+            // the serialized objects of this block are incomplete
+            s.set_error();
+        }
+    }
+
+    // the byte offsets are a running sum over the sizes of all objects, in the order in which they are written
+    for (size_t i = 0; i < objectsToWrite.size(); i++) {
+        auto &objectToWrite      = objectsToWrite[i];
+        objectToWrite.byteOffset = startOffset + s.size();
+        if (!objectToWrite.raw.empty()) {
+            s << objectToWrite.raw << "\n";
+        } else {
+            auto blockData = buffers[i / PARALLEL_WRITE_BLOCK_SIZE].str().data();
+            s.write(blockData + objectToWrite.serializedOffset, objectToWrite.serializedSize);
+        }
+    }
+
+    for (size_t i = 0; i < blockCount; i++) {
+        buffers[i].~OutputBuffer();
+    }
+}
+
+/// Writes all objects in the given order and records their byte offsets (relative to startOffset)
+void write_objects(OutputBuffer &s, Vector<ObjectToWrite> &objectsToWrite, uint64_t startOffset, size_t threadCount,
+                   TemporaryAllocator &allocator) {
+    if (threadCount == 0) {
+        threadCount = std::max(std::thread::hardware_concurrency(), 1U);
+    }
+
+    size_t serializedObjectCount = 0;
+    for (const auto &objectToWrite : objectsToWrite) {
+        serializedObjectCount += objectToWrite.raw.empty();
+    }
+
+    if (threadCount > 1 && serializedObjectCount >= PARALLEL_WRITE_MIN_OBJECT_COUNT) {
+        write_objects_parallel(s, objectsToWrite, startOffset, threadCount, allocator);
+        return;
+    }
+
+    for (auto &objectToWrite : objectsToWrite) {
+        objectToWrite.byteOffset = startOffset + s.size();
+        write_object_to_write(s, objectToWrite);
+    }
+}
+
+/// Unmodified objects are copied verbatim from the original file (even the ones that have never been loaded), all other
+/// objects are serialized. With loadAllObjects, objects that have not been loaded yet are loaded as well (they are
+/// still copied verbatim), so that the caller can look at their content. If reachableObjects is set, all other objects
+/// are skipped.
+Vector<ObjectToWrite> collect_objects_to_write(Document &document, bool loadAllObjects,
+                                               const UnorderedSet<uint64_t> *reachableObjects,
+                                               TemporaryAllocator &allocator) {
+    auto containerObjects = find_container_objects(document, allocator);
+    auto boundaries       = find_object_boundaries(document, allocator);
+
+    // loading compressed objects inserts into the objectList, that's why the object numbers are collected up front
+    auto objectNumbers = Vector<uint64_t>(allocator);
+    objectNumbers.reserve(document.objectList.size());
     for (auto &entry : document.objectList) {
-        if (entry.second == nullptr) {
+        objectNumbers.push_back(entry.first);
+    }
+
+    auto objectsToWrite = Vector<ObjectToWrite>(allocator);
+    objectsToWrite.reserve(objectNumbers.size());
+    for (auto objectNumber : objectNumbers) {
+        if (containerObjects.contains(objectNumber) ||
+            (reachableObjects != nullptr && !reachableObjects->contains(objectNumber))) {
             continue;
         }
 
-        byteOffsets[entry.first] = s.tellp();
-        write_object(s, entry.second);
+        auto object         = document.objectList[objectNumber];
+        auto raw            = std::string_view();
+        uint64_t generation = 0;
+        if (object != nullptr) {
+            generation    = object->generationNumber;
+            auto metadata = document.file.metadata.objects.find(object);
+            if (!document.is_dirty(object) && !metadata->second.isInObjectStream) {
+                raw = metadata->second.data;
+            }
+        } else {
+            auto xrefEntry = document.find_cross_reference_entry(static_cast<int64_t>(objectNumber));
+            if (xrefEntry == nullptr || xrefEntry->type == CrossReferenceEntryType::FREE) {
+                continue;
+            }
+            if (xrefEntry->type == CrossReferenceEntryType::NORMAL) {
+                generation = xrefEntry->normal.generationNumber;
+                raw        = find_raw_object(document, boundaries, objectNumber, xrefEntry->normal.byteOffset);
+            }
+        }
+
+        if ((raw.empty() || loadAllObjects) && object == nullptr) {
+            // compressed objects (and objects that could not be located) have to be parsed and serialized
+            object = document.get_object(static_cast<int64_t>(objectNumber));
+            if (object == nullptr) {
+                spdlog::warn("Failed to load object {}, it is not going to be written", objectNumber);
+                continue;
+            }
+            generation = object->generationNumber;
+        }
+
+        objectsToWrite.push_back(
+              {.objectNumber = objectNumber, .generationNumber = generation, .object = object, .raw = raw});
     }
+    return objectsToWrite;
 }
 
-void write_trailer(Document &document, std::ostream &s, UnorderedMap<uint64_t, uint64_t> &byteOffsets) {
-    auto startXref = s.tellp();
-    if (document.file.trailer.dict != nullptr) {
-        s << "xref\n";
+/// Records the byte offsets of the written objects in entries, which is indexed by object number
+void add_cross_reference_entries(Vector<CrossReferenceEntry> &entries, const Vector<ObjectToWrite> &objectsToWrite) {
+    for (const auto &objectToWrite : objectsToWrite) {
+        if (objectToWrite.objectNumber >= entries.size()) {
+            entries.resize(objectToWrite.objectNumber + 1, CrossReferenceEntry{});
+        }
+        auto &entry                   = entries[objectToWrite.objectNumber];
+        entry.type                    = CrossReferenceEntryType::NORMAL;
+        entry.normal.byteOffset       = objectToWrite.byteOffset;
+        entry.normal.generationNumber = objectToWrite.generationNumber;
+    }
+}
 
-        auto xrefEntryCount = byteOffsets.size() + 1;
-        s << 0 << " " << xrefEntryCount << "\n";
+/// Copies the object, replacing the object numbers of all indirect references with the new ones. References to objects
+/// that are not written anymore are replaced with null, which is what they would resolve to anyway.
+Object *copy_with_new_object_numbers(Object *object, const UnorderedMap<uint64_t, uint64_t> &newObjectNumbers,
+                                     TemporaryAllocator &allocator) {
+    switch (object->type) {
+    case Object::Type::ARRAY: {
+        auto values = Vector<Object *>(allocator);
+        values.reserve(object->as<Array>()->values.size());
+        for (auto &value : object->as<Array>()->values) {
+            values.push_back(copy_with_new_object_numbers(value, newObjectNumbers, allocator));
+        }
+        return allocator.arena().push<Array>(values);
+    }
+    case Object::Type::DICTIONARY: {
+        auto values = UnorderedMap<std::string, Object *>(allocator);
+        for (auto &entry : object->as<Dictionary>()->values) {
+            values[entry.first] = copy_with_new_object_numbers(entry.second, newObjectNumbers, allocator);
+        }
+        return allocator.arena().push<Dictionary>(values);
+    }
+    case Object::Type::STREAM: {
+        auto stream     = object->as<Stream>();
+        auto dictionary = copy_with_new_object_numbers(stream->dictionary, newObjectNumbers, allocator);
+        return allocator.arena().push<Stream>(dictionary->as<Dictionary>(), stream->streamData);
+    }
+    case Object::Type::INDIRECT_REFERENCE: {
+        auto itr = newObjectNumbers.find(static_cast<uint64_t>(object->as<IndirectReference>()->objectNumber));
+        if (itr == newObjectNumbers.end()) {
+            return allocator.arena().push<Null>();
+        }
+        return allocator.arena().push<IndirectReference>(static_cast<int64_t>(itr->second), 0);
+    }
+    default:
+        return object;
+    }
+}
+
+/// Assigns consecutive object numbers to the objects (keeping their order) and rewrites all references to them,
+/// including the ones in the trailer. The objects are copied, the document itself is not modified.
+void renumber_objects(Vector<ObjectToWrite> &objectsToWrite, UnorderedMap<std::string, Object *> &trailerValues,
+                      TemporaryAllocator &allocator) {
+    std::sort(objectsToWrite.begin(), objectsToWrite.end(),
+              [](const auto &a, const auto &b) { return a.objectNumber < b.objectNumber; });
+
+    auto newObjectNumbers = UnorderedMap<uint64_t, uint64_t>(allocator);
+    newObjectNumbers.reserve(objectsToWrite.size());
+    for (size_t i = 0; i < objectsToWrite.size(); i++) {
+        newObjectNumbers[objectsToWrite[i].objectNumber] = i + 1;
+    }
+
+    for (auto &objectToWrite : objectsToWrite) {
+        auto objectNumber = newObjectNumbers[objectToWrite.objectNumber];
+        auto object       = copy_with_new_object_numbers(objectToWrite.object->object, newObjectNumbers, allocator);
+        auto indirect     = allocator.arena().push<IndirectObject>(static_cast<int64_t>(objectNumber), 0, object);
+        objectToWrite     = {.objectNumber = objectNumber, .object = indirect};
+    }
 
-        s << "0000000000 65535 f \n";
-        for (size_t i = 0; i < byteOffsets.size(); i++) {
-            write_zero_padded_number(s, byteOffsets[i + 1], 10);
-            s << " 00000 n \n";
+    for (auto &entry : trailerValues) {
+        entry.second = copy_with_new_object_numbers(entry.second, newObjectNumbers, allocator);
+    }
+}
+
+/// Writes the object in a form that is the same for all structurally identical objects: dictionary keys are sorted and
+/// references to merged objects use the object number of the object they have been merged into. The data of streams
+/// is not part of it, since it is compared separately.
+void write_canonical_object(OutputBuffer &s, Object *object, const UnorderedMap<uint64_t, uint64_t> &mergedObjects,
+                            TemporaryAllocator &allocator) {
+    switch (object->type) {
+    case Object::Type::ARRAY:
+        s << "[";
+        for (auto &value : object->as<Array>()->values) {
+            write_canonical_object(s, value, mergedObjects, allocator);
+            s << " ";
         }
+        s << "]";
+        break;
+    case Object::Type::DICTIONARY: {
+        auto entries = Vector<const std::pair<const std::string, Value> *>(allocator);
+        for (auto &entry : object->as<Dictionary>()->values) {
+            entries.push_back(&entry);
+        }
+        std::sort(entries.begin(), entries.end(), [](auto a, auto b) { return a->first < b->first; });
 
-        s << "trailer\n";
-        write_dictionary_object(s, document.file.trailer.dict);
+        s << "<<";
+        for (auto entry : entries) {
+            s << "/" << entry->first << " ";
+            write_canonical_object(s, entry->second, mergedObjects, allocator);
+            s << " ";
+        }
+        s << ">>";
+        break;
+    }
+    case Object::Type::STREAM:
+        write_canonical_object(s, object->as<Stream>()->dictionary, mergedObjects, allocator);
+        s << "stream";
+        break;
+    case Object::Type::INDIRECT_REFERENCE: {
+        auto objectNumber = static_cast<uint64_t>(object->as<IndirectReference>()->objectNumber);
+        auto itr          = mergedObjects.find(objectNumber);
+        s << (itr == mergedObjects.end() ? objectNumber : itr->second) << " R";
+        break;
+    }
+    default:
+        write_object(s, object);
+        break;
+    }
+}
+
+/// Objects of these types have an identity, two of them are different even if they have the same content (e.g. an
+/// annotation belongs to exactly one page and an optional content group is switched on and off on its own)
+const std::array<std::string_view, 12> UNIQUE_OBJECT_TYPES = {
+      "Catalog", "Pages", "Page", "Annot", "OCG", "StructTreeRoot", "StructElem", "Outlines", "Thread", "Bead", "Sig",
+      "Template",
+};
+/// Keys that link an object into a tree or to the object it belongs to, or that only occur in annotations (/Type is
+/// optional for those)
+const std::array<std::string_view, 5> UNIQUE_OBJECT_KEYS = {"Parent", "Kids", "P", "Rect", "StructParent"};
+
+/// Objects with an identity (page tree nodes, annotations, structure elements, ...) are unique, even if they have the
+/// same content
+bool is_mergeable(const ObjectToWrite &objectToWrite) {
+    if (objectToWrite.object == nullptr) {
+        return false;
+    }
+
+    auto object = objectToWrite.object->object;
+    if (object->is<Stream>()) {
+        object = object->as<Stream>()->dictionary;
+    }
+    if (!object->is<Dictionary>()) {
+        return !object->is<Null>();
+    }
+
+    auto dictionary = object->as<Dictionary>();
+    auto typeItr    = dictionary->values.find("Type");
+    if (typeItr != dictionary->values.end() && typeItr->second->is<Name>() &&
+        std::find(UNIQUE_OBJECT_TYPES.begin(), UNIQUE_OBJECT_TYPES.end(), typeItr->second->as<Name>()->value) !=
+              UNIQUE_OBJECT_TYPES.end()) {
+        return false;
+    }
+    for (const auto &key : UNIQUE_OBJECT_KEYS) {
+        if (dictionary->values.contains(std::string(key))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool references_any(Object *object, const UnorderedMap<uint64_t, uint64_t> &objectNumbers) {
+    switch (object->type) {
+    case Object::Type::ARRAY:
+        for (auto &value : object->as<Array>()->values) {
+            if (references_any(value, objectNumbers)) {
+                return true;
+            }
+        }
+        return false;
+    case Object::Type::DICTIONARY:
+        for (auto &entry : object->as<Dictionary>()->values) {
+            if (references_any(entry.second, objectNumbers)) {
+                return true;
+            }
+        }
+        return false;
+    case Object::Type::STREAM:
+        return references_any(object->as<Stream>()->dictionary, objectNumbers);
+    case Object::Type::INDIRECT_REFERENCE:
+        return objectNumbers.contains(static_cast<uint64_t>(object->as<IndirectReference>()->objectNumber));
+    default:
+        return false;
+    }
+}
+
+struct ObjectFingerprint {
+    size_t index                = 0;
+    size_t hash                 = 0;
+    std::string_view canonical  = {};
+    std::string_view streamData = {};
+};
+
+/// Merges structurally identical objects into the one with the lowest object number and rewrites all references to
+/// the merged objects. This is repeated until nothing changes anymore, since merging objects can make the objects that
+/// refer to them identical as well (e.g. two font dictionaries that embed the same font program).
+/// Returns the number of objects that have been removed.
+size_t deduplicate_objects(Vector<ObjectToWrite> &objectsToWrite, UnorderedMap<std::string, Object *> &trailerValues,
+                           TemporaryAllocator &allocator) {
+    auto mergedObjects = UnorderedMap<uint64_t, uint64_t>(allocator);
+    while (true) {
+        auto canonical    = OutputBuffer();
+        auto fingerprints = Vector<ObjectFingerprint>(allocator);
+        auto offsets      = Vector<size_t>(allocator);
+        for (size_t i = 0; i < objectsToWrite.size(); i++) {
+            if (mergedObjects.contains(objectsToWrite[i].objectNumber) || !is_mergeable(objectsToWrite[i])) {
+                continue;
+            }
+
+            auto object = objectsToWrite[i].object->object;
+            offsets.push_back(canonical.size());
+            write_canonical_object(canonical, object, mergedObjects, allocator);
+            fingerprints.push_back({.index = i});
+            if (object->is<Stream>()) {
+                fingerprints.back().streamData = object->as<Stream>()->streamData;
+            }
+        }
+        offsets.push_back(canonical.size());
+        if (canonical.has_error()) {
+            // the canonical forms are incomplete, the merges that have been found so far are still valid
+            spdlog::warn("Failed to allocate memory for finding duplicate objects");
+            break;
+        }
+
+        // the canonical buffer might have been reallocated while writing, that's why the views are created afterwards
+        auto hasher = std::hash<std::string_view>();
+        for (size_t i = 0; i < fingerprints.size(); i++) {
+            auto &fingerprint     = fingerprints[i];
+            fingerprint.canonical = canonical.str().substr(offsets[i], offsets[i + 1] - offsets[i]);
+            fingerprint.hash      = hasher(fingerprint.canonical) ^ (hasher(fingerprint.streamData) * 31);
+        }
+
+        // identical objects end up next to each other, ordered by object number
+        std::sort(fingerprints.begin(), fingerprints.end(), [&objectsToWrite](const auto &a, const auto &b) {
+            if (a.hash != b.hash) {
+                return a.hash < b.hash;
+            }
+            if (a.canonical != b.canonical) {
+                return a.canonical < b.canonical;
+            }
+            if (a.streamData != b.streamData) {
+                return a.streamData < b.streamData;
+            }
+            return objectsToWrite[a.index].objectNumber < objectsToWrite[b.index].objectNumber;
+        });
+
+        size_t mergedObjectCount = 0;
+        for (size_t i = 1; i < fingerprints.size(); i++) {
+            const auto &previous = fingerprints[i - 1];
+            const auto &current  = fingerprints[i];
+            if (current.hash != previous.hash || current.canonical != previous.canonical ||
+                current.streamData != previous.streamData) {
+                continue;
+            }
+
+            auto target = objectsToWrite[previous.index].objectNumber;
+            auto itr    = mergedObjects.find(target);
+            if (itr != mergedObjects.end()) {
+                target = itr->second;
+            }
+            mergedObjects[objectsToWrite[current.index].objectNumber] = target;
+            mergedObjectCount++;
+        }
+
+        if (mergedObjectCount == 0) {
+            break;
+        }
+
+        // objects that have been merged into an object which got merged itself in this round point to the final one
+        for (auto &entry : mergedObjects) {
+            auto itr = mergedObjects.find(entry.second);
+            while (itr != mergedObjects.end()) {
+                entry.second = itr->second;
+                itr          = mergedObjects.find(entry.second);
+            }
+        }
+    }
+
+    if (mergedObjects.empty()) {
+        return 0;
+    }
+
+    // all objects that refer to merged objects are copied with the new references, the rest is left untouched
+    auto newObjectNumbers = UnorderedMap<uint64_t, uint64_t>(allocator);
+    newObjectNumbers.reserve(objectsToWrite.size());
+    for (const auto &objectToWrite : objectsToWrite) {
+        newObjectNumbers[objectToWrite.objectNumber] = objectToWrite.objectNumber;
+    }
+    for (auto &entry : mergedObjects) {
+        newObjectNumbers[entry.first] = entry.second;
+    }
+
+    auto result = Vector<ObjectToWrite>(allocator);
+    result.reserve(objectsToWrite.size() - mergedObjects.size());
+    for (auto &objectToWrite : objectsToWrite) {
+        if (mergedObjects.contains(objectToWrite.objectNumber)) {
+            continue;
+        }
+
+        if (objectToWrite.object != nullptr && references_any(objectToWrite.object->object, mergedObjects)) {
+            auto object = copy_with_new_object_numbers(objectToWrite.object->object, newObjectNumbers, allocator);
+            objectToWrite.object = allocator.arena().push<IndirectObject>(
+                  static_cast<int64_t>(objectToWrite.objectNumber), objectToWrite.generationNumber, object);
+            objectToWrite.raw = {};
+        }
+        result.push_back(objectToWrite);
+    }
+    objectsToWrite = std::move(result);
+
+    for (auto &entry : trailerValues) {
+        if (references_any(entry.second, mergedObjects)) {
+            entry.second = copy_with_new_object_numbers(entry.second, newObjectNumbers, allocator);
+        }
+    }
+
+    return mergedObjects.size();
+}
+
+/// Finds the objects that are going to be written and applies removeUnusedObjects, deduplicateObjects and
+/// renumberObjects to them
+Vector<ObjectToWrite> select_objects_to_write(Document &document, const WriteOptions &options, bool loadAllObjects,
+                                              UnorderedMap<std::string, Object *> &trailerValues,
+                                              TemporaryAllocator &allocator) {
+    // renumbering and deduplication look at the content of all objects, which requires all of them to be loaded
+    loadAllObjects |= options.renumberObjects || options.deduplicateObjects;
+
+    auto reachableObjects = UnorderedSet<uint64_t>(allocator);
+    if (options.removeUnusedObjects) {
+        reachableObjects = document.find_reachable_objects(allocator);
+    }
+
+    auto objectsToWrite = collect_objects_to_write(
+          document, loadAllObjects, options.removeUnusedObjects ? &reachableObjects : nullptr, allocator);
+    if (options.deduplicateObjects) {
+        auto mergedObjectCount = deduplicate_objects(objectsToWrite, trailerValues, allocator);
+        spdlog::info("Merged {} duplicate objects", mergedObjectCount);
+    }
+    if (options.renumberObjects) {
+        renumber_objects(objectsToWrite, trailerValues, allocator);
+    }
+    return objectsToWrite;
+}
+
+struct NumberedCrossReferenceEntry {
+    uint64_t objectNumber     = 0;
+    CrossReferenceEntry entry = {};
+};
+
+/// The trailer dictionary of the original file, without the keys that only apply to its cross reference sections
+UnorderedMap<std::string, Object *> create_trailer_dictionary(Document &document, TemporaryAllocator &allocator) {
+    auto source = document.file.trailer.dict;
+    if (source == nullptr) {
+        source = document.file.trailer.streamObject->object->as<Stream>()->dictionary;
+    }
+
+    auto values = UnorderedMap<std::string, Object *>(allocator);
+    for (auto &entry : source->values) {
+        if (entry.first == "Prev" || entry.first == "XRefStm" || entry.first == "Type" || entry.first == "W" ||
+            entry.first == "Index" || entry.first == "Length" || entry.first == "Filter" ||
+            entry.first == "DecodeParms") {
+            continue;
+        }
+        values[entry.first] = entry.second;
+    }
+    return values;
+}
+
+/// entries have to be sorted by object number, consecutive object numbers are grouped into one subsection
+void write_cross_reference_table(OutputBuffer &s, const Vector<NumberedCrossReferenceEntry> &entries) {
+    s << "xref\n";
+    for (size_t i = 0; i < entries.size();) {
+        auto end = i + 1;
+        while (end < entries.size() && entries[end].objectNumber == entries[end - 1].objectNumber + 1) {
+            end++;
+        }
+
+        s << entries[i].objectNumber << " " << (end - i) << "\n";
+        for (; i < end; i++) {
+            const auto &entry = entries[i].entry;
+            if (entry.type == CrossReferenceEntryType::NORMAL) {
+                s.write_xref_entry(entry.normal.byteOffset, entry.normal.generationNumber, 'n');
+            } else {
+                // compressed objects can only be referenced from cross reference streams
+                ASSERT(entry.type == CrossReferenceEntryType::FREE);
+                s.write_xref_entry(entry.free.nextFreeObjectNumber, entry.free.nextFreeObjectGenerationNumber, 'f');
+            }
+        }
+    }
+}
+
+/// number of bytes that are needed to store the given number in a field of a cross reference stream
+int field_width(uint64_t number) {
+    int result = 0;
+    while (number > 0) {
+        number >>= 8;
+        result++;
+    }
+    return result;
+}
+
+void write_field(uint8_t *&ptr, uint64_t value, int width) {
+    for (int i = width - 1; i >= 0; i--) {
+        *ptr++ = static_cast<uint8_t>(value >> (i * 8));
+    }
+}
+
+/// Writes a cross reference stream with the smallest possible field widths. The entries have to be sorted by object
+/// number and should include the entry of the stream itself. trailerValues are added to the stream dictionary.
+void write_cross_reference_stream(Document &document, OutputBuffer &s,
+                                  const Vector<NumberedCrossReferenceEntry> &entries,
+                                  UnorderedMap<std::string, Object *> &trailerValues, uint64_t objectNumber,
+                                  const CompressionOptions &compression, TemporaryAllocator &allocator) {
+    uint64_t maxField1 = 0;
+    uint64_t maxField2 = 0;
+    for (const auto &numberedEntry : entries) {
+        const auto &entry = numberedEntry.entry;
+        switch (entry.type) {
+        case CrossReferenceEntryType::FREE:
+            maxField1 = std::max(maxField1, entry.free.nextFreeObjectNumber);
+            maxField2 = std::max(maxField2, entry.free.nextFreeObjectGenerationNumber);
+            break;
+        case CrossReferenceEntryType::NORMAL:
+            maxField1 = std::max(maxField1, entry.normal.byteOffset);
+            maxField2 = std::max(maxField2, entry.normal.generationNumber);
+            break;
+        case CrossReferenceEntryType::COMPRESSED:
+            maxField1 = std::max(maxField1, entry.compressed.objectNumberOfStream);
+            maxField2 = std::max(maxField2, entry.compressed.indexInStream);
+            break;
+        }
+    }
+
+    auto width0   = 1;
+    auto width1   = std::max(field_width(maxField1), 1);
+    auto width2   = field_width(maxField2);
+    auto dataSize = entries.size() * (width0 + width1 + width2);
+    auto data     = allocator.arena().push(dataSize);
+    auto ptr      = data;
+    auto index    = Vector<Object *>(allocator);
+    for (size_t i = 0; i < entries.size(); i++) {
+        const auto &entry = entries[i].entry;
+        write_field(ptr, static_cast<uint64_t>(entry.type), width0);
+        switch (entry.type) {
+        case CrossReferenceEntryType::FREE:
+            write_field(ptr, entry.free.nextFreeObjectNumber, width1);
+            write_field(ptr, entry.free.nextFreeObjectGenerationNumber, width2);
+            break;
+        case CrossReferenceEntryType::NORMAL:
+            write_field(ptr, entry.normal.byteOffset, width1);
+            write_field(ptr, entry.normal.generationNumber, width2);
+            break;
+        case CrossReferenceEntryType::COMPRESSED:
+            write_field(ptr, entry.compressed.objectNumberOfStream, width1);
+            write_field(ptr, entry.compressed.indexInStream, width2);
+            break;
+        }
+
+        if (i == 0 || entries[i].objectNumber != entries[i - 1].objectNumber + 1) {
+            index.push_back(allocator.arena().push<Integer>(static_cast<int64_t>(entries[i].objectNumber)));
+            index.push_back(allocator.arena().push<Integer>(0));
+        }
+        index.back()->as<Integer>()->value++;
+    }
+
+    auto widths = Vector<Object *>(allocator);
+    widths.push_back(allocator.arena().push<Integer>(width0));
+    widths.push_back(allocator.arena().push<Integer>(width1));
+    widths.push_back(allocator.arena().push<Integer>(width2));
+
+    // the cross reference stream is written without compression, if compressing it fails
+    auto streamData        = std::string_view((char *)data, dataSize);
+    auto compressed        = deflate_buffer(document.allocator, data, dataSize, compression);
+    trailerValues["Type"]  = allocator.arena().push<Name>("XRef");
+    trailerValues["W"]     = allocator.arena().push<Array>(widths);
+    trailerValues["Index"] = allocator.arena().push<Array>(index);
+    if (compressed.has_error()) {
+        spdlog::warn("Writing cross reference stream without compression: {}", compressed.message());
     } else {
-        write_indirect_object(s, document.file.trailer.streamObject);
+        streamData              = compressed.value();
+        trailerValues["Filter"] = allocator.arena().push<Name>("FlateDecode");
     }
+    trailerValues["Length"] = allocator.arena().push<Integer>(static_cast<int64_t>(streamData.size()));
+    auto dictionary         = allocator.arena().push<Dictionary>(trailerValues);
+    auto stream             = allocator.arena().push<Stream>(dictionary, streamData);
+    write_indirect_object(s, allocator.arena().push<IndirectObject>(objectNumber, 0, stream));
+}
+
+/// Turns the entries (indexed by object number) into a complete cross reference section, in which all object numbers
+/// that are not in use are free entries that form a linked list starting at object 0
+Vector<NumberedCrossReferenceEntry> create_complete_cross_reference_section(Vector<CrossReferenceEntry> &entries,
+                                                                            TemporaryAllocator &allocator) {
+    while (entries.size() > 1 && entries.back().type == CrossReferenceEntryType::FREE) {
+        entries.pop_back();
+    }
+    if (entries.empty()) {
+        entries.resize(1, CrossReferenceEntry{});
+    }
+
+    auto result                   = Vector<NumberedCrossReferenceEntry>(allocator);
+    uint64_t nextFreeObjectNumber = 0;
+    result.resize(entries.size());
+    for (size_t i = entries.size(); i-- > 0;) {
+        result[i].objectNumber = i;
+        result[i].entry        = entries[i];
+        if (entries[i].type == CrossReferenceEntryType::FREE) {
+            auto &entry                               = result[i].entry;
+            entry.free.nextFreeObjectNumber           = nextFreeObjectNumber;
+            entry.free.nextFreeObjectGenerationNumber = i == 0 ? 65535 : 0;
+            nextFreeObjectNumber                      = i;
+        }
+    }
+    return result;
+}
+
+void write_trailer(OutputBuffer &s, Vector<CrossReferenceEntry> &entries,
+                   UnorderedMap<std::string, Object *> &trailerValues, TemporaryAllocator &allocator) {
+    auto startXref       = s.size();
+    auto numberedEntries = create_complete_cross_reference_section(entries, allocator);
+    write_cross_reference_table(s, numberedEntries);
+
+    trailerValues["Size"] = allocator.arena().push<Integer>(static_cast<int64_t>(numberedEntries.size()));
+    s << "trailer\n";
+    write_dictionary_object(s, allocator.arena().push<Dictionary>(trailerValues));
 
     s << "\nstartxref\n";
+    s << startXref;
+
+    s << "\n%%EOF\n";
+}
 
-    // NOTE writing the number directly to the stream (s << startXref) fails if the ostream is backed by a file for some
-    // reason (it writes 1,000 instead of 1000)
-    s << std::to_string(startXref);
+/// Packs objects into a compressed object stream, it returns the object stream as an object that can be written
+ValueResult<ObjectToWrite> create_object_stream(Document &document, const ObjectToWrite *objects,
+                                                size_t objectCount, uint64_t objectNumber,
+                                                const CompressionOptions &compression, TemporaryAllocator &allocator) {
+    // the stream starts with pairs of object number and byte offset (relative to 'First'), followed by the objects
+    auto header = OutputBuffer();
+    auto body   = OutputBuffer();
+    for (size_t i = 0; i < objectCount; i++) {
+        header << objects[i].objectNumber << " " << body.size() << " ";
+        write_object(body, objects[i].object->object);
+        body << "\n";
+    }
+    header << "\n";
+    if (header.has_error() || body.has_error()) {
+        return ValueResult<ObjectToWrite>::error("Failed to allocate memory for object stream {}", objectNumber);
+    }
+
+    auto contentSize = header.size() + body.size();
+    auto content     = allocator.arena().push(contentSize);
+    std::memcpy(content, header.str().data(), header.size());
+    std::memcpy(content + header.size(), body.str().data(), body.size());
+    // the object stream is written without compression, if compressing it fails
+    auto streamData = std::string_view((char *)content, contentSize);
+    auto compressed = deflate_buffer(document.allocator, content, contentSize, compression);
 
+    auto values     = UnorderedMap<std::string, Object *>(allocator);
+    values["Type"]  = allocator.arena().push<Name>("ObjStm");
+    values["N"]     = allocator.arena().push<Integer>(static_cast<int64_t>(objectCount));
+    values["First"] = allocator.arena().push<Integer>(static_cast<int64_t>(header.size()));
+    if (compressed.has_error()) {
+        spdlog::warn("Writing object stream without compression: {}", compressed.message());
+    } else {
+        streamData       = compressed.value();
+        values["Filter"] = allocator.arena().push<Name>("FlateDecode");
+    }
+    values["Length"] = allocator.arena().push<Integer>(static_cast<int64_t>(streamData.size()));
+    auto stream      = allocator.arena().push<Stream>(allocator.arena().push<Dictionary>(values), streamData);
+    auto object      = allocator.arena().push<IndirectObject>(objectNumber, 0, stream);
+    return ValueResult<ObjectToWrite>::ok({.objectNumber = objectNumber, .object = object});
+}
+
+/// Writes all objects that can be compressed (everything but streams) into object streams, followed by a cross
+/// reference stream instead of a cross reference table
+Result write_packed_objects(Document &document, OutputBuffer &s, const WriteOptions &options,
+                            TemporaryAllocator &allocator) {
+    auto trailerValues  = create_trailer_dictionary(document, allocator);
+    auto objectsToWrite = select_objects_to_write(document, options, true, trailerValues, allocator);
+
+    // the encryption dictionary must not be compressed, since it is needed to decrypt the object streams
+    int64_t encryptObjectNumber = -1;
+    auto encryptItr             = trailerValues.find("Encrypt");
+    if (encryptItr != trailerValues.end() && encryptItr->second->is<IndirectReference>()) {
+        encryptObjectNumber = encryptItr->second->as<IndirectReference>()->objectNumber;
+    }
+
+    uint64_t nextObjectNumber = 1;
+    for (const auto &objectToWrite : objectsToWrite) {
+        nextObjectNumber = std::max(nextObjectNumber, objectToWrite.objectNumber + 1);
+    }
+
+    auto regularObjects    = Vector<ObjectToWrite>(allocator);
+    auto compressedObjects = Vector<ObjectToWrite>(allocator);
+    for (const auto &objectToWrite : objectsToWrite) {
+        if (objectToWrite.object == nullptr || objectToWrite.object->object->is<Stream>() ||
+            objectToWrite.generationNumber != 0 ||
+            static_cast<int64_t>(objectToWrite.objectNumber) == encryptObjectNumber) {
+            regularObjects.push_back(objectToWrite);
+        } else {
+            compressedObjects.push_back(objectToWrite);
+        }
+    }
+
+    // cross reference entries are indexed by object number
+    auto entries = Vector<CrossReferenceEntry>(allocator);
+    entries.resize(nextObjectNumber, CrossReferenceEntry{});
+
+    auto objectStreamSize = std::max(options.objectStreamSize, static_cast<size_t>(1));
+    for (size_t i = 0; i < compressedObjects.size(); i += objectStreamSize) {
+        auto streamObjectNumber = nextObjectNumber++;
+        auto count              = std::min(objectStreamSize, compressedObjects.size() - i);
+        for (size_t j = 0; j < count; j++) {
+            auto &entry                           = entries[compressedObjects[i + j].objectNumber];
+            entry.type                            = CrossReferenceEntryType::COMPRESSED;
+            entry.compressed.objectNumberOfStream = streamObjectNumber;
+            entry.compressed.indexInStream        = j;
+        }
+        auto objectStream = create_object_stream(document, compressedObjects.data() + i, count, streamObjectNumber,
+                                                 options.compression, allocator);
+        if (objectStream.has_error()) {
+            return objectStream.drop_value();
+        }
+        regularObjects.push_back(objectStream.value());
+    }
+
+    write_objects(s, regularObjects, 0, options.threadCount, allocator);
+    add_cross_reference_entries(entries, regularObjects);
+
+    // the cross reference stream is the last object and contains an entry for itself as well
+    auto startXref        = s.size();
+    auto xrefObjectNumber = nextObjectNumber++;
+    entries.resize(nextObjectNumber, CrossReferenceEntry{});
+    entries[xrefObjectNumber].type              = CrossReferenceEntryType::NORMAL;
+    entries[xrefObjectNumber].normal.byteOffset = startXref;
+
+    auto numberedEntries  = create_complete_cross_reference_section(entries, allocator);
+    trailerValues["Size"] = allocator.arena().push<Integer>(static_cast<int64_t>(numberedEntries.size()));
+    write_cross_reference_stream(document, s, numberedEntries, trailerValues, xrefObjectNumber, options.compression,
+                                 allocator);
+
+    s << "startxref\n";
+    s << startXref;
     s << "\n%%EOF\n";
+
+    return Result::from_bool(s.has_error(), "Failed to write data to file");
+}
+
+void recompress_streams(Document &document, const CompressionOptions &options) {
+    for (auto &entry : document.objectList) {
+        if (entry.second == nullptr || !entry.second->object->is<Stream>()) {
+            continue;
+        }
+
+        auto stream = entry.second->object->as<Stream>();
+        if (stream->compressionLevel < 0 || stream->compressionLevel >= options.level) {
+            continue;
+        }
+
+        // the stream is still written with its current compression if this fails
+        if (auto result = stream->recompress(document.allocator, options); result.has_error()) {
+            spdlog::warn("Failed to recompress stream: {}", result.message());
+            continue;
+        }
+        document.mark_dirty(entry.second);
+    }
 }
 
-Result write_to_stream(Document &document, std::ostream &s) {
+/// Appends the new and modified objects and a cross reference section that refers back to the one of the original
+/// file. The original file has to be in front of the data that is written to s, startOffset is its size if it is not
+/// part of s itself.
+Result write_incremental_update(Document &document, OutputBuffer &s, uint64_t startOffset,
+                                const WriteOptions &options) {
+    recompress_streams(document, options.compression);
+
+    auto temp           = document.allocator.temporary();
+    auto objectsToWrite = Vector<ObjectToWrite>(temp);
+    for (auto &entry : document.objectList) {
+        if (entry.second != nullptr && document.is_dirty(entry.second)) {
+            objectsToWrite.push_back({.objectNumber     = entry.first,
+                                      .generationNumber = static_cast<uint64_t>(entry.second->generationNumber),
+                                      .object           = entry.second});
+        }
+    }
+    std::sort(objectsToWrite.begin(), objectsToWrite.end(),
+              [](const auto &a, const auto &b) { return a.objectNumber < b.objectNumber; });
+
+    auto lastByte = document.file.data[document.file.sizeInBytes - 1];
+    if (lastByte != '\n' && lastByte != '\r') {
+        s << "\n";
+    }
+
+    write_objects(s, objectsToWrite, startOffset, options.threadCount, temp);
+
+    auto entries = Vector<NumberedCrossReferenceEntry>(temp);
+    entries.reserve(objectsToWrite.size() + 1);
+    for (const auto &objectToWrite : objectsToWrite) {
+        auto numberedEntry                          = NumberedCrossReferenceEntry();
+        numberedEntry.objectNumber                  = objectToWrite.objectNumber;
+        numberedEntry.entry.type                    = CrossReferenceEntryType::NORMAL;
+        numberedEntry.entry.normal.byteOffset       = objectToWrite.byteOffset;
+        numberedEntry.entry.normal.generationNumber = objectToWrite.generationNumber;
+        entries.push_back(numberedEntry);
+    }
+
+    // the size has to cover all objects of all revisions
+    auto trailerValues = create_trailer_dictionary(document, temp);
+    uint64_t size      = 0;
+    auto sizeItr       = trailerValues.find("Size");
+    if (sizeItr != trailerValues.end() && sizeItr->second->is<Integer>()) {
+        size = static_cast<uint64_t>(sizeItr->second->as<Integer>()->value);
+    }
+    for (auto &entry : document.objectList) {
+        size = std::max(size, entry.first + 1);
+    }
+
+    auto startXref        = startOffset + s.size();
+    trailerValues["Prev"] = temp.arena().push<Integer>(document.file.lastCrossRefStart);
+    if (document.file.trailer.dict != nullptr) {
+        trailerValues["Size"] = temp.arena().push<Integer>(static_cast<int64_t>(size));
+        write_cross_reference_table(s, entries);
+        s << "trailer\n";
+        write_dictionary_object(s, temp.arena().push<Dictionary>(trailerValues));
+        s << "\n";
+    } else {
+        // the original file uses cross reference streams, the new section is a stream as well
+        auto streamObjectNumber             = size;
+        auto streamEntry                    = NumberedCrossReferenceEntry{.objectNumber = streamObjectNumber};
+        streamEntry.entry.type              = CrossReferenceEntryType::NORMAL;
+        streamEntry.entry.normal.byteOffset = startXref;
+        entries.push_back(streamEntry);
+
+        trailerValues["Size"] = temp.arena().push<Integer>(static_cast<int64_t>(size + 1));
+        write_cross_reference_stream(document, s, entries, trailerValues, streamObjectNumber, options.compression,
+                                     temp);
+    }
+
+    s << "startxref\n";
+    s << startXref;
+    s << "\n%%EOF\n";
+
+    return Result::from_bool(s.has_error(), "Failed to write data to file");
+}
+
+Result write_document(Document &document, OutputBuffer &s, const WriteOptions &options) {
+    auto tagScope = AllocationTagScope(document.allocator, AllocationTag::WRITER);
+
+    if (options.incremental) {
+        s.write(reinterpret_cast<const char *>(document.file.data), document.file.sizeInBytes);
+        return write_incremental_update(document, s, 0, options);
+    }
+
+    recompress_streams(document, options.compression);
+
     write_header(s);
 
-    auto temp  = document.allocator.temporary();
-    auto byteOffsets = UnorderedMap<uint64_t, uint64_t>(temp);
-    write_objects(document, s, byteOffsets);
-    write_trailer(document, s, byteOffsets);
+    auto temp = document.allocator.temporary();
+    if (options.useObjectStreams) {
+        return write_packed_objects(document, s, options, temp);
+    }
+
+    auto trailerValues  = create_trailer_dictionary(document, temp);
+    auto objectsToWrite = select_objects_to_write(document, options, false, trailerValues, temp);
+    write_objects(s, objectsToWrite, 0, options.threadCount, temp);
+
+    // cross reference entries are indexed by object number
+    auto entries = Vector<CrossReferenceEntry>(temp);
+    entries.resize(objectsToWrite.size() + 1, CrossReferenceEntry{});
+    add_cross_reference_entries(entries, objectsToWrite);
+    write_trailer(s, entries, trailerValues, temp);
 
-    return Result::from_bool(s.bad(), "Failed to write data to file");
+    return Result::from_bool(s.has_error(), "Failed to write data to file");
+}
+
+/// Appends an incremental update to the file the document has been read from, without rewriting the original bytes
+Result append_incremental_update(Document &document, const std::string &filePath, const WriteOptions &options) {
+    auto tagScope = AllocationTagScope(document.allocator, AllocationTag::WRITER);
+
+    auto file = std::fopen(filePath.c_str(), "r+b");
+    if (file == nullptr) {
+        return Result::error("Failed to open file for writing: '{}'", filePath);
+    }
+
+    // the cross reference section refers to byte offsets in the original file, so it must not have changed since then
+    if (std::fseek(file, 0, SEEK_END) != 0 || std::ftell(file) != static_cast<long>(document.file.sizeInBytes)) {
+        std::fclose(file);
+        return Result::error("File has been modified since it was read: '{}'", filePath);
+    }
+
+    auto s      = OutputBuffer(file);
+    auto result = write_incremental_update(document, s, document.file.sizeInBytes, options);
+    if (!result.has_error()) {
+        result = s.flush();
+    }
+
+    if (std::fclose(file) != 0 && !result.has_error()) {
+        return Result::error("Failed to close file: '{}'", filePath);
+    }
+    return result;
 }
 
 Result Document::write_to_file(const std::string &filePath) {
-    auto os = std::ofstream(filePath, std::ios::out | std::ios::binary);
-    if (!os.is_open()) {
+    auto options        = WriteOptions();
+    options.compression = compression;
+    return write_to_file(filePath, options);
+}
+
+Result Document::write_to_file(const std::string &filePath, const WriteOptions &options) {
+    auto ec = std::error_code();
+    if (options.incremental && !file.path.empty() && std::filesystem::equivalent(file.path, filePath, ec)) {
+        return append_incremental_update(*this, filePath, options);
+    }
+
+    auto file = std::fopen(filePath.c_str(), "wb");
+    if (file == nullptr) {
         return Result::error("Failed to open file for writing: '{}'", filePath);
     }
 
-    return write_to_stream(*this, os);
+    auto s      = OutputBuffer(file);
+    auto result = write_document(*this, s, options);
+    if (!result.has_error()) {
+        result = s.flush();
+    }
+
+    if (std::fclose(file) != 0 && !result.has_error()) {
+        return Result::error("Failed to close file: '{}'", filePath);
+    }
+    return result;
 }
 
 Result Document::write_to_memory(uint8_t *&buffer, size_t &size) {
-    std::stringstream ss;
-    auto error = write_to_stream(*this, ss);
+    auto options        = WriteOptions();
+    options.compression = compression;
+    return write_to_memory(buffer, size, options);
+}
+
+Result Document::write_to_memory(uint8_t *&buffer, size_t &size, const WriteOptions &options) {
+    // the size of the original file is a good estimate for the size of the output
+    auto s     = OutputBuffer(file.sizeInBytes + OUTPUT_BUFFER_SIZE);
+    auto error = write_document(*this, s, options);
     if (error.has_error()) {
         return error;
     }
 
-    auto result = ss.str();
-    size        = result.size();
-    buffer      = (uint8_t *)malloc(size);
-    memcpy(buffer, result.data(), size);
+    // the buffer of the OutputBuffer is handed over directly, which is why it has to be freed with free()
+    buffer = s.release(size);
     return Result::ok();
 }
 
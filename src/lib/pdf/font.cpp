@@ -1,5 +1,6 @@
 #include "font.h"
 
+#include <atomic>
 #include <spdlog/spdlog.h>
 
 #include "pdf/document.h"
@@ -73,6 +74,31 @@ std::optional<CMap *> Font::cmap(Document &document) {
     return cmapStreamOpt.value()->read_cmap(document.allocator);
 }
 
+/// FreeType library of a thread, it is destroyed once the thread has exited and all of its faces have been released
+struct FreeTypeLibrary {
+    FT_Library library = nullptr;
+    /// held by the thread and by every face that has not been released yet, faces might be released on other threads
+    std::atomic<size_t> references = 1;
+
+    static void release(FreeTypeLibrary *freeTypeLibrary) {
+        if (--freeTypeLibrary->references == 0) {
+            FT_Done_FreeType(freeTypeLibrary->library);
+            delete freeTypeLibrary;
+        }
+    }
+};
+
+/// releases the thread's reference to its library when the thread exits
+struct ThreadFreeTypeLibrary {
+    FreeTypeLibrary *freeTypeLibrary = nullptr;
+
+    ~ThreadFreeTypeLibrary() {
+        if (freeTypeLibrary != nullptr) {
+            FreeTypeLibrary::release(freeTypeLibrary);
+        }
+    }
+};
+
 FT_Face Font::load_font_face(Document &document) {
     auto fontFileOpt = font_program(document);
     if (!fontFileOpt.has_value()) {
@@ -82,25 +108,42 @@ FT_Face Font::load_font_face(Document &document) {
 
     auto fontFile = fontFileOpt.value();
 
-    int64_t faceIndex = 0;
-    FT_Library library;
-    auto error = FT_Init_FreeType(&library);
-    if (error != FT_Err_Ok) {
-        spdlog::error("Failed to initialize freetype!");
-        return nullptr;
+    // one library per thread is enough, FreeType libraries can't be shared between threads
+    static thread_local ThreadFreeTypeLibrary threadLibrary;
+    if (threadLibrary.freeTypeLibrary == nullptr) {
+        FT_Library library = nullptr;
+        if (FT_Init_FreeType(&library) != FT_Err_Ok) {
+            spdlog::error("Failed to initialize freetype!");
+            return nullptr;
+        }
+        threadLibrary.freeTypeLibrary          = new FreeTypeLibrary();
+        threadLibrary.freeTypeLibrary->library = library;
     }
+    auto freeTypeLibrary = threadLibrary.freeTypeLibrary;
+
+    int64_t faceIndex = 0;
 
     FT_Face face;
     auto view    = fontFile->decode(document.allocator);
     auto basePtr = view.data();
     auto size    = (int64_t)view.length();
-    error        = FT_New_Memory_Face(library, reinterpret_cast<const FT_Byte *>(basePtr), size, faceIndex, &face);
+    auto error   = FT_New_Memory_Face(freeTypeLibrary->library, reinterpret_cast<const FT_Byte *>(basePtr), size,
+                                      faceIndex, &face);
     if (error != FT_Err_Ok) {
         spdlog::error("Failed to load embedded font program!");
         return nullptr;
     }
 
+    // the generic data of a face is reserved for the client
+    freeTypeLibrary->references++;
+    face->generic.data = freeTypeLibrary;
     return face;
 }
 
+void Font::release_font_face(FT_Face face) {
+    auto freeTypeLibrary = static_cast<FreeTypeLibrary *>(face->generic.data);
+    FT_Done_Face(face);
+    FreeTypeLibrary::release(freeTypeLibrary);
+}
+
 } // namespace pdf
@@ -71,7 +71,10 @@ struct Font : public Dictionary {
 
     /// Character mapping
     std::optional<CMap *> cmap(Document &document);
+    /// the face has to be released with release_font_face()
     FT_Face load_font_face(Document &document);
+    /// releases the face and its reference to the FreeType library of the thread that loaded it
+    static void release_font_face(FT_Face face);
 };
 
 struct FontMap : public Dictionary {
@@ -1,5 +1,6 @@
 #include "md5.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "hex_string.h"
@@ -88,6 +89,162 @@ inline void fill_X_and_apply_padding(std::array<uint32_t, 16> &X, const uint8_t
     }
 }
 
+static inline void md5_transform(std::array<uint32_t, 4> &state, const std::array<uint32_t, 16> &X) {
+    auto A = state[0];
+    auto B = state[1];
+    auto C = state[2];
+    auto D = state[3];
+
+    auto AA = A;
+    auto BB = B;
+    auto CC = C;
+    auto DD = D;
+
+#if USE_ARRAY
+    ROUND1(A, B, C, D, 0, S11, 0);
+    ROUND1(D, A, B, C, 1, S12, 1);
+    ROUND1(C, D, A, B, 2, S13, 2);
+    ROUND1(B, C, D, A, 3, S14, 3);
+    ROUND1(A, B, C, D, 4, S11, 4);
+    ROUND1(D, A, B, C, 5, S12, 5);
+    ROUND1(C, D, A, B, 6, S13, 6);
+    ROUND1(B, C, D, A, 7, S14, 7);
+    ROUND1(A, B, C, D, 8, S11, 8);
+    ROUND1(D, A, B, C, 9, S12, 9);
+    ROUND1(C, D, A, B, 10, S13, 10);
+    ROUND1(B, C, D, A, 11, S14, 11);
+    ROUND1(A, B, C, D, 12, S11, 12);
+    ROUND1(D, A, B, C, 13, S12, 13);
+    ROUND1(C, D, A, B, 14, S13, 14);
+    ROUND1(B, C, D, A, 15, S14, 15);
+
+    ROUND2(A, B, C, D, 1, S21, 16);
+    ROUND2(D, A, B, C, 6, S22, 17);
+    ROUND2(C, D, A, B, 11, S23, 18);
+    ROUND2(B, C, D, A, 0, S24, 19);
+    ROUND2(A, B, C, D, 5, S21, 20);
+    ROUND2(D, A, B, C, 10, S22, 21);
+    ROUND2(C, D, A, B, 15, S23, 22);
+    ROUND2(B, C, D, A, 4, S24, 23);
+    ROUND2(A, B, C, D, 9, S21, 24);
+    ROUND2(D, A, B, C, 14, S22, 25);
+    ROUND2(C, D, A, B, 3, S23, 26);
+    ROUND2(B, C, D, A, 8, S24, 27);
+    ROUND2(A, B, C, D, 13, S21, 28);
+    ROUND2(D, A, B, C, 2, S22, 29);
+    ROUND2(C, D, A, B, 7, S23, 30);
+    ROUND2(B, C, D, A, 12, S24, 31);
+
+    ROUND3(A, B, C, D, 5, S31, 32);
+    ROUND3(D, A, B, C, 8, S32, 33);
+    ROUND3(C, D, A, B, 11, S33, 34);
+    ROUND3(B, C, D, A, 14, S34, 35);
+    ROUND3(A, B, C, D, 1, S31, 36);
+    ROUND3(D, A, B, C, 4, S32, 37);
+    ROUND3(C, D, A, B, 7, S33, 38);
+    ROUND3(B, C, D, A, 10, S34, 39);
+    ROUND3(A, B, C, D, 13, S31, 40);
+    ROUND3(D, A, B, C, 0, S32, 41);
+    ROUND3(C, D, A, B, 3, S33, 42);
+    ROUND3(B, C, D, A, 6, S34, 43);
+    ROUND3(A, B, C, D, 9, S31, 44);
+    ROUND3(D, A, B, C, 12, S32, 45);
+    ROUND3(C, D, A, B, 15, S33, 46);
+    ROUND3(B, C, D, A, 2, S34, 47);
+
+    ROUND4(A, B, C, D, 0, S41, 48);
+    ROUND4(D, A, B, C, 7, S42, 49);
+    ROUND4(C, D, A, B, 14, S43, 50);
+    ROUND4(B, C, D, A, 5, S44, 51);
+    ROUND4(A, B, C, D, 12, S41, 52);
+    ROUND4(D, A, B, C, 3, S42, 53);
+    ROUND4(C, D, A, B, 10, S43, 54);
+    ROUND4(B, C, D, A, 1, S44, 55);
+    ROUND4(A, B, C, D, 8, S41, 56);
+    ROUND4(D, A, B, C, 15, S42, 57);
+    ROUND4(C, D, A, B, 6, S43, 58);
+    ROUND4(B, C, D, A, 13, S44, 59);
+    ROUND4(A, B, C, D, 4, S41, 60);
+    ROUND4(D, A, B, C, 11, S42, 61);
+    ROUND4(C, D, A, B, 2, S43, 62);
+    ROUND4(B, C, D, A, 9, S44, 63);
+#else
+    ROUND1(A, B, C, D, 0, S11, 0xd76aa478);
+    ROUND1(D, A, B, C, 1, S12, 0xe8c7b756);
+    ROUND1(C, D, A, B, 2, S13, 0x242070db);
+    ROUND1(B, C, D, A, 3, S14, 0xc1bdceee);
+    ROUND1(A, B, C, D, 4, S11, 0xf57c0faf);
+    ROUND1(D, A, B, C, 5, S12, 0x4787c62a);
+    ROUND1(C, D, A, B, 6, S13, 0xa8304613);
+    ROUND1(B, C, D, A, 7, S14, 0xfd469501);
+    ROUND1(A, B, C, D, 8, S11, 0x698098d8);
+    ROUND1(D, A, B, C, 9, S12, 0x8b44f7af);
+    ROUND1(C, D, A, B, 10, S13, 0xffff5bb1);
+    ROUND1(B, C, D, A, 11, S14, 0x895cd7be);
+    ROUND1(A, B, C, D, 12, S11, 0x6b901122);
+    ROUND1(D, A, B, C, 13, S12, 0xfd987193);
+    ROUND1(C, D, A, B, 14, S13, 0xa679438e);
+    ROUND1(B, C, D, A, 15, S14, 0x49b40821);
+
+    ROUND2(A, B, C, D, 1, S21, 0xf61e2562);
+    ROUND2(D, A, B, C, 6, S22, 0xc040b340);
+    ROUND2(C, D, A, B, 11, S23, 0x265e5a51);
+    ROUND2(B, C, D, A, 0, S24, 0xe9b6c7aa);
+    ROUND2(A, B, C, D, 5, S21, 0xd62f105d);
+    ROUND2(D, A, B, C, 10, S22, 0x2441453);
+    ROUND2(C, D, A, B, 15, S23, 0xd8a1e681);
+    ROUND2(B, C, D, A, 4, S24, 0xe7d3fbc8);
+    ROUND2(A, B, C, D, 9, S21, 0x21e1cde6);
+    ROUND2(D, A, B, C, 14, S22, 0xc33707d6);
+    ROUND2(C, D, A, B, 3, S23, 0xf4d50d87);
+    ROUND2(B, C, D, A, 8, S24, 0x455a14ed);
+    ROUND2(A, B, C, D, 13, S21, 0xa9e3e905);
+    ROUND2(D, A, B, C, 2, S22, 0xfcefa3f8);
+    ROUND2(C, D, A, B, 7, S23, 0x676f02d9);
+    ROUND2(B, C, D, A, 12, S24, 0x8d2a4c8a);
+
+    ROUND3(A, B, C, D, 5, S31, 0xfffa3942);
+    ROUND3(D, A, B, C, 8, S32, 0x8771f681);
+    ROUND3(C, D, A, B, 11, S33, 0x6d9d6122);
+    ROUND3(B, C, D, A, 14, S34, 0xfde5380c);
+    ROUND3(A, B, C, D, 1, S31, 0xa4beea44);
+    ROUND3(D, A, B, C, 4, S32, 0x4bdecfa9);
+    ROUND3(C, D, A, B, 7, S33, 0xf6bb4b60);
+    ROUND3(B, C, D, A, 10, S34, 0xbebfbc70);
+    ROUND3(A, B, C, D, 13, S31, 0x289b7ec6);
+    ROUND3(D, A, B, C, 0, S32, 0xeaa127fa);
+    ROUND3(C, D, A, B, 3, S33, 0xd4ef3085);
+    ROUND3(B, C, D, A, 6, S34, 0x4881d05);
+    ROUND3(A, B, C, D, 9, S31, 0xd9d4d039);
+    ROUND3(D, A, B, C, 12, S32, 0xe6db99e5);
+    ROUND3(C, D, A, B, 15, S33, 0x1fa27cf8);
+    ROUND3(B, C, D, A, 2, S34, 0xc4ac5665);
+
+    ROUND4(A, B, C, D, 0, S41, 0xf4292244);
+    ROUND4(D, A, B, C, 7, S42, 0x432aff97);
+    ROUND4(C, D, A, B, 14, S43, 0xab9423a7);
+    ROUND4(B, C, D, A, 5, S44, 0xfc93a039);
+    ROUND4(A, B, C, D, 12, S41, 0x655b59c3);
+    ROUND4(D, A, B, C, 3, S42, 0x8f0ccc92);
+    ROUND4(C, D, A, B, 10, S43, 0xffeff47d);
+    ROUND4(B, C, D, A, 1, S44, 0x85845dd1);
+    ROUND4(A, B, C, D, 8, S41, 0x6fa87e4f);
+    ROUND4(D, A, B, C, 15, S42, 0xfe2ce6e0);
+    ROUND4(C, D, A, B, 6, S43, 0xa3014314);
+    ROUND4(B, C, D, A, 13, S44, 0x4e0811a1);
+    ROUND4(A, B, C, D, 4, S41, 0xf7537e82);
+    ROUND4(D, A, B, C, 11, S42, 0xbd3af235);
+    ROUND4(C, D, A, B, 2, S43, 0x2ad7d2bb);
+    ROUND4(B, C, D, A, 9, S44, 0xeb86d391);
+#endif
+    A += AA;
+    B += BB;
+    C += CC;
+    D += DD;
+
+    state = {A, B, C, D};
+}
+
 #define COMPILER_BUG_TEST 0
 
 MD5Hash md5_checksum(const uint8_t *bytes, uint64_t sizeInBytes) {
@@ -103,166 +260,17 @@ MD5Hash md5_checksum(const uint8_t *bytes, uint64_t sizeInBytes) {
 #endif
     uint64_t sizeInBytesFinal = sizeInBytesPadded + 8;
 
-    uint32_t A = 0x67452301;
-    uint32_t B = 0xefcdab89;
-    uint32_t C = 0x98badcfe;
-    uint32_t D = 0x10325476;
+    std::array<uint32_t, 4> state = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
 
     // process input in 16-word (64 byte) chunks
     std::array<uint32_t, 16> X = {};
     for (uint64_t i = 0; i < sizeInBytesFinal / 64; i++) {
         auto offset = i * 64;
         fill_X_and_apply_padding(X, bytes, offset, sizeInBytes, sizeInBytesPadded);
-
-        auto AA = A;
-        auto BB = B;
-        auto CC = C;
-        auto DD = D;
-
-#if USE_ARRAY
-        ROUND1(A, B, C, D, 0, S11, 0);
-        ROUND1(D, A, B, C, 1, S12, 1);
-        ROUND1(C, D, A, B, 2, S13, 2);
-        ROUND1(B, C, D, A, 3, S14, 3);
-        ROUND1(A, B, C, D, 4, S11, 4);
-        ROUND1(D, A, B, C, 5, S12, 5);
-        ROUND1(C, D, A, B, 6, S13, 6);
-        ROUND1(B, C, D, A, 7, S14, 7);
-        ROUND1(A, B, C, D, 8, S11, 8);
-        ROUND1(D, A, B, C, 9, S12, 9);
-        ROUND1(C, D, A, B, 10, S13, 10);
-        ROUND1(B, C, D, A, 11, S14, 11);
-        ROUND1(A, B, C, D, 12, S11, 12);
-        ROUND1(D, A, B, C, 13, S12, 13);
-        ROUND1(C, D, A, B, 14, S13, 14);
-        ROUND1(B, C, D, A, 15, S14, 15);
-
-        ROUND2(A, B, C, D, 1, S21, 16);
-        ROUND2(D, A, B, C, 6, S22, 17);
-        ROUND2(C, D, A, B, 11, S23, 18);
-        ROUND2(B, C, D, A, 0, S24, 19);
-        ROUND2(A, B, C, D, 5, S21, 20);
-        ROUND2(D, A, B, C, 10, S22, 21);
-        ROUND2(C, D, A, B, 15, S23, 22);
-        ROUND2(B, C, D, A, 4, S24, 23);
-        ROUND2(A, B, C, D, 9, S21, 24);
-        ROUND2(D, A, B, C, 14, S22, 25);
-        ROUND2(C, D, A, B, 3, S23, 26);
-        ROUND2(B, C, D, A, 8, S24, 27);
-        ROUND2(A, B, C, D, 13, S21, 28);
-        ROUND2(D, A, B, C, 2, S22, 29);
-        ROUND2(C, D, A, B, 7, S23, 30);
-        ROUND2(B, C, D, A, 12, S24, 31);
-
-        ROUND3(A, B, C, D, 5, S31, 32);
-        ROUND3(D, A, B, C, 8, S32, 33);
-        ROUND3(C, D, A, B, 11, S33, 34);
-        ROUND3(B, C, D, A, 14, S34, 35);
-        ROUND3(A, B, C, D, 1, S31, 36);
-        ROUND3(D, A, B, C, 4, S32, 37);
-        ROUND3(C, D, A, B, 7, S33, 38);
-        ROUND3(B, C, D, A, 10, S34, 39);
-        ROUND3(A, B, C, D, 13, S31, 40);
-        ROUND3(D, A, B, C, 0, S32, 41);
-        ROUND3(C, D, A, B, 3, S33, 42);
-        ROUND3(B, C, D, A, 6, S34, 43);
-        ROUND3(A, B, C, D, 9, S31, 44);
-        ROUND3(D, A, B, C, 12, S32, 45);
-        ROUND3(C, D, A, B, 15, S33, 46);
-        ROUND3(B, C, D, A, 2, S34, 47);
-
-        ROUND4(A, B, C, D, 0, S41, 48);
-        ROUND4(D, A, B, C, 7, S42, 49);
-        ROUND4(C, D, A, B, 14, S43, 50);
-        ROUND4(B, C, D, A, 5, S44, 51);
-        ROUND4(A, B, C, D, 12, S41, 52);
-        ROUND4(D, A, B, C, 3, S42, 53);
-        ROUND4(C, D, A, B, 10, S43, 54);
-        ROUND4(B, C, D, A, 1, S44, 55);
-        ROUND4(A, B, C, D, 8, S41, 56);
-        ROUND4(D, A, B, C, 15, S42, 57);
-        ROUND4(C, D, A, B, 6, S43, 58);
-        ROUND4(B, C, D, A, 13, S44, 59);
-        ROUND4(A, B, C, D, 4, S41, 60);
-        ROUND4(D, A, B, C, 11, S42, 61);
-        ROUND4(C, D, A, B, 2, S43, 62);
-        ROUND4(B, C, D, A, 9, S44, 63);
-#else
-        ROUND1(A, B, C, D, 0, S11, 0xd76aa478);
-        ROUND1(D, A, B, C, 1, S12, 0xe8c7b756);
-        ROUND1(C, D, A, B, 2, S13, 0x242070db);
-        ROUND1(B, C, D, A, 3, S14, 0xc1bdceee);
-        ROUND1(A, B, C, D, 4, S11, 0xf57c0faf);
-        ROUND1(D, A, B, C, 5, S12, 0x4787c62a);
-        ROUND1(C, D, A, B, 6, S13, 0xa8304613);
-        ROUND1(B, C, D, A, 7, S14, 0xfd469501);
-        ROUND1(A, B, C, D, 8, S11, 0x698098d8);
-        ROUND1(D, A, B, C, 9, S12, 0x8b44f7af);
-        ROUND1(C, D, A, B, 10, S13, 0xffff5bb1);
-        ROUND1(B, C, D, A, 11, S14, 0x895cd7be);
-        ROUND1(A, B, C, D, 12, S11, 0x6b901122);
-        ROUND1(D, A, B, C, 13, S12, 0xfd987193);
-        ROUND1(C, D, A, B, 14, S13, 0xa679438e);
-        ROUND1(B, C, D, A, 15, S14, 0x49b40821);
-
-        ROUND2(A, B, C, D, 1, S21, 0xf61e2562);
-        ROUND2(D, A, B, C, 6, S22, 0xc040b340);
-        ROUND2(C, D, A, B, 11, S23, 0x265e5a51);
-        ROUND2(B, C, D, A, 0, S24, 0xe9b6c7aa);
-        ROUND2(A, B, C, D, 5, S21, 0xd62f105d);
-        ROUND2(D, A, B, C, 10, S22, 0x2441453);
-        ROUND2(C, D, A, B, 15, S23, 0xd8a1e681);
-        ROUND2(B, C, D, A, 4, S24, 0xe7d3fbc8);
-        ROUND2(A, B, C, D, 9, S21, 0x21e1cde6);
-        ROUND2(D, A, B, C, 14, S22, 0xc33707d6);
-        ROUND2(C, D, A, B, 3, S23, 0xf4d50d87);
-        ROUND2(B, C, D, A, 8, S24, 0x455a14ed);
-        ROUND2(A, B, C, D, 13, S21, 0xa9e3e905);
-        ROUND2(D, A, B, C, 2, S22, 0xfcefa3f8);
-        ROUND2(C, D, A, B, 7, S23, 0x676f02d9);
-        ROUND2(B, C, D, A, 12, S24, 0x8d2a4c8a);
-
-        ROUND3(A, B, C, D, 5, S31, 0xfffa3942);
-        ROUND3(D, A, B, C, 8, S32, 0x8771f681);
-        ROUND3(C, D, A, B, 11, S33, 0x6d9d6122);
-        ROUND3(B, C, D, A, 14, S34, 0xfde5380c);
-        ROUND3(A, B, C, D, 1, S31, 0xa4beea44);
-        ROUND3(D, A, B, C, 4, S32, 0x4bdecfa9);
-        ROUND3(C, D, A, B, 7, S33, 0xf6bb4b60);
-        ROUND3(B, C, D, A, 10, S34, 0xbebfbc70);
-        ROUND3(A, B, C, D, 13, S31, 0x289b7ec6);
-        ROUND3(D, A, B, C, 0, S32, 0xeaa127fa);
-        ROUND3(C, D, A, B, 3, S33, 0xd4ef3085);
-        ROUND3(B, C, D, A, 6, S34, 0x4881d05);
-        ROUND3(A, B, C, D, 9, S31, 0xd9d4d039);
-        ROUND3(D, A, B, C, 12, S32, 0xe6db99e5);
-        ROUND3(C, D, A, B, 15, S33, 0x1fa27cf8);
-        ROUND3(B, C, D, A, 2, S34, 0xc4ac5665);
-
-        ROUND4(A, B, C, D, 0, S41, 0xf4292244);
-        ROUND4(D, A, B, C, 7, S42, 0x432aff97);
-        ROUND4(C, D, A, B, 14, S43, 0xab9423a7);
-        ROUND4(B, C, D, A, 5, S44, 0xfc93a039);
-        ROUND4(A, B, C, D, 12, S41, 0x655b59c3);
-        ROUND4(D, A, B, C, 3, S42, 0x8f0ccc92);
-        ROUND4(C, D, A, B, 10, S43, 0xffeff47d);
-        ROUND4(B, C, D, A, 1, S44, 0x85845dd1);
-        ROUND4(A, B, C, D, 8, S41, 0x6fa87e4f);
-        ROUND4(D, A, B, C, 15, S42, 0xfe2ce6e0);
-        ROUND4(C, D, A, B, 6, S43, 0xa3014314);
-        ROUND4(B, C, D, A, 13, S44, 0x4e0811a1);
-        ROUND4(A, B, C, D, 4, S41, 0xf7537e82);
-        ROUND4(D, A, B, C, 11, S42, 0xbd3af235);
-        ROUND4(C, D, A, B, 2, S43, 0x2ad7d2bb);
-        ROUND4(B, C, D, A, 9, S44, 0xeb86d391);
-#endif
-        A += AA;
-        B += BB;
-        C += CC;
-        D += DD;
+        md5_transform(state, X);
     }
 
-    std::array<uint32_t, 4> output = {A, B, C, D};
+    std::array<uint32_t, 4> output = state;
     //    std::array<uint8_t, 16> output = {};
     //    for (unsigned int i = 0, j = 0; j < 16; i++, j += 4) {
     //        output[j]     = (unsigned char)(input[i] & 0xff);
@@ -274,4 +282,46 @@ MD5Hash md5_checksum(const uint8_t *bytes, uint64_t sizeInBytes) {
     return output;
 }
 
+void MD5Context::update(const uint8_t *bytes, uint64_t sizeInBytes) {
+    auto bufferOffset = totalSizeInBytes % 64;
+    totalSizeInBytes += sizeInBytes;
+
+    if (bufferOffset != 0) {
+        auto count = std::min(64 - bufferOffset, sizeInBytes);
+        std::memcpy((uint8_t *)buffer.data() + bufferOffset, bytes, count);
+        bytes += count;
+        sizeInBytes -= count;
+        if (bufferOffset + count < 64) {
+            return;
+        }
+        md5_transform(state, buffer);
+    }
+
+    std::array<uint32_t, 16> X = {};
+    while (sizeInBytes >= 64) {
+        std::memcpy(X.data(), bytes, 64);
+        md5_transform(state, X);
+        bytes += 64;
+        sizeInBytes -= 64;
+    }
+
+    std::memcpy(buffer.data(), bytes, sizeInBytes);
+}
+
+MD5Hash MD5Context::finish() {
+    auto bufferOffset         = totalSizeInBytes % 64;
+    auto *bufferBytes         = (uint8_t *)buffer.data();
+    bufferBytes[bufferOffset] = 0b10000000;
+    std::memset(bufferBytes + bufferOffset + 1, 0, 64 - bufferOffset - 1);
+    if (bufferOffset >= 56) {
+        md5_transform(state, buffer);
+        std::memset(bufferBytes, 0, 64);
+    }
+
+    uint64_t sizeInBits = totalSizeInBytes << 3;
+    std::memcpy(bufferBytes + 56, &sizeInBits, sizeof(sizeInBits));
+    md5_transform(state, buffer);
+    return state;
+}
+
 } // namespace pdf::hash
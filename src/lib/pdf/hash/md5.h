@@ -13,4 +13,15 @@ typedef std::array<uint32_t, 4> MD5Hash;
 MD5Hash md5_checksum(const std::string &str);
 MD5Hash md5_checksum(const uint8_t *bytes, uint64_t sizeInBytes);
 
+/// incremental version of md5_checksum for data that arrives in chunks
+struct MD5Context {
+    void update(const uint8_t *bytes, uint64_t sizeInBytes);
+    MD5Hash finish();
+
+  private:
+    std::array<uint32_t, 4> state   = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    std::array<uint32_t, 16> buffer = {};
+    uint64_t totalSizeInBytes       = 0;
+};
+
 } // namespace pdf::hash
@@ -51,8 +51,11 @@ struct BmpInfoHeader {
 #pragma pack(pop)
 
 Result Image::write_bmp(Allocator &allocator, const std::string &fileName) const {
-    auto pixels = stream->decode(allocator);
-    auto temp   = allocator.temporary();
+    // the decoded pixels are only needed for writing the file, so they are not kept in the document
+    auto scope  = PageArenaScope(allocator);
+    auto pixels = stream->decode(allocator, allocator.page());
+    stream->forget_decoded_data(scope.start_position(), allocator.page().current_buffer_position());
+    auto temp = allocator.temporary();
 
     BmpInfoHeader infoHeader = {};
     infoHeader.width         = width;
@@ -80,7 +83,7 @@ Result Image::write_bmp(Allocator &allocator, const std::string &fileName) const
     auto pixelsSize     = static_cast<size_t>(paddedRowSize * height);
     ASSERT(pixels.size() == static_cast<size_t>(currentRowSize * height));
 
-    auto pBuf = temp.arena().push(pixelsSize);
+    auto pBuf = temp.arena().push(pixelsSize, CACHE_LINE_SIZE);
     std::memset(pBuf, 0, pixelsSize);
 
     auto padding = paddedRowSize - currentRowSize;
@@ -136,7 +139,7 @@ ValueResult<Image *> Image::read_bmp(Allocator &allocator, const std::string &fi
     file.read(reinterpret_cast<char *>(&infoHeader), infoHeaderSize);
 
     uint32_t pixelSize = fileHeader.fileSizeInBytes - fileHeader.pixelOffset;
-    auto pixels        = allocator.arena().push(pixelSize);
+    auto pixels        = allocator.arena().push(pixelSize, CACHE_LINE_SIZE);
     file.read(reinterpret_cast<char *>(pixels), pixelSize);
 
     // TODO flip BGR to RGB and remove padding
@@ -1,13 +1,14 @@
 #include "lexer.h"
 
 #include <array>
+#include <cstring>
 #include <iostream>
 #include <spdlog/spdlog.h>
 #include <string>
 
 namespace pdf {
 
-static std::array<std::string, 59> operators = {
+static std::array<std::string, 62> operators = {
       // Unsorted Operators
       "SCN", "SC", "scn", "sc",
       // Text Operators
@@ -17,18 +18,21 @@ static std::array<std::string, 59> operators = {
       // Path Construction Operators
       "m", "l", "c", "v", "y", "h", "re",
       // Path Painting Operators
-      "S", "s", "f*", "F", "f", "B*", "B", "b*", "b", "n",
+      "S", "s", "f*", "F", "f", "BI", "B*", "B", "b*", "b", "n",
       // Clipping Path Operators
       "W*", "W",
       // Unsorted Operators
       "Tj", "TJ", "d0", "d1", "CS", "G", "g", "RG", "rg", "K", "k",
-      "Do", //
+      "Do",
+      // Inline Image Operators ("BI" is listed above, because it has to be matched before "B")
+      "ID", "EI", //
 };
 
 bool is_lower_letter(char c) { return c >= 'a' && c <= 'z'; }
 bool is_upper_letter(char c) { return c >= 'A' && c <= 'Z'; }
 bool is_letter(char c) { return is_lower_letter(c) || is_upper_letter(c); }
 bool is_digit(char c) { return c >= '0' && c <= '9'; }
+bool is_whitespace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\000'; }
 
 std::string_view removeLeadingWhitespace(const std::string_view &str) {
     std::string_view result = str;
@@ -298,21 +302,21 @@ std::optional<Token> matchIndirectReference(const std::string_view &word) {
 }
 
 std::optional<Token> matchObjectStart(const std::string_view &word) {
-    int idx = 0;
-    while (is_digit(word[idx])) {
+    size_t idx = 0;
+    while (idx < word.size() && is_digit(word[idx])) {
         idx++;
     }
 
-    if (word[idx] != ' ') {
+    if (idx >= word.size() || word[idx] != ' ') {
         return {};
     }
     idx++;
 
-    while (is_digit(word[idx])) {
+    while (idx < word.size() && is_digit(word[idx])) {
         idx++;
     }
 
-    if (word[idx] != ' ') {
+    if (idx >= word.size() || word[idx] != ' ') {
         return {};
     }
     idx++;
@@ -326,13 +330,13 @@ std::optional<Token> matchObjectStart(const std::string_view &word) {
 }
 
 std::optional<Token> matchHexadecimalString(const std::string_view &word) {
-    int idx = 0;
+    size_t idx = 0;
     if (word[idx] != '<') {
         return {};
     }
     idx++;
 
-    while (word[idx] != '>') {
+    while (idx < word.size() && word[idx] != '>') {
         if (!is_letter(word[idx])   //
             && !is_digit(word[idx]) //
             && word[idx] != ' '     //
@@ -345,21 +349,26 @@ std::optional<Token> matchHexadecimalString(const std::string_view &word) {
         }
         idx++;
     }
+    if (idx >= word.size()) {
+        // the string is not terminated (yet)
+        return {};
+    }
     idx++;
 
     return Token(Token::Type::HEXADECIMAL_STRING, word.substr(0, idx));
 }
 
 std::optional<Token> matchName(const std::string_view &word) {
-    int idx = 0;
+    size_t idx = 0;
     if (word[idx] != '/') {
         return {};
     }
     idx++;
 
-    while (word[idx] != ' ' && word[idx] != '[' && word[idx] != ']' && word[idx] != '(' && word[idx] != ')' &&
-           word[idx] != '{' && word[idx] != '}' && word[idx] != '/' && word[idx] != '<' && word[idx] != '>' &&
-           word[idx] != '\r' && word[idx] != '\n' && word[idx] != '\t' && word[idx] != '\f' && word[idx] != '\v') {
+    while (idx < word.size() && word[idx] != ' ' && word[idx] != '[' && word[idx] != ']' && word[idx] != '(' &&
+           word[idx] != ')' && word[idx] != '{' && word[idx] != '}' && word[idx] != '/' && word[idx] != '<' &&
+           word[idx] != '>' && word[idx] != '\r' && word[idx] != '\n' && word[idx] != '\t' && word[idx] != '\f' &&
+           word[idx] != '\v') {
         idx++;
     }
 
@@ -438,7 +447,12 @@ std::optional<Token> findToken(const std::string_view &word) {
     return {};
 }
 
+/// some tokens (e.g. indirect references) can only be told apart from others by looking at the text that follows them
+const size_t TOKEN_LOOKAHEAD = 64;
+
 std::optional<Token> TextLexer::get_token() {
+    textMoved                     = false;
+    droppedBytes                  = 0;
     std::string_view previousWord = currentWord;
     while (true) {
         if (currentWord.empty()) {
@@ -446,20 +460,40 @@ std::optional<Token> TextLexer::get_token() {
             if (!optionalCode.has_value()) {
                 break;
             }
-            currentWord = optionalCode.value();
+            currentWord  = optionalCode.value();
+            textStart    = currentWord.data();
+            retainedText = textStart;
             if (currentWord.empty()) {
                 continue;
             }
         }
 
         currentWord = removeLeadingWhitespace(currentWord);
+        if (currentWord.size() < TOKEN_LOOKAHEAD && fetch_more_text()) {
+            continue;
+        }
 
         auto token = findToken(currentWord);
         if (token.has_value()) {
+            if (token.value().content.size() == currentWord.size() && fetch_more_text()) {
+                // the token might continue in the next chunk
+                continue;
+            }
+
             currentWord = currentWord.substr(token.value().content.length(), currentWord.length() - 1);
+            if (token.value().type == Token::Type::OPERATOR && token.value().content != "BI" &&
+                token.value().content != "ID") {
+                // the dictionary and the data of an inline image are kept until the "EI" operator
+                retainedText = currentWord.data();
+            }
             return token;
         }
 
+        if (fetch_more_text()) {
+            // the token might be incomplete
+            continue;
+        }
+
         if (currentWord == previousWord) {
             break;
         }
@@ -473,9 +507,114 @@ std::optional<Token> TextLexer::get_token() {
     return {};
 }
 
+bool TextLexer::fetch_more_text() {
+    if (!hasMoreText) {
+        return false;
+    }
+
+    // only offsets are carried over, the old text might have been freed by the text provider
+    const auto retainedOffset    = static_cast<size_t>(retainedText - textStart);
+    const auto currentWordOffset = static_cast<size_t>(currentWord.data() - retainedText);
+    const auto retained          = std::string_view(retainedText, currentWordOffset + currentWord.size());
+    auto text                    = textProvider.get_text_continuing(retained);
+    if (!text.has_value()) {
+        hasMoreText = false;
+        return false;
+    }
+
+    textMoved = true;
+    droppedBytes += retainedOffset;
+    textStart    = text.value().data();
+    retainedText = textStart;
+    currentWord  = text.value().substr(currentWordOffset);
+    return true;
+}
+
+/// Finds the "EI" operator that ends the data of an inline image, starting at the given offset. "EI" has to be
+/// surrounded by whitespace, otherwise it is part of the data. Returns the offset of the whitespace in front of "EI".
+static std::optional<size_t> find_end_of_inline_image(std::string_view text, size_t offset, bool isComplete) {
+    while (offset < text.size()) {
+        // memchr is vectorized, which makes skipping large images cheap
+        auto e = static_cast<const char *>(std::memchr(text.data() + offset, 'E', text.size() - offset));
+        if (e == nullptr) {
+            return {};
+        }
+
+        const auto idx = static_cast<size_t>(e - text.data());
+        if (idx + 2 >= text.size() && !isComplete) {
+            // the character after "EI" is not known yet
+            return {};
+        }
+        if ((idx == 0 || is_whitespace(text[idx - 1])) && idx + 1 < text.size() && text[idx + 1] == 'I' &&
+            (idx + 2 == text.size() || is_whitespace(text[idx + 2]))) {
+            return idx == 0 ? 0 : idx - 1;
+        }
+        offset = idx + 1;
+    }
+    return {};
+}
+
+/// checks whether the given text starts with "EI" (after optional whitespace)
+static bool starts_with_end_of_inline_image(std::string_view text) {
+    size_t idx = 0;
+    while (idx < text.size() && is_whitespace(text[idx])) {
+        idx++;
+    }
+    return starts_with(text.substr(idx), "EI") && (idx + 2 == text.size() || is_whitespace(text[idx + 2]));
+}
+
+std::string_view TextLexer::advance_inline_image_data(size_t expectedSize) {
+    textMoved    = false;
+    droppedBytes = 0;
+    if (currentWord.empty()) {
+        fetch_more_text();
+    }
+    // "ID" is followed by a single whitespace character
+    if (!currentWord.empty() && is_whitespace(currentWord[0])) {
+        currentWord = currentWord.substr(1);
+    }
+
+    if (expectedSize > 0) {
+        while (currentWord.size() < expectedSize + TOKEN_LOOKAHEAD && fetch_more_text()) {
+            // the data continues in the next chunk
+        }
+        if (currentWord.size() >= expectedSize && starts_with_end_of_inline_image(currentWord.substr(expectedSize))) {
+            auto data   = currentWord.substr(0, expectedSize);
+            currentWord = currentWord.substr(expectedSize);
+            return data;
+        }
+        // the size from the dictionary is wrong, fall back to searching for "EI"
+    }
+
+    size_t offset = 0;
+    while (true) {
+        const auto isComplete = !hasMoreText;
+        auto end              = find_end_of_inline_image(currentWord, offset, isComplete);
+        if (end.has_value()) {
+            auto data   = currentWord.substr(0, end.value());
+            currentWord = currentWord.substr(end.value());
+            return data;
+        }
+        if (isComplete) {
+            break;
+        }
+
+        // "EI" might cross the boundary between two chunks
+        offset = currentWord.size() >= 3 ? currentWord.size() - 3 : 0;
+        fetch_more_text();
+    }
+
+    // "EI" is missing, everything that is left belongs to the image
+    auto data   = currentWord;
+    currentWord = currentWord.substr(currentWord.size());
+    return data;
+}
+
 std::string_view TextLexer::advance_stream(size_t characters) {
+    while (currentWord.length() <= characters && fetch_more_text()) {
+        // the stream continues in the next chunk
+    }
     if (currentWord.length() <= characters) {
-        // TODO fetch more text from the textProvider
         return {};
     }
 
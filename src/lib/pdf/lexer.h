@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <optional>
 #include <string>
 #include <utility>
@@ -71,6 +72,10 @@ struct Token {
 
 struct TextProvider {
     virtual std::optional<std::string_view> get_text() = 0;
+    /// Returns the given rest of the previously returned text followed by the next chunk of text in one contiguous
+    /// piece, which allows the lexer to finish tokens that cross the boundary between two chunks. Providers that return
+    /// all of their text at once have nothing to add.
+    virtual std::optional<std::string_view> get_text_continuing(std::string_view /*rest*/) { return {}; }
 };
 
 struct StringTextProvider : public TextProvider {
@@ -93,16 +98,42 @@ struct StringTextProvider : public TextProvider {
 struct Lexer {
     virtual std::optional<Token> get_token()                   = 0;
     virtual std::string_view advance_stream(size_t characters) = 0;
+    /// start of the text that the returned tokens point into, nullptr if the tokens do not come from a single text
+    virtual const char *text_start() { return nullptr; }
+    /// Whether the text has been replaced during the last call to get_token() or advance_inline_image_data(). The text
+    /// after the last OPERATOR token is kept at the start of the new text, a token that has been returned earlier at
+    /// offset o from the old text_start() is at offset o - dropped() from the new one.
+    virtual bool text_moved() { return false; }
+    /// number of bytes that have been dropped from the start of the text when it has been replaced
+    virtual size_t dropped() { return 0; }
+    /// Skips the binary data of an inline image, which follows the "ID" operator, and returns it. The data is not
+    /// tokenized. The expected size is used if it is known (non-zero), otherwise the data ends in front of "EI".
+    virtual std::string_view advance_inline_image_data(size_t /*expectedSize*/) { return {}; }
 };
 
 struct TextLexer : public Lexer {
     TextProvider &textProvider;
     std::string_view currentWord;
+    /// start of the text that has been returned by the text provider
+    const char *textStart = nullptr;
+    /// start of the text that is kept when more text is fetched from the text provider (everything after the last
+    /// OPERATOR token)
+    const char *retainedText = nullptr;
+    size_t droppedBytes      = 0;
+    bool textMoved           = false;
+    bool hasMoreText         = true;
 
     explicit TextLexer(TextProvider &_textProvider) : textProvider(_textProvider) {}
 
     std::optional<Token> get_token() override;
     std::string_view advance_stream(size_t characters) override;
+    const char *text_start() override { return textStart; }
+    bool text_moved() override { return textMoved; }
+    size_t dropped() override { return droppedBytes; }
+    std::string_view advance_inline_image_data(size_t expectedSize) override;
+
+  private:
+    bool fetch_more_text();
 };
 
 struct TokenLexer : public Lexer {
@@ -1,5 +1,7 @@
 #include "arena_allocator.h"
 
+#include <algorithm>
+
 namespace pdf {
 
 #if WIN32
@@ -21,6 +23,27 @@ Result ReserveMemory(uint8_t *buffer, size_t sizeInBytes) {
     VirtualAlloc(buffer, sizeInBytes, MEM_COMMIT, PAGE_READWRITE);
     return Result::ok();
 }
+Result DecommitMemory(uint8_t *buffer, size_t sizeInBytes) {
+    if (!VirtualFree(buffer, sizeInBytes, MEM_DECOMMIT)) {
+        return Result::error("failed to decommit memory of size {}", sizeInBytes);
+    }
+    return Result::ok();
+}
+// TODO large pages (MEM_LARGE_PAGES) require SeLockMemoryPrivilege and have to be committed when they are reserved
+PtrResult ReserveHugePageAddressRange(size_t sizeInBytes, ArenaPages &pages) {
+    pages = ArenaPages::NORMAL;
+    return ReserveAddressRange(sizeInBytes);
+}
+Result ReserveHugeTlbMemory(uint8_t *buffer, size_t sizeInBytes) {
+    (void)buffer;
+    return Result::error("huge page pool is not supported, failed to reserve memory of size {}", sizeInBytes);
+}
+Result DecommitHugeTlbMemory(uint8_t *buffer, size_t sizeInBytes) { return DecommitMemory(buffer, sizeInBytes); }
+Result AdviseHugePages(uint8_t *buffer, size_t sizeInBytes) {
+    (void)buffer;
+    (void)sizeInBytes;
+    return Result::error("transparent huge pages are not supported");
+}
 #else
 #include <sys/mman.h>
 PtrResult ReserveAddressRange(size_t sizeInBytes) {
@@ -99,6 +122,74 @@ Result ReserveMemory(uint8_t *buffer, size_t sizeInBytes) {
 
     return Result::error("failed to reserve memory of size {}", sizeInBytes);
 }
+
+Result DecommitMemory(uint8_t *buffer, size_t sizeInBytes) {
+    // the pages are dropped right away (instead of MADV_FREE), so that the resident size goes down immediately
+    if (madvise(buffer, sizeInBytes, MADV_DONTNEED) != 0) {
+        return Result::error("madvise failed: {}", errno);
+    }
+    // accessing the memory again without pushing first is a bug, this makes it crash instead of silently working
+    if (mprotect(buffer, sizeInBytes, PROT_NONE) != 0) {
+        return Result::error("mprotect failed: {}", errno);
+    }
+    return Result::ok();
+}
+
+/// the advice sticks to the mapping, so it also applies to the parts that are made accessible later on
+Result AdviseHugePages(uint8_t *buffer, size_t sizeInBytes) {
+    if (madvise(buffer, sizeInBytes, MADV_HUGEPAGE) != 0) {
+        return Result::error("madvise failed: {}", errno);
+    }
+    return Result::ok();
+}
+
+/// Reserves an address range that starts on a huge page boundary and asks for transparent huge pages. pages is set to
+/// NORMAL if the kernel does not support them.
+PtrResult ReserveHugePageAddressRange(size_t sizeInBytes, ArenaPages &pages) {
+    // mmap only guarantees alignment to the base page size, the unaligned head and tail are unmapped again
+    auto result = ReserveAddressRange(sizeInBytes + HUGE_PAGE_SIZE);
+    if (result.has_error()) {
+        return PtrResult::error(result.message());
+    }
+
+    const auto start   = result.value();
+    const auto aligned = start + (static_cast<size_t>(-reinterpret_cast<uintptr_t>(start)) & (HUGE_PAGE_SIZE - 1));
+    if (aligned != start) {
+        munmap(start, aligned - start);
+    }
+    const auto tailSize = (start + sizeInBytes + HUGE_PAGE_SIZE) - (aligned + sizeInBytes);
+    if (tailSize != 0) {
+        munmap(aligned + sizeInBytes, tailSize);
+    }
+
+    auto adviseResult = AdviseHugePages(aligned, sizeInBytes);
+    if (adviseResult.has_error()) {
+        spdlog::debug("Transparent huge pages are not available: {}", adviseResult.message());
+        pages = ArenaPages::NORMAL;
+    }
+    return PtrResult::ok(aligned);
+}
+
+/// Replaces the given part of a reservation with pages from the huge page pool. The pool is reserved for the mapping
+/// right away, which makes this fail cleanly (instead of crashing on first access) if there are not enough huge pages.
+Result ReserveHugeTlbMemory(uint8_t *buffer, size_t sizeInBytes) {
+    const auto ptr = mmap(buffer, sizeInBytes, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return Result::error("failed to map huge pages: {}", errno);
+    }
+    return Result::ok();
+}
+
+/// Gives pages from the huge page pool back by replacing them with an inaccessible reservation again
+Result DecommitHugeTlbMemory(uint8_t *buffer, size_t sizeInBytes) {
+    const auto ptr =
+          mmap(buffer, sizeInBytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return Result::error("failed to unmap huge pages: {}", errno);
+    }
+    return Result::ok();
+}
 #endif
 
 ValueResult<Arena> Arena::create() {
@@ -114,40 +205,62 @@ ValueResult<Arena> Arena::create(size_t maximumSizeInBytes, size_t page_size_in_
     return ValueResult<Arena>::ok(result.value(), maximumSizeInBytes, page_size_in_bytes);
 }
 
-Arena::Arena(uint8_t *_buffer, const size_t _maximumSizeInBytes, const size_t _pageSize) {
+ValueResult<Arena> Arena::create(ArenaPages pages) {
+    if (pages == ArenaPages::NORMAL) {
+        return create();
+    }
+
+    constexpr size_t GB = 1024 * 1024 * 1024;
+    auto result         = ReserveHugePageAddressRange(128 * GB, pages);
+    if (result.has_error()) {
+        return ValueResult<Arena>::error(result.message());
+    }
+    return ValueResult<Arena>::ok(result.value(), 128 * GB, HUGE_ARENA_PAGE_SIZE, pages);
+}
+
+Arena::Arena(uint8_t *_buffer, const size_t _maximumSizeInBytes, const size_t _pageSize, const ArenaPages _pages) {
     page_size_in_bytes     = _pageSize;
+    pages                  = _pages;
     virtual_size_in_bytes  = _maximumSizeInBytes;
     buffer_start           = _buffer;
     buffer_position        = buffer_start;
     reserved_size_in_bytes = 0;
 }
 
-Arena::Arena(Arena &&other) {
-    buffer_start           = other.buffer_start;
-    buffer_position        = other.buffer_position;
-    virtual_size_in_bytes  = other.virtual_size_in_bytes;
-    reserved_size_in_bytes = other.reserved_size_in_bytes;
-    page_size_in_bytes     = other.page_size_in_bytes;
-
-    other.buffer_start           = nullptr;
-    other.buffer_position        = nullptr;
-    other.virtual_size_in_bytes  = 0;
-    other.reserved_size_in_bytes = 0;
-    other.page_size_in_bytes     = 0;
-}
+Arena::Arena(Arena &&other) { *this = std::move(other); }
 
 Arena &Arena::operator=(Arena &&other) {
-    buffer_start           = other.buffer_start;
-    buffer_position        = other.buffer_position;
-    virtual_size_in_bytes  = other.virtual_size_in_bytes;
-    reserved_size_in_bytes = other.reserved_size_in_bytes;
-    page_size_in_bytes     = other.page_size_in_bytes;
-
-    other.buffer_start           = nullptr;
-    other.buffer_position        = nullptr;
-    other.virtual_size_in_bytes  = 0;
-    other.reserved_size_in_bytes = 0;
-    other.page_size_in_bytes     = 0;
+    if (this == &other) {
+        return *this;
+    }
+    if (buffer_start != nullptr) {
+        // the reservation of this arena is replaced by the one of other, it would be leaked otherwise
+        ReleaseAddressRange(buffer_start, virtual_size_in_bytes);
+    }
+
+    buffer_start            = other.buffer_start;
+    buffer_position         = other.buffer_position;
+    virtual_size_in_bytes   = other.virtual_size_in_bytes;
+    reserved_size_in_bytes  = other.reserved_size_in_bytes;
+    page_size_in_bytes      = other.page_size_in_bytes;
+    peak_used_size_in_bytes = other.peak_used_size_in_bytes;
+    allocation_count        = other.allocation_count;
+    current_tag             = other.current_tag;
+    tagged_sizes_in_bytes   = other.tagged_sizes_in_bytes;
+    pages                   = other.pages;
+    huge_tlb_size_in_bytes  = other.huge_tlb_size_in_bytes;
+
+    other.buffer_start            = nullptr;
+    other.buffer_position         = nullptr;
+    other.virtual_size_in_bytes   = 0;
+    other.reserved_size_in_bytes  = 0;
+    other.page_size_in_bytes      = 0;
+    other.peak_used_size_in_bytes = 0;
+    other.allocation_count        = 0;
+    other.current_tag             = AllocationTag::OTHER;
+    other.tagged_sizes_in_bytes   = {};
+    other.pages                   = ArenaPages::NORMAL;
+    other.huge_tlb_size_in_bytes  = 0;
 
     return *this;
 }
@@ -166,26 +279,99 @@ Arena::~Arena() {
     page_size_in_bytes     = 0;
 }
 
-uint8_t *Arena::push(size_t allocationSizeInBytes) {
+uint8_t *Arena::push(size_t allocationSizeInBytes, size_t alignment) {
     ASSERT(buffer_start != nullptr);
+#ifndef NDEBUG
+    ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+#endif
+
+    // buffer_start is page aligned, so aligning the position also aligns the address
+    const auto padding  = static_cast<size_t>(-reinterpret_cast<uintptr_t>(buffer_position)) & (alignment - 1);
+    const auto pushSize = padding + allocationSizeInBytes;
+    if (!ensure_reserved(pushSize)) {
+        return nullptr;
+    }
+
+    const auto result = buffer_position + padding;
+    buffer_position += pushSize;
 
-    if (buffer_start + reserved_size_in_bytes < buffer_position + allocationSizeInBytes) {
-        const auto pageCount          = (allocationSizeInBytes / page_size_in_bytes) + 1;
-        const auto allocationIncrease = page_size_in_bytes * pageCount;
-        ASSERT(allocationIncrease + reserved_size_in_bytes <= virtual_size_in_bytes);
+    allocation_count++;
+    tagged_sizes_in_bytes[static_cast<size_t>(current_tag)] += allocationSizeInBytes;
+    peak_used_size_in_bytes = std::max(peak_used_size_in_bytes, static_cast<size_t>(buffer_position - buffer_start));
+#ifndef NDEBUG
+    ASSERT(reinterpret_cast<uintptr_t>(result) % alignment == 0);
+#endif
+    return result;
+}
 
-        const auto result = ReserveMemory(buffer_start + reserved_size_in_bytes, allocationIncrease);
-        if (result.has_error()) {
-            spdlog::error(result.message());
-            return nullptr;
-        }
+bool Arena::extend(uint8_t *allocation, size_t oldSizeInBytes, size_t newSizeInBytes) {
+    ASSERT(buffer_start != nullptr);
+    ASSERT(newSizeInBytes >= oldSizeInBytes);
+    if (allocation + oldSizeInBytes != buffer_position) {
+        return false;
+    }
 
-        reserved_size_in_bytes += allocationIncrease;
+    const auto increase = newSizeInBytes - oldSizeInBytes;
+    if (!ensure_reserved(increase)) {
+        return false;
     }
 
-    const auto result = buffer_position;
-    buffer_position += allocationSizeInBytes;
-    return result;
+    buffer_position += increase;
+    tagged_sizes_in_bytes[static_cast<size_t>(current_tag)] += increase;
+    peak_used_size_in_bytes = std::max(peak_used_size_in_bytes, static_cast<size_t>(buffer_position - buffer_start));
+    return true;
+}
+
+void Arena::release(uint8_t *allocation, size_t allocationSizeInBytes) {
+    ASSERT(buffer_start != nullptr);
+    if (allocation + allocationSizeInBytes == buffer_position) {
+        buffer_position = allocation;
+    }
+}
+
+/// makes sure that sizeInBytes can be pushed without running past the reserved memory
+bool Arena::ensure_reserved(size_t sizeInBytes) {
+    if (buffer_start + reserved_size_in_bytes >= buffer_position + sizeInBytes) {
+        return true;
+    }
+
+    const auto pageCount          = (sizeInBytes / page_size_in_bytes) + 1;
+    const auto allocationIncrease = page_size_in_bytes * pageCount;
+    ASSERT(allocationIncrease + reserved_size_in_bytes <= virtual_size_in_bytes);
+
+    const auto result = commit(buffer_start + reserved_size_in_bytes, allocationIncrease);
+    if (result.has_error()) {
+        spdlog::error(result.message());
+        return false;
+    }
+
+    reserved_size_in_bytes += allocationIncrease;
+    return true;
+}
+
+/// makes the given part of the reservation accessible, using pages from the huge page pool for as long as it lasts
+Result Arena::commit(uint8_t *start, size_t sizeInBytes) {
+    if (pages != ArenaPages::EXPLICIT_HUGE) {
+        return ReserveMemory(start, sizeInBytes);
+    }
+
+    // the huge page pool is only used for a contiguous region at the start of the arena
+    ASSERT(start == buffer_start + huge_tlb_size_in_bytes);
+    const auto result = ReserveHugeTlbMemory(start, sizeInBytes);
+    if (!result.has_error()) {
+        huge_tlb_size_in_bytes += sizeInBytes;
+        return result;
+    }
+
+    // a failed MAP_FIXED mapping may have removed the reservation, so it is recreated before falling back
+    spdlog::debug("Falling back to transparent huge pages: {}", result.message());
+    const auto remainingSize = virtual_size_in_bytes - static_cast<size_t>(start - buffer_start);
+    auto resetResult         = DecommitHugeTlbMemory(start, remainingSize);
+    if (resetResult.has_error()) {
+        return resetResult;
+    }
+    pages = AdviseHugePages(start, remainingSize).has_error() ? ArenaPages::NORMAL : ArenaPages::TRANSPARENT_HUGE;
+    return ReserveMemory(start, sizeInBytes);
 }
 
 void Arena::pop(size_t allocationSizeInBytes) {
@@ -193,22 +379,271 @@ void Arena::pop(size_t allocationSizeInBytes) {
     buffer_position -= allocationSizeInBytes;
 }
 
-void Arena::pop_all() { buffer_position = buffer_start; }
+void Arena::pop_all() {
+    buffer_position = buffer_start;
+    decommit_unused_pages();
+}
+
+void Arena::rewind(uint8_t *position) {
+    ASSERT(position >= buffer_start);
+    buffer_position = position;
+    decommit_unused_pages();
+}
+
+void Arena::decommit_unused_pages() {
+    const auto usedSize   = static_cast<size_t>(buffer_position - buffer_start);
+    const auto neededSize = (usedSize + page_size_in_bytes - 1) / page_size_in_bytes * page_size_in_bytes;
+    if (reserved_size_in_bytes < neededSize + ARENA_DECOMMIT_THRESHOLD) {
+        return;
+    }
+
+    const auto decommitStart = buffer_start + neededSize;
+    const auto decommitSize  = reserved_size_in_bytes - neededSize;
+    const auto result        = huge_tlb_size_in_bytes > neededSize ? DecommitHugeTlbMemory(decommitStart, decommitSize)
+                                                                   : DecommitMemory(decommitStart, decommitSize);
+    if (result.has_error()) {
+        spdlog::warn("Failed to decommit arena memory: {}", result.message());
+        return;
+    }
+    if (huge_tlb_size_in_bytes > neededSize && pages == ArenaPages::TRANSPARENT_HUGE) {
+        // the new mapping does not carry the advice of the one it replaced
+        (void)AdviseHugePages(decommitStart, decommitSize);
+    }
+    reserved_size_in_bytes = neededSize;
+    huge_tlb_size_in_bytes = std::min(huge_tlb_size_in_bytes, neededSize);
+}
+
+ArenaStatistics Arena::statistics() const {
+    auto result                      = ArenaStatistics();
+    result.committedSizeInBytes      = reserved_size_in_bytes;
+    result.usedSizeInBytes           = static_cast<size_t>(buffer_position - buffer_start);
+    result.peakUsedSizeInBytes       = peak_used_size_in_bytes;
+    result.allocationCount           = allocation_count;
+    result.allocatedSizeInBytesByTag = tagged_sizes_in_bytes;
+    result.pages                     = pages;
+    return result;
+}
+
+AllocationTag Arena::set_tag(AllocationTag tag) {
+    auto previous = current_tag;
+    current_tag   = tag;
+    return previous;
+}
+
+const char *allocation_tag_name(AllocationTag tag) {
+    switch (tag) {
+    case AllocationTag::OTHER:
+        return "other";
+    case AllocationTag::PARSER:
+        return "parser";
+    case AllocationTag::DECODE:
+        return "decode";
+    case AllocationTag::RENDER:
+        return "render";
+    case AllocationTag::WRITER:
+        return "writer";
+    case AllocationTag::COUNT:
+        break;
+    }
+    return "unknown";
+}
+
+const char *arena_pages_name(ArenaPages pages) {
+    switch (pages) {
+    case ArenaPages::NORMAL:
+        return "normal";
+    case ArenaPages::TRANSPARENT_HUGE:
+        return "transparent huge";
+    case ArenaPages::EXPLICIT_HUGE:
+        return "explicit huge";
+    }
+    return "unknown";
+}
+
+/// smallest page size of the supported platforms, chunks of a ConcurrentArena are a multiple of it
+const size_t MINIMUM_PAGE_SIZE = 4096;
+
+/// every concurrent arena (and every reset of one) gets a new id, so that chunks of the threads cannot be confused
+static std::atomic<uint64_t> nextConcurrentArenaId = 1;
+
+thread_local ConcurrentArenaChunk ConcurrentArena::current_chunk = {};
+
+ValueResult<ConcurrentArena> ConcurrentArena::create() {
+    constexpr size_t GB = 1024 * 1024 * 1024;
+    return create(128 * GB);
+}
+
+ValueResult<ConcurrentArena> ConcurrentArena::create(size_t maximumSizeInBytes, size_t chunkSizeInBytes) {
+    auto result = ReserveAddressRange(maximumSizeInBytes);
+    if (result.has_error()) {
+        return ValueResult<ConcurrentArena>::error(result.message());
+    }
+    return ValueResult<ConcurrentArena>::ok(result.value(), maximumSizeInBytes, chunkSizeInBytes);
+}
+
+ConcurrentArena::ConcurrentArena(uint8_t *_buffer, size_t _maximumSizeInBytes, size_t _chunkSizeInBytes) {
+    buffer_start          = _buffer;
+    arena_id              = nextConcurrentArenaId++;
+    virtual_size_in_bytes = _maximumSizeInBytes;
+    chunk_size_in_bytes   = _chunkSizeInBytes;
+    ASSERT(chunk_size_in_bytes % MINIMUM_PAGE_SIZE == 0);
+}
+
+ConcurrentArena::ConcurrentArena(ConcurrentArena &&other) { *this = std::move(other); }
+
+ConcurrentArena &ConcurrentArena::operator=(ConcurrentArena &&other) {
+    if (this == &other) {
+        return *this;
+    }
+    if (buffer_start != nullptr) {
+        // the reservation of this arena is replaced by the one of other, it would be leaked otherwise
+        ReleaseAddressRange(buffer_start, virtual_size_in_bytes);
+    }
+
+    buffer_start          = other.buffer_start;
+    arena_id              = other.arena_id;
+    virtual_size_in_bytes = other.virtual_size_in_bytes;
+    chunk_size_in_bytes   = other.chunk_size_in_bytes;
+    reserved_size_in_bytes.store(other.reserved_size_in_bytes.load());
+
+    other.buffer_start          = nullptr;
+    other.arena_id              = 0;
+    other.virtual_size_in_bytes = 0;
+    other.chunk_size_in_bytes   = 0;
+    other.reserved_size_in_bytes.store(0);
+
+    return *this;
+}
+
+ConcurrentArena::~ConcurrentArena() {
+    if (buffer_start == nullptr) {
+        return;
+    }
+
+    ReleaseAddressRange(buffer_start, virtual_size_in_bytes);
+    buffer_start = nullptr;
+}
+
+uint8_t *ConcurrentArena::push_slow(size_t allocationSizeInBytes, size_t alignment) {
+    ASSERT(buffer_start != nullptr);
+    ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    // chunks start on a page boundary, larger alignments cannot be guaranteed
+    ASSERT(alignment <= MINIMUM_PAGE_SIZE);
+
+    // allocations that do not fit into a regular chunk get a chunk of their own
+    auto sizeInBytes = chunk_size_in_bytes;
+    if (allocationSizeInBytes + alignment > chunk_size_in_bytes) {
+        sizeInBytes = (allocationSizeInBytes + chunk_size_in_bytes - 1) / chunk_size_in_bytes * chunk_size_in_bytes;
+    }
+
+    const auto offset = reserved_size_in_bytes.fetch_add(sizeInBytes, std::memory_order_relaxed);
+    if (offset + sizeInBytes > virtual_size_in_bytes) {
+        spdlog::error("concurrent arena is out of memory");
+        return nullptr;
+    }
+
+    // every chunk is only touched by the thread that took it, so it can be made accessible without holding a lock
+    const auto chunkStart = buffer_start + offset;
+    const auto result     = ReserveMemory(chunkStart, sizeInBytes);
+    if (result.has_error()) {
+        spdlog::error(result.message());
+        return nullptr;
+    }
+
+    if (sizeInBytes != chunk_size_in_bytes) {
+        return chunkStart;
+    }
+
+    auto &chunk    = current_chunk;
+    chunk.arena_id = arena_id;
+    chunk.position = chunkStart + allocationSizeInBytes;
+    chunk.end      = chunkStart + sizeInBytes;
+    return chunkStart;
+}
+
+ArenaStatistics ConcurrentArena::statistics() const {
+    auto result                 = ArenaStatistics();
+    result.committedSizeInBytes = reserved_size();
+    result.usedSizeInBytes      = reserved_size();
+    return result;
+}
 
-ValueResult<Allocator> Allocator::create() {
-    auto internalArenaResult = Arena::create();
+void ConcurrentArena::pop_all() {
+    arena_id = nextConcurrentArenaId++;
+    reserved_size_in_bytes.store(0);
+}
+
+AllocationTag Allocator::set_tag(AllocationTag tag) {
+    if (auto worker = current_worker(); worker != nullptr) {
+        worker->temporary.set_tag(tag);
+        return worker->arena.set_tag(tag);
+    }
+
+    temporary_arena.set_tag(tag);
+    page_arena.set_tag(tag);
+    return internal_arena.set_tag(tag);
+}
+
+ValueResult<Allocator> Allocator::create(ArenaPages pages) {
+    auto internalArenaResult = Arena::create(pages);
     if (internalArenaResult.has_error()) {
         return ValueResult<Allocator>::error("failed to create internal arena: " + internalArenaResult.message());
     }
 
-    auto temporaryArenaResult = Arena::create();
+    auto temporaryArenaResult = Arena::create(pages);
     if (temporaryArenaResult.has_error()) {
         return ValueResult<Allocator>::error("failed to create temporary arena: " + temporaryArenaResult.message());
     }
 
+    auto pageArenaResult = Arena::create(pages);
+    if (pageArenaResult.has_error()) {
+        return ValueResult<Allocator>::error("failed to create page arena: " + pageArenaResult.message());
+    }
+
     auto &internal_arena  = internalArenaResult.value();
     auto &temporary_arena = temporaryArenaResult.value();
-    return ValueResult<Allocator>::ok(Allocator(internal_arena, temporary_arena));
+    auto &page_arena      = pageArenaResult.value();
+    return ValueResult<Allocator>::ok(Allocator(internal_arena, temporary_arena, page_arena));
+}
+
+uint8_t *Allocator::open_page_scope() {
+    if (auto worker = current_worker(); worker != nullptr) {
+        worker->page_scope_depth++;
+        return worker->arena.current_buffer_position();
+    }
+
+    page_scope_depth++;
+    return page_arena.current_buffer_position();
+}
+
+void Allocator::close_page_scope(uint8_t *start) {
+    if (auto worker = current_worker(); worker != nullptr) {
+        ASSERT(worker->page_scope_depth > 0);
+        worker->page_scope_depth--;
+        worker->arena.rewind(start);
+        return;
+    }
+
+    ASSERT(page_scope_depth > 0);
+    page_scope_depth--;
+    page_arena.rewind(start);
+}
+
+thread_local WorkerArenas *Allocator::worker_arenas = nullptr;
+
+ValueResult<WorkerArenas> WorkerArenas::create(Allocator &allocator) {
+    auto arenaResult = Arena::create(WORKER_ARENA_SIZE);
+    if (arenaResult.has_error()) {
+        return ValueResult<WorkerArenas>::error("failed to create worker arena: " + arenaResult.message());
+    }
+
+    auto temporaryResult = Arena::create(WORKER_TEMPORARY_ARENA_SIZE);
+    if (temporaryResult.has_error()) {
+        return ValueResult<WorkerArenas>::error("failed to create temporary worker arena: " +
+                                                temporaryResult.message());
+    }
+
+    return ValueResult<WorkerArenas>::ok(WorkerArenas(allocator, arenaResult.value(), temporaryResult.value()));
 }
 
 } // namespace pdf
@@ -1,7 +1,12 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
 #include <utility>
 
 #include "pdf/util/debug.h"
@@ -10,31 +15,101 @@
 namespace pdf {
 
 const size_t ARENA_PAGE_SIZE = 1024 * 1024; // 1 MB
+/// large buffers (file contents, stream data, pixels) start on a cache line
+const size_t CACHE_LINE_SIZE = 64;
+/// size of the regions that threads take from a ConcurrentArena
+const size_t CONCURRENT_ARENA_CHUNK_SIZE = 64 * 1024; // 64 KB
+/// when rewinding an arena leaves more than this unused behind, the unused pages are given back to the OS
+const size_t ARENA_DECOMMIT_THRESHOLD = 16 * 1024 * 1024; // 16 MB
+/// size of a huge page on x86-64 and aarch64 (with 4 KB base pages)
+const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024; // 2 MB
+/// arenas that are backed by huge pages commit memory in steps of this size
+const size_t HUGE_ARENA_PAGE_SIZE = 8 * 1024 * 1024; // 8 MB
+/// A worker arena only holds the objects of a single page, its reservation is kept small because every thread of
+/// Document::for_each_page_in_parallel() reserves one (sanitizers can't map many large reservations).
+const size_t WORKER_ARENA_SIZE           = size_t(4) * 1024 * 1024 * 1024; // 4 GB
+const size_t WORKER_TEMPORARY_ARENA_SIZE = size_t(1) * 1024 * 1024 * 1024; // 1 GB
 
 using PtrResult = ValueResult<uint8_t *>;
 
+/// subsystem that allocations are attributed to in the statistics of an arena
+enum class AllocationTag {
+    OTHER,
+    PARSER,
+    DECODE,
+    RENDER,
+    WRITER,
+    COUNT,
+};
+
+const char *allocation_tag_name(AllocationTag tag);
+
+/// number of bytes for every AllocationTag
+using TaggedSizes = std::array<size_t, static_cast<size_t>(AllocationTag::COUNT)>;
+
+/// kind of pages that back the memory of an arena
+enum class ArenaPages {
+    /// base pages of the OS (4 KB)
+    NORMAL,
+    /// transparent huge pages (madvise(MADV_HUGEPAGE)), the kernel decides whether it can provide them
+    TRANSPARENT_HUGE,
+    /// huge pages from the preallocated pool (MAP_HUGETLB), when the pool runs out transparent huge pages are used
+    EXPLICIT_HUGE,
+};
+
+const char *arena_pages_name(ArenaPages pages);
+
+struct ArenaStatistics {
+    /// memory that is backed by pages
+    size_t committedSizeInBytes = 0;
+    /// memory that is currently handed out
+    size_t usedSizeInBytes = 0;
+    /// largest value of usedSizeInBytes so far
+    size_t peakUsedSizeInBytes = 0;
+    size_t allocationCount     = 0;
+    /// number of bytes that have been pushed while each tag was active (popping does not subtract from this)
+    TaggedSizes allocatedSizeInBytesByTag = {};
+    ArenaPages pages                      = ArenaPages::NORMAL;
+};
+
 struct Arena {
     static ValueResult<Arena> create();
     static ValueResult<Arena> create(size_t maximum_size_in_bytes, size_t page_size_in_bytes = ARENA_PAGE_SIZE);
+    /// Creates an arena that is backed by the given kind of pages. Huge page arenas are aligned to HUGE_PAGE_SIZE and
+    /// commit memory in steps of HUGE_ARENA_PAGE_SIZE, they fall back to normal pages if huge pages are not available.
+    static ValueResult<Arena> create(ArenaPages pages);
 
     Arena() = delete;
-    explicit Arena(uint8_t *buffer, size_t maximum_size_in_bytes, size_t page_size_in_bytes = ARENA_PAGE_SIZE);
+    explicit Arena(uint8_t *buffer, size_t maximum_size_in_bytes, size_t page_size_in_bytes = ARENA_PAGE_SIZE,
+                   ArenaPages pages = ArenaPages::NORMAL);
     Arena(Arena &&other);
     Arena &operator=(Arena &&other);
     ~Arena();
 
-    /// push a new allocation into the arena
-    uint8_t *push(size_t allocationSizeInBytes);
-    /// pop an allocation from the arena
+    /// push a new allocation into the arena, the returned address is a multiple of alignment (a power of two)
+    uint8_t *push(size_t allocationSizeInBytes, size_t alignment = 1);
+    /// pop an allocation from the arena (the padding that was inserted in front of it for alignment is not popped)
     void pop(size_t allocationSizeInBytes);
     /// pops all allocations from the arena
     void pop_all();
+    /// grows the given allocation to newSizeInBytes without moving it, this only works for the most recent allocation
+    [[nodiscard]] bool extend(uint8_t *allocation, size_t oldSizeInBytes, size_t newSizeInBytes);
+    /// pops the given allocation if it is the most recent one, otherwise its memory stays in use until the arena is reset
+    void release(uint8_t *allocation, size_t allocationSizeInBytes);
 
     /// allocates a new object in the arena and calls its constructor with the provided arguments
     template <typename T, typename... Args> T *push(Args &&...args) {
-        auto s   = sizeof(T);
-        auto buf = push(s);
-        return new (buf) T(args...);
+        auto buf = push(sizeof(T), alignof(T));
+        return new (buf) T(std::forward<Args>(args)...);
+    }
+
+    /// allocates an array of count default initialized objects in the arena
+    template <typename T> T *push_array(size_t count) {
+        auto buf = reinterpret_cast<T *>(push(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; i < count; i++) {
+            new (buf + i) T;
+        }
+        return buf;
     }
 
     /// pops the allocation for an object from the arena
@@ -45,19 +120,108 @@ struct Arena {
 
     uint8_t *current_buffer_position() { return buffer_position; }
     void set_current_buffer_position(uint8_t *position) { buffer_position = position; }
+    /// moves the position back to an earlier one and decommits the pages above it, if there are enough of them
+    void rewind(uint8_t *position);
+
+    [[nodiscard]] ArenaStatistics statistics() const;
+    /// all following allocations are attributed to tag, returns the tag that was active before
+    AllocationTag set_tag(AllocationTag tag);
+
+  private:
+    [[nodiscard]] bool ensure_reserved(size_t sizeInBytes);
+    [[nodiscard]] Result commit(uint8_t *start, size_t sizeInBytes);
+    void decommit_unused_pages();
+
+    uint8_t *buffer_start             = nullptr;
+    uint8_t *buffer_position          = nullptr;
+    size_t virtual_size_in_bytes      = 0;
+    size_t reserved_size_in_bytes     = 0;
+    size_t page_size_in_bytes         = ARENA_PAGE_SIZE;
+    size_t peak_used_size_in_bytes    = 0;
+    size_t allocation_count           = 0;
+    AllocationTag current_tag         = AllocationTag::OTHER;
+    TaggedSizes tagged_sizes_in_bytes = {};
+    ArenaPages pages                  = ArenaPages::NORMAL;
+    /// the first bytes of the reservation that are mapped from the huge page pool
+    size_t huge_tlb_size_in_bytes = 0;
+};
+
+/// region of a ConcurrentArena that belongs to a single thread
+struct ConcurrentArenaChunk {
+    uint64_t arena_id = 0;
+    uint8_t *position = nullptr;
+    uint8_t *end      = nullptr;
+};
+
+/// Arena that can be pushed to from multiple threads at the same time. Every thread bumps a pointer in its own chunk,
+/// only taking a new chunk from the shared reservation needs an atomic operation. Allocations are never popped
+/// individually, the whole arena is reset with pop_all().
+struct ConcurrentArena {
+    static ValueResult<ConcurrentArena> create();
+    static ValueResult<ConcurrentArena> create(size_t maximum_size_in_bytes,
+                                               size_t chunk_size_in_bytes = CONCURRENT_ARENA_CHUNK_SIZE);
+
+    ConcurrentArena() = delete;
+    explicit ConcurrentArena(uint8_t *buffer, size_t maximum_size_in_bytes, size_t chunk_size_in_bytes);
+    ConcurrentArena(ConcurrentArena &&other);
+    ConcurrentArena &operator=(ConcurrentArena &&other);
+    ~ConcurrentArena();
+
+    /// push a new allocation into the chunk of the calling thread (thread-safe)
+    uint8_t *push(size_t allocationSizeInBytes, size_t alignment = 1) {
+        auto &chunk = current_chunk;
+        if (chunk.arena_id == arena_id) {
+            auto result = chunk.position + (static_cast<size_t>(-reinterpret_cast<uintptr_t>(chunk.position)) &
+                                            (alignment - 1));
+            if (result + allocationSizeInBytes <= chunk.end) {
+                chunk.position = result + allocationSizeInBytes;
+                return result;
+            }
+        }
+        return push_slow(allocationSizeInBytes, alignment);
+    }
+
+    /// allocates a new object and calls its constructor with the provided arguments (thread-safe)
+    template <typename T, typename... Args> T *push(Args &&...args) {
+        auto buf = push(sizeof(T), alignof(T));
+        return new (buf) T(std::forward<Args>(args)...);
+    }
+
+    /// allocates an array of count default initialized objects (thread-safe)
+    template <typename T> T *push_array(size_t count) {
+        auto buf = reinterpret_cast<T *>(push(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; i < count; i++) {
+            new (buf + i) T;
+        }
+        return buf;
+    }
+
+    /// pops all allocations, no other thread may use the arena while this is running
+    void pop_all();
+
+    /// number of bytes that have been handed out to threads as chunks
+    [[nodiscard]] size_t reserved_size() const { return reserved_size_in_bytes.load(std::memory_order_relaxed); }
+    /// only the committed and used size are known, both are the size of all chunks that have been taken
+    [[nodiscard]] ArenaStatistics statistics() const;
 
   private:
-    uint8_t *buffer_start         = nullptr;
-    uint8_t *buffer_position      = nullptr;
-    size_t virtual_size_in_bytes  = 0;
-    size_t reserved_size_in_bytes = 0;
-    size_t page_size_in_bytes     = ARENA_PAGE_SIZE;
+    /// each thread remembers the chunk of the arena it pushed to last, pushing to another arena replaces it
+    static thread_local ConcurrentArenaChunk current_chunk;
+
+    uint8_t *push_slow(size_t allocationSizeInBytes, size_t alignment);
+
+    uint8_t *buffer_start = nullptr;
+    /// identifies the arena in the chunks of the threads, it changes whenever all allocations are popped
+    uint64_t arena_id                         = 0;
+    size_t virtual_size_in_bytes              = 0;
+    size_t chunk_size_in_bytes                = CONCURRENT_ARENA_CHUNK_SIZE;
+    std::atomic<size_t> reserved_size_in_bytes = 0;
 };
 
 struct TemporaryAllocator {
     explicit TemporaryAllocator(Arena &_arena)
         : internal_arena(_arena), start_position(_arena.current_buffer_position()) {}
-    ~TemporaryAllocator() { internal_arena.set_current_buffer_position(start_position); }
+    ~TemporaryAllocator() { internal_arena.rewind(start_position); }
 
     Arena &arena() { return internal_arena; }
 
@@ -66,25 +230,159 @@ struct TemporaryAllocator {
     uint8_t *start_position = nullptr;
 };
 
+struct Allocator;
+
+/// Arenas of a thread that processes pages in parallel with other threads (see Document::parallel_for_each_page).
+/// While a WorkerScope is open, the allocator hands them out on that thread instead of its own arenas.
+struct WorkerArenas {
+    static ValueResult<WorkerArenas> create(Allocator &allocator);
+
+    Allocator *allocator = nullptr;
+    /// used for Allocator::arena() and Allocator::page(), everything in it belongs to the page that is being processed
+    Arena arena;
+    Arena temporary;
+    size_t page_scope_depth = 0;
+
+    explicit WorkerArenas(Allocator &_allocator, Arena &_arena, Arena &_temporary)
+        : allocator(&_allocator), arena(std::move(_arena)), temporary(std::move(_temporary)) {}
+};
+
 struct Allocator {
-    static ValueResult<Allocator> create();
+    /// the internal, the temporary and the page arena are backed by the given kind of pages
+    static ValueResult<Allocator> create(ArenaPages pages = ArenaPages::NORMAL);
 
     Allocator(Allocator &&other) = default;
     Allocator &operator=(Allocator &&other) {
-        internal_arena  = std::move(other.internal_arena);
-        temporary_arena = std::move(other.temporary_arena);
+        internal_arena   = std::move(other.internal_arena);
+        temporary_arena  = std::move(other.temporary_arena);
+        page_arena       = std::move(other.page_arena);
+        page_scope_depth = other.page_scope_depth;
+        shared_mutex     = std::move(other.shared_mutex);
         return *this;
     }
 
-    Arena &arena() { return internal_arena; }
-    TemporaryAllocator temporary() { return TemporaryAllocator(temporary_arena); }
+    Arena &arena() {
+        auto worker = current_worker();
+        return worker != nullptr ? worker->arena : internal_arena;
+    }
+    TemporaryAllocator temporary() {
+        auto worker = current_worker();
+        return TemporaryAllocator(worker != nullptr ? worker->temporary : temporary_arena);
+    }
+    /// arena for everything that is produced while processing a page (operators, decoded content, text blocks), this
+    /// is the internal arena while no page scope is open
+    Arena &page() {
+        auto worker = current_worker();
+        if (worker != nullptr) {
+            return worker->arena;
+        }
+        return page_scope_depth > 0 ? page_arena : internal_arena;
+    }
+
+    /// True on the threads of Document::parallel_for_each_page (outside of a SharedAllocationScope). These threads
+    /// allocate from their own arenas, which must not be referenced by objects that are shared between the threads.
+    [[nodiscard]] bool is_worker() const { return worker_arenas != nullptr && worker_arenas->allocator == this; }
+
+    /// starts a scope on the page arena and returns its start, use PageScope instead of calling this directly
+    uint8_t *open_page_scope();
+    /// pops everything that has been pushed to the page arena since the scope was opened
+    void close_page_scope(uint8_t *start);
+
+    [[nodiscard]] ArenaStatistics internal_statistics() const { return internal_arena.statistics(); }
+    [[nodiscard]] ArenaStatistics temporary_statistics() const { return temporary_arena.statistics(); }
+    [[nodiscard]] ArenaStatistics page_statistics() const { return page_arena.statistics(); }
+    /// sets the tag of the internal, the temporary and the page arena, returns the tag that was active before
+    AllocationTag set_tag(AllocationTag tag);
 
   private:
+    friend struct WorkerScope;
+    friend struct SharedAllocationScope;
+
     Arena internal_arena;
     Arena temporary_arena;
+    Arena page_arena;
+    size_t page_scope_depth = 0;
+    /// guards the arenas of the allocator while worker threads are running (see SharedAllocationScope)
+    std::unique_ptr<std::mutex> shared_mutex = std::make_unique<std::mutex>();
 
-    explicit Allocator(Arena &_internal_arena, Arena &_temporary_arena)
-        : internal_arena(std::move(_internal_arena)), temporary_arena(std::move(_temporary_arena)) {}
+    /// arenas of the calling thread, if it is a worker
+    static thread_local WorkerArenas *worker_arenas;
+
+    [[nodiscard]] WorkerArenas *current_worker() const { return is_worker() ? worker_arenas : nullptr; }
+
+    explicit Allocator(Arena &_internal_arena, Arena &_temporary_arena, Arena &_page_arena)
+        : internal_arena(std::move(_internal_arena)), temporary_arena(std::move(_temporary_arena)),
+          page_arena(std::move(_page_arena)) {}
+};
+
+/// Keeps a scope on the page arena of an allocator open for as long as it is alive (PageScope uses this to process a
+/// whole page)
+struct PageArenaScope {
+    explicit PageArenaScope(Allocator &_allocator) : allocator(_allocator), start(_allocator.open_page_scope()) {}
+    ~PageArenaScope() { allocator.close_page_scope(start); }
+
+    PageArenaScope(const PageArenaScope &)            = delete;
+    PageArenaScope &operator=(const PageArenaScope &) = delete;
+
+    [[nodiscard]] uint8_t *start_position() const { return start; }
+
+  private:
+    Allocator &allocator;
+    uint8_t *start = nullptr;
+};
+
+/// Makes the calling thread a worker of the allocator of the given arenas for as long as it is alive
+struct WorkerScope {
+    explicit WorkerScope(WorkerArenas &arenas) : previous(Allocator::worker_arenas) {
+        Allocator::worker_arenas = &arenas;
+    }
+    ~WorkerScope() { Allocator::worker_arenas = previous; }
+
+    WorkerScope(const WorkerScope &)            = delete;
+    WorkerScope &operator=(const WorkerScope &) = delete;
+
+  private:
+    WorkerArenas *previous = nullptr;
+};
+
+/// Gives a worker thread exclusive access to the arenas of the allocator for as long as it is alive. Everything that is
+/// shared between the workers (e.g. loaded objects or decoded font programs) has to be allocated inside such a scope.
+/// On threads that are not workers this does nothing.
+struct SharedAllocationScope {
+    explicit SharedAllocationScope(Allocator &_allocator)
+        : allocator(_allocator), worker(_allocator.current_worker()) {
+        if (worker != nullptr) {
+            allocator.shared_mutex->lock();
+            Allocator::worker_arenas = nullptr;
+        }
+    }
+    ~SharedAllocationScope() {
+        if (worker != nullptr) {
+            Allocator::worker_arenas = worker;
+            allocator.shared_mutex->unlock();
+        }
+    }
+
+    SharedAllocationScope(const SharedAllocationScope &)            = delete;
+    SharedAllocationScope &operator=(const SharedAllocationScope &) = delete;
+
+  private:
+    Allocator &allocator;
+    WorkerArenas *worker = nullptr;
+};
+
+/// Attributes the allocations of an allocator to a subsystem for as long as it is alive
+struct AllocationTagScope {
+    AllocationTagScope(Allocator &_allocator, AllocationTag tag)
+        : allocator(_allocator), previous_tag(_allocator.set_tag(tag)) {}
+    ~AllocationTagScope() { allocator.set_tag(previous_tag); }
+
+    AllocationTagScope(const AllocationTagScope &)            = delete;
+    AllocationTagScope &operator=(const AllocationTagScope &) = delete;
+
+  private:
+    Allocator &allocator;
+    AllocationTag previous_tag;
 };
 
 } // namespace pdf
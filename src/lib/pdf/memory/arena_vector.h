@@ -0,0 +1,119 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#include "arena_allocator.h"
+
+namespace pdf {
+
+/// Growable array that lives in an arena. In contrast to a Vector, it grows in place as long as its buffer is the most
+/// recent allocation of the arena, which means that filling it without other allocations in between never copies and
+/// leaves no dead space behind. Elements are moved with memcpy, which is why they have to be trivially copyable.
+template <typename T> struct ArenaVector {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_trivially_destructible_v<T>);
+
+    explicit ArenaVector(Arena &_arena) : arena(&_arena) {}
+    explicit ArenaVector(Allocator &allocator) : arena(&allocator.arena()) {}
+    explicit ArenaVector(TemporaryAllocator &allocator) : arena(&allocator.arena()) {}
+    ~ArenaVector() {
+        if (buffer != nullptr) {
+            arena->release(reinterpret_cast<uint8_t *>(buffer), capacityCount * sizeof(T));
+        }
+    }
+
+    ArenaVector(const ArenaVector &other) : arena(other.arena) {
+        reserve(other.count);
+        if (other.count != 0) {
+            std::memcpy(buffer, other.buffer, other.count * sizeof(T));
+        }
+        count = other.count;
+    }
+    ArenaVector &operator=(const ArenaVector &other) {
+        if (this != &other) {
+            clear();
+            reserve(other.count);
+            if (other.count != 0) {
+                std::memcpy(buffer, other.buffer, other.count * sizeof(T));
+            }
+            count = other.count;
+        }
+        return *this;
+    }
+    ArenaVector(ArenaVector &&other) noexcept
+        : arena(other.arena), buffer(other.buffer), count(other.count), capacityCount(other.capacityCount) {
+        other.buffer        = nullptr;
+        other.count         = 0;
+        other.capacityCount = 0;
+    }
+
+    void push_back(const T &value) {
+        if (count == capacityCount) {
+            grow(count + 1);
+        }
+        buffer[count++] = value;
+    }
+    template <typename... Args> T &emplace_back(Args &&...args) {
+        if (count == capacityCount) {
+            grow(count + 1);
+        }
+        return *new (buffer + count++) T(std::forward<Args>(args)...);
+    }
+    void pop_back() { count--; }
+    void clear() { count = 0; }
+    /// removes the first n elements and moves the remaining ones to the front, the capacity is kept
+    void erase_front(size_t n) {
+        std::memmove(buffer, buffer + n, (count - n) * sizeof(T));
+        count -= n;
+    }
+    void reserve(size_t newCapacity) {
+        if (newCapacity > capacityCount) {
+            grow(newCapacity);
+        }
+    }
+
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] size_t capacity() const { return capacityCount; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+
+    T *data() { return buffer; }
+    const T *data() const { return buffer; }
+    T &operator[](size_t index) { return buffer[index]; }
+    const T &operator[](size_t index) const { return buffer[index]; }
+    T &front() { return buffer[0]; }
+    T &back() { return buffer[count - 1]; }
+
+    T *begin() { return buffer; }
+    T *end() { return buffer + count; }
+    const T *begin() const { return buffer; }
+    const T *end() const { return buffer + count; }
+
+  private:
+    static constexpr size_t INITIAL_CAPACITY = 16;
+
+    Arena *arena         = nullptr;
+    T *buffer            = nullptr;
+    size_t count         = 0;
+    size_t capacityCount = 0;
+
+    void grow(size_t minimumCapacity) {
+        auto newCapacity = std::max(minimumCapacity, std::max(capacityCount * 2, INITIAL_CAPACITY));
+        if (buffer != nullptr && arena->extend(reinterpret_cast<uint8_t *>(buffer), capacityCount * sizeof(T),
+                                               newCapacity * sizeof(T))) {
+            capacityCount = newCapacity;
+            return;
+        }
+
+        auto newBuffer = reinterpret_cast<T *>(arena->push(newCapacity * sizeof(T), alignof(T)));
+        ASSERT(newBuffer != nullptr);
+        if (count != 0) {
+            std::memcpy(newBuffer, buffer, count * sizeof(T));
+        }
+        buffer        = newBuffer;
+        capacityCount = newCapacity;
+    }
+};
+
+} // namespace pdf
@@ -11,20 +11,50 @@
 template <class T> struct StlAllocator {
     typedef T value_type;
 
-    pdf::Arena &arena;
+    /// exactly one of the arenas or the page allocator is set
+    pdf::Arena *arena                     = nullptr;
+    pdf::ConcurrentArena *concurrentArena = nullptr;
+    /// allocations go to the page arena of this allocator that is current at the time of the allocation
+    pdf::Allocator *pageAllocator = nullptr;
 
-    StlAllocator(pdf::Arena &arena_) : arena(arena_) {}
-    StlAllocator(pdf::Allocator &allocator) : arena(allocator.arena()) {}
-    StlAllocator(pdf::TemporaryAllocator &allocator) : arena(allocator.arena()) {}
-    template <class U> constexpr StlAllocator(const StlAllocator<U> &other) noexcept : arena(other.arena) {}
+    StlAllocator(pdf::Arena &arena_) : arena(&arena_) {}
+    StlAllocator(pdf::Allocator &allocator) : arena(&allocator.arena()) {}
+    StlAllocator(pdf::TemporaryAllocator &allocator) : arena(&allocator.arena()) {}
+    /// containers with this allocator can be filled from multiple threads, as long as each thread uses its own container
+    StlAllocator(pdf::ConcurrentArena &arena_) : concurrentArena(&arena_) {}
+    template <class U>
+    constexpr StlAllocator(const StlAllocator<U> &other) noexcept
+        : arena(other.arena), concurrentArena(other.concurrentArena), pageAllocator(other.pageAllocator) {}
+
+    /// containers with this allocator can outlive a page scope, as long as they are emptied before it ends
+    static StlAllocator page(pdf::Allocator &allocator) {
+        auto result          = StlAllocator(allocator);
+        result.arena         = nullptr;
+        result.pageAllocator = &allocator;
+        return result;
+    }
 
     [[nodiscard]] T *allocate(std::size_t n) {
-        const auto p = reinterpret_cast<T *>(arena.push(n * sizeof(T)));
+        T *p = nullptr;
+        if (pageAllocator != nullptr) {
+            p = reinterpret_cast<T *>(pageAllocator->page().push(n * sizeof(T), alignof(T)));
+        } else if (arena != nullptr) {
+            p = reinterpret_cast<T *>(arena->push(n * sizeof(T), alignof(T)));
+        } else {
+            p = reinterpret_cast<T *>(concurrentArena->push(n * sizeof(T), alignof(T)));
+        }
         report(p, n);
         return p;
     }
 
-    void deallocate(T *p, std::size_t n) noexcept { report(p, n, false); }
+    void deallocate(T *p, std::size_t n) noexcept {
+        report(p, n, false);
+        // memory of another arena is never on top of the current page arena, so releasing it there does nothing
+        auto target = pageAllocator != nullptr ? &pageAllocator->page() : arena;
+        if (target != nullptr) {
+            target->release(reinterpret_cast<uint8_t *>(p), n * sizeof(T));
+        }
+    }
 
   private:
     void report(T *p, std::size_t n, bool alloc = true) const {
@@ -1,5 +1,7 @@
 #include "objects.h"
 
+#include <algorithm>
+#include <cctype>
 #include <cstring>
 #include <spdlog/spdlog.h>
 #include <zlib.h>
@@ -93,7 +95,7 @@ std::vector<std::string> Stream::filters() const {
     auto array  = itr->second->as<Array>();
     auto result = std::vector<std::string>();
     result.reserve(array->values.size());
-    for (auto filter : array->values) {
+    for (auto &filter : array->values) {
         // TODO is this conversion to a string really necessary?
         result.emplace_back(filter->as<Name>()->value);
     }
@@ -101,9 +103,25 @@ std::vector<std::string> Stream::filters() const {
 }
 
 std::string_view Stream::decode(Allocator &allocator) {
-    if (decodedStream != nullptr) {
+    // the decoded data is kept for all threads of Document::parallel_for_each_page
+    auto shared = SharedAllocationScope(allocator);
+    return decode(allocator, allocator.arena());
+}
+
+std::string_view Stream::decode(Allocator &allocator, Arena &arena) {
+    // workers decode into their own arenas, which must not be referenced by the stream
+    const auto keepDecodedData = !allocator.is_worker();
+    if (keepDecodedData && decodedStream != nullptr) {
         return {(char *)decodedStream, decodedStreamSize};
     }
+    if (!keepDecodedData) {
+        auto shared = SharedAllocationScope(allocator);
+        if (decodedStream != nullptr) {
+            return {(char *)decodedStream, decodedStreamSize};
+        }
+    }
+
+    auto tagScope = AllocationTagScope(allocator, AllocationTag::DECODE);
 
     auto *output      = (uint8_t *)const_cast<char *>(streamData.data());
     size_t outputSize = streamData.length();
@@ -122,7 +140,7 @@ std::string_view Stream::decode(Allocator &allocator) {
             size_t inputSize = outputSize;
 
             auto temp          = allocator.temporary();
-            output                  = temp.arena().push(outputSize);
+            output                  = temp.arena().push(outputSize, CACHE_LINE_SIZE);
             const auto *firstOutput = output;
 
             z_stream infstream;
@@ -150,7 +168,7 @@ std::string_view Stream::decode(Allocator &allocator) {
             inflateEnd(&infstream);
 
             // copy the result into a buffer that fits exactly
-            auto *tmp = allocator.arena().push(infstream.total_out);
+            auto *tmp = arena.push(infstream.total_out, CACHE_LINE_SIZE);
             // NOTE the arena allocator allocates contiguous memory, which is why this works
             memcpy(tmp, firstOutput, infstream.total_out);
 
@@ -163,72 +181,141 @@ std::string_view Stream::decode(Allocator &allocator) {
         }
     }
 
-    decodedStream     = output;
-    decodedStreamSize = outputSize;
+    if (keepDecodedData) {
+        decodedStream     = output;
+        decodedStreamSize = outputSize;
+    }
 
-    return {(char *)decodedStream, decodedStreamSize};
+    return {(char *)output, outputSize};
 }
 
-std::string_view deflate_buffer(Allocator &allocator, const uint8_t *srcData, size_t srcSize) {
-    auto temp = allocator.temporary();
-    auto tempSize  = srcSize * 2;
-    auto tempData  = temp.arena().push(tempSize);
-
-    z_stream stream  = {};
-    stream.zalloc    = Z_NULL;
-    stream.zfree     = Z_NULL;
-    stream.opaque    = Z_NULL;
-    stream.avail_in  = (uInt)srcSize;     // size of input
-    stream.next_in   = (Bytef *)srcData;  // input char array
-    stream.avail_out = (uInt)tempSize;    // size of output
-    stream.next_out  = (Bytef *)tempData; // output char array
-
-    auto ret = deflateInit(&stream, Z_BEST_COMPRESSION);
-    if (ret != Z_OK) {
-        // TODO error handling
-        return {};
+void Stream::forget_decoded_data(const uint8_t *start, const uint8_t *end) {
+    if (decodedStream >= start && decodedStream < end) {
+        decodedStream     = nullptr;
+        decodedStreamSize = 0;
     }
-
-    ret = deflate(&stream, Z_FINISH);
-    if (ret != Z_STREAM_END) {
-        // TODO error handling
-        return {};
+    // the operators point into the decoded data, they can't outlive it
+    auto operatorsStart = reinterpret_cast<const uint8_t *>(operators);
+    if (decodedStream == nullptr || (operatorsStart >= start && operatorsStart < end)) {
+        operators     = nullptr;
+        operatorCount = 0;
     }
+}
 
-    ret = deflateEnd(&stream);
-    if (ret != Z_OK) {
-        // TODO error handling
-        return {};
+Result Stream::encode(Allocator &allocator, std::string_view data, const CompressionOptions &options) {
+    auto result = deflate_buffer(allocator, (uint8_t *)data.data(), data.size(), options);
+    if (result.has_error()) {
+        // the stream keeps its previous data
+        return result.drop_value();
     }
 
-    auto resultSize = stream.total_out;
-    auto resultData = allocator.arena().push(resultSize);
-    std::memcpy(resultData, tempData, resultSize);
-    return {(char *)resultData, resultSize};
+    decodedStream                = nullptr;
+    operators                    = nullptr;
+    operatorCount                = 0;
+    streamData                   = result.value();
+    compressionLevel             = options.level;
+    dictionary->values["Length"] = Value::create<Integer>(static_cast<int64_t>(streamData.size()));
+    return Result::ok();
 }
 
-void Stream::encode(Allocator &allocator, const std::string &data) {
-    decodedStream                = nullptr;
-    streamData                   = deflate_buffer(allocator, (uint8_t *)data.data(), data.size());
-    dictionary->values["Length"] = allocator.arena().push<Integer>(streamData.size());
+Result Stream::recompress(Allocator &allocator, const CompressionOptions &options) {
+    auto decoded         = decode(allocator);
+    auto parsedOperators = operators;
+    auto parsedCount     = operatorCount;
+    auto result          = encode(allocator, decoded, options);
+    if (result.has_error()) {
+        return result;
+    }
+
+    // the decoded data and the operators are still valid, there is no need to parse them again later on
+    decodedStream     = (const uint8_t *)decoded.data();
+    decodedStreamSize = decoded.size();
+    operators         = parsedOperators;
+    operatorCount     = parsedCount;
+    return Result::ok();
 }
 
 Stream *Stream::create_from_unencoded_data(Allocator &allocator,
                                            const UnorderedMap<std::string, Object *> &additionalDictionaryEntries,
-                                           std::string_view unencodedData) {
-    auto streamData = deflate_buffer(allocator, (uint8_t *)unencodedData.data(), unencodedData.size());
-
+                                           std::string_view unencodedData,
+                                           const CompressionOptions &options) {
     auto dict = UnorderedMap<std::string, Object *>(allocator);
     for (const auto &entry : additionalDictionaryEntries) {
         dict[entry.first] = entry.second;
     }
 
-    auto &arena    = allocator.arena();
-    dict["Length"] = arena.push<Integer>(streamData.size());
-    dict["Filter"] = arena.push<Name>("FlateDecode");
+    auto &arena = allocator.arena();
+    auto result = deflate_buffer(allocator, (uint8_t *)unencodedData.data(), unencodedData.size(), options);
+    if (result.has_error()) {
+        // the data is kept without compressing it, instead of losing it
+        spdlog::warn("Storing stream without compression: {}", result.message());
+        auto data = arena.push(unencodedData.size());
+        std::memcpy(data, unencodedData.data(), unencodedData.size());
+        dict["Length"] = arena.push<Integer>(unencodedData.size());
+        return arena.push<Stream>(arena.push<Dictionary>(dict), std::string_view((char *)data, unencodedData.size()));
+    }
+
+    auto streamData = result.value();
+    dict["Length"]  = arena.push<Integer>(streamData.size());
+    dict["Filter"]  = arena.push<Name>("FlateDecode");
 
-    auto dictionary = arena.push<Dictionary>(dict);
-    return arena.push<Stream>(dictionary, streamData);
+    auto dictionary          = arena.push<Dictionary>(dict);
+    auto stream              = arena.push<Stream>(dictionary, streamData);
+    stream->compressionLevel = options.level;
+    return stream;
+}
+
+std::string LiteralString::to_string() const {
+    std::string result;
+    result.reserve(value.size());
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] != '\\' || i + 1 == value.size()) {
+            result += value[i];
+            continue;
+        }
+
+        auto c = value[++i];
+        switch (c) {
+        case 'n':
+            result += '\n';
+            break;
+        case 'r':
+            result += '\r';
+            break;
+        case 't':
+            result += '\t';
+            break;
+        case 'b':
+            result += '\b';
+            break;
+        case 'f':
+            result += '\f';
+            break;
+        case '\r':
+            // a backslash at the end of a line continues the string on the next line
+            if (i + 1 < value.size() && value[i + 1] == '\n') {
+                i++;
+            }
+            break;
+        case '\n':
+            break;
+        default:
+            if (c >= '0' && c <= '7') {
+                // octal character code with up to three digits
+                int code = c - '0';
+                for (int digits = 1; digits < 3 && i + 1 < value.size() && value[i + 1] >= '0' && value[i + 1] <= '7';
+                     digits++) {
+                    code = code * 8 + (value[++i] - '0');
+                }
+                result += static_cast<char>(code);
+            } else {
+                // '(', ')', '\\' and unknown escape sequences stand for the character itself
+                result += c;
+            }
+            break;
+        }
+    }
+    return result;
 }
 
 std::string HexadecimalString::to_string() const {
@@ -257,12 +344,93 @@ std::string HexadecimalString::to_string() const {
     return result;
 }
 
-void Array::remove_element(Document & /*document*/, size_t index) {
+static uint64_t combine_hash(uint64_t hash, uint64_t value) {
+    return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 12) + (hash >> 4));
+}
+
+uint64_t content_hash(Object *object) {
+    if (object == nullptr) {
+        return 0;
+    }
+
+    auto hash         = static_cast<uint64_t>(object->type) + 1;
+    auto stringHasher = std::hash<std::string_view>();
+    switch (object->type) {
+    case Object::Type::BOOLEAN:
+        return combine_hash(hash, object->as<Boolean>()->value);
+    case Object::Type::INTEGER:
+        return combine_hash(hash, static_cast<uint64_t>(object->as<Integer>()->value));
+    case Object::Type::REAL:
+        return combine_hash(hash, std::hash<double>()(object->as<Real>()->value));
+    case Object::Type::HEXADECIMAL_STRING:
+        return combine_hash(hash, stringHasher(object->as<HexadecimalString>()->value));
+    case Object::Type::LITERAL_STRING:
+        return combine_hash(hash, stringHasher(object->as<LiteralString>()->value));
+    case Object::Type::NAME:
+        return combine_hash(hash, stringHasher(object->as<Name>()->value));
+    case Object::Type::ARRAY:
+        for (auto &value : object->as<Array>()->values) {
+            hash = combine_hash(hash, content_hash(value));
+        }
+        return hash;
+    case Object::Type::DICTIONARY: {
+        // the order of the entries depends on the history of the map, adding up the hashes makes it irrelevant
+        uint64_t entriesHash = 0;
+        for (auto &entry : object->as<Dictionary>()->values) {
+            entriesHash += combine_hash(stringHasher(entry.first), content_hash(entry.second));
+        }
+        return combine_hash(hash, entriesHash);
+    }
+    case Object::Type::INDIRECT_REFERENCE: {
+        auto reference = object->as<IndirectReference>();
+        hash           = combine_hash(hash, static_cast<uint64_t>(reference->objectNumber));
+        return combine_hash(hash, static_cast<uint64_t>(reference->generationNumber));
+    }
+    case Object::Type::INDIRECT_OBJECT: {
+        auto indirectObject = object->as<IndirectObject>();
+        hash                = combine_hash(hash, static_cast<uint64_t>(indirectObject->objectNumber));
+        hash                = combine_hash(hash, static_cast<uint64_t>(indirectObject->generationNumber));
+        return combine_hash(hash, content_hash(indirectObject->object));
+    }
+    case Object::Type::STREAM: {
+        // stream data is never modified in place, replacing it changes the view
+        auto stream = object->as<Stream>();
+        hash        = combine_hash(hash, content_hash(stream->dictionary));
+        hash        = combine_hash(hash, reinterpret_cast<uintptr_t>(stream->streamData.data()));
+        return combine_hash(hash, stream->streamData.size());
+    }
+    default:
+        return hash;
+    }
+}
+
+Dictionary::Dictionary(const UnorderedMap<std::string, Object *> &map)
+    : Object(staticType()), values(map.bucket_count(), map.get_allocator()) {
+    // the entries are inserted sorted by key, which makes the order in which the keys are written depend only on the
+    // keys and not on the history of the given map
+    auto entries = Vector<const std::pair<const std::string, Object *> *>(map.get_allocator());
+    entries.reserve(map.size());
+    for (auto &entry : map) {
+        entries.push_back(&entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](auto a, auto b) { return a->first < b->first; });
+    for (auto entry : entries) {
+        values.emplace(entry->first, entry->second);
+    }
+}
+
+void Array::remove_element(Document &document, size_t index) {
     ASSERT(index < values.size());
+    // the element has to be removed from the index while it is still part of the array
+    document.remove_from_index(values[index]);
     values.erase(values.begin() + index);
+    document.mark_dirty(this);
 }
 
-void Integer::set(Document & /*document*/, int64_t i) { value = i; }
+void Integer::set(Document &document, int64_t i) {
+    value = i;
+    document.mark_dirty(this);
+}
 
 std::optional<int64_t> EmbeddedFile::size() {
     const auto &paramsOpt = dictionary->find<Dictionary>("Params");
@@ -278,6 +446,33 @@ std::optional<int64_t> EmbeddedFile::size() {
     return {sizeOpt.value()->value};
 }
 
+std::optional<std::string> EmbeddedFile::check_sum() {
+    const auto &paramsOpt = dictionary->find<Dictionary>("Params");
+    if (!paramsOpt.has_value()) {
+        return {};
+    }
+
+    const auto &checkSumOpt = paramsOpt.value()->find<Object>("CheckSum");
+    if (!checkSumOpt.has_value()) {
+        return {};
+    }
+
+    auto checkSum = checkSumOpt.value();
+    if (checkSum->is<HexadecimalString>()) {
+        return checkSum->as<HexadecimalString>()->to_string();
+    }
+    if (!checkSum->is<LiteralString>()) {
+        return {};
+    }
+
+    // older versions of embed_file() wrote the digest as 32 hexadecimal characters into a literal string
+    auto result = checkSum->as<LiteralString>()->to_string();
+    if (result.size() == 32 && std::all_of(result.begin(), result.end(), [](unsigned char c) { return std::isxdigit(c); })) {
+        return HexadecimalString(result).to_string();
+    }
+    return result;
+}
+
 std::string Object::type_string() const {
     switch (type) {
 #define DECLARE_CASE(Name)                                                                                             \
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <iostream>
+#include <new>
 #include <optional>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "pdf/compression.h"
 #include "pdf/memory/arena_allocator.h"
 #include "pdf/util/debug.h"
 #include "pdf/util/types.h"
@@ -13,6 +15,7 @@
 namespace pdf {
 
 struct Document;
+struct Operator;
 
 #define ENUMERATE_OBJECT_TYPES(O)                                                                                      \
     O(OBJECT)                                                                                                          \
@@ -78,6 +81,9 @@ struct LiteralString : public Object {
 
     static Type staticType() { return Type::LITERAL_STRING; }
     explicit LiteralString(std::string _value) : Object(staticType()), value(std::move(_value)) {}
+
+    /// resolves the escape sequences of the literal string
+    [[nodiscard]] std::string to_string() const;
 };
 
 struct HexadecimalString : public Object {
@@ -97,20 +103,75 @@ struct Name : public Object {
     explicit Name(std::string _value) : Object(staticType()), value(std::move(_value)) {}
 };
 
+struct Null : public Object {
+    static Type staticType() { return Type::NULL_OBJECT; }
+    explicit Null() : Object(staticType()) {}
+};
+
+/// Element of an Array or value of a Dictionary. Booleans, integers, reals and null objects have the same size as a
+/// Value and can be stored inline with create<T>() (which is what the parser does), all other objects live in the
+/// arena and are only referenced. A Value can be used like an Object * (->, is<T>() and as<T>()). Pointers to an
+/// inline object stay valid as long as the Value is not moved (e.g. by adding elements to the Array it belongs to).
+struct Value {
+    Value() { new (storage) Reference(nullptr); }
+    /// refers to the object, scalars included, so that changes to the object are visible through the Value
+    Value(Object *object) { new (storage) Reference(object); } // NOLINT(google-explicit-constructor)
+
+    /// creates a Value that stores a Boolean, Integer, Real or Null inline, without allocating it in the arena first
+    template <typename T, typename... Args> static Value create(Args &&...args) {
+        static_assert(sizeof(T) <= VALUE_SIZE && alignof(T) <= alignof(int64_t));
+        auto result = Value();
+        new (result.storage) T(std::forward<Args>(args)...);
+        return result;
+    }
+
+    [[nodiscard]] Object *get() const {
+        auto object = std::launder(reinterpret_cast<Object *>(const_cast<uint8_t *>(storage)));
+        if (object->type == Object::Type::OBJECT) {
+            return static_cast<Reference *>(object)->object;
+        }
+        return object;
+    }
+    /// the object is stored inside of the Value, its address changes whenever the Value is moved
+    [[nodiscard]] bool is_inline() const {
+        return std::launder(reinterpret_cast<const Object *>(storage))->type != Object::Type::OBJECT;
+    }
+    Object *operator->() const { return get(); }
+    operator Object *() const { return get(); } // NOLINT(google-explicit-constructor)
+
+    template <typename T> bool is() const { return get()->is<T>(); }
+    template <typename T> T *as() const { return get()->as<T>(); }
+
+  private:
+    static constexpr size_t VALUE_SIZE = 16;
+
+    /// stored in place of objects that are too big to be stored inline
+    struct Reference : public Object {
+        Object *object = nullptr;
+        explicit Reference(Object *_object) : Object(Type::OBJECT), object(_object) {}
+    };
+
+    alignas(int64_t) uint8_t storage[VALUE_SIZE] = {};
+};
+static_assert(sizeof(Value) == 16);
+
 struct Array : public Object {
-    Vector<Object *> values;
+    Vector<Value> values;
 
     static Type staticType() { return Type::ARRAY; }
-    explicit Array(Vector<Object *> objects) : Object(staticType()), values(std::move(objects)) {}
+    explicit Array(Vector<Value> _values) : Object(staticType()), values(std::move(_values)) {}
+    explicit Array(const Vector<Object *> &objects)
+        : Object(staticType()), values(objects.begin(), objects.end(), objects.get_allocator()) {}
 
     void remove_element(Document &document, size_t index);
 };
 
 struct Dictionary : public Object {
-    UnorderedMap<std::string, Object *> values;
+    UnorderedMap<std::string, Value> values;
 
     static Type staticType() { return Type::DICTIONARY; }
-    explicit Dictionary(UnorderedMap<std::string, Object *> map) : Object(staticType()), values(std::move(map)) {}
+    explicit Dictionary(UnorderedMap<std::string, Value> map) : Object(staticType()), values(std::move(map)) {}
+    explicit Dictionary(const UnorderedMap<std::string, Object *> &map);
 
     template <typename T> std::optional<T *> find(const std::string &key) {
         auto itr = values.find(key);
@@ -155,16 +216,34 @@ struct Stream : public Object {
     const uint8_t *decodedStream = nullptr;
     size_t decodedStreamSize     = 0;
 
+    /// operators of a content stream, parsed once and kept next to the decoded data (see ContentStream)
+    Operator **operators = nullptr;
+    size_t operatorCount = 0;
+
+    /// zlib level that was used to compress the stream data in memory, -1 if the data has not been encoded by us
+    int compressionLevel = -1;
+
     static Type staticType() { return Type::STREAM; }
     explicit Stream(Dictionary *_dictionary, std::string_view encodedData)
         : Object(staticType()), dictionary(_dictionary), streamData(encodedData) {}
 
     static Stream *create_from_unencoded_data(Allocator &allocator,
                                               const UnorderedMap<std::string, Object *> &additionalDictionaryEntries,
-                                              std::string_view unencodedData);
+                                              std::string_view unencodedData,
+                                              const CompressionOptions &options = {});
 
+    /// decodes the stream into the internal arena, the result is kept for later calls
     [[nodiscard]] std::string_view decode(Allocator &allocator);
-    void encode(Allocator &allocator, const std::string &data);
+    /// decodes the stream into the given arena (e.g. the page arena), the result is kept for later calls (except on the
+    /// worker threads of Document::parallel_for_each_page)
+    [[nodiscard]] std::string_view decode(Allocator &allocator, Arena &arena);
+    /// forgets the decoded data and the parsed operators if they live in the given memory range (e.g. a page scope
+    /// that is about to end)
+    void forget_decoded_data(const uint8_t *start, const uint8_t *end);
+    /// compresses the data and replaces the stream data with it, the stream is left unchanged if that fails
+    [[nodiscard]] Result encode(Allocator &allocator, std::string_view data, const CompressionOptions &options = {});
+    /// decodes the stream and encodes it again with the given options
+    [[nodiscard]] Result recompress(Allocator &allocator, const CompressionOptions &options);
     [[nodiscard]] std::vector<std::string> filters() const;
 };
 
@@ -172,12 +251,8 @@ struct EmbeddedFile : public Stream {
     std::optional<int64_t> size();
     // TODO std::optional creation_date();
     // TODO std::optional mod_date();
-    // TODO std::optional check_sum();
-};
-
-struct Null : public Object {
-    static Type staticType() { return Type::NULL_OBJECT; }
-    explicit Null() : Object(staticType()) {}
+    /// the MD5 digest of the file (16 bytes), if the file specifies one
+    std::optional<std::string> check_sum();
 };
 
 struct ObjectStreamContent : public Object {
@@ -187,4 +262,8 @@ struct ObjectStreamContent : public Object {
 
 std::ostream &operator<<(std::ostream &os, Object::Type &type);
 
+/// Hash of everything that ends up in the serialized form of the object, including the objects nested inside of it,
+/// but not the ones it refers to. Objects with different hashes are guaranteed to be different.
+uint64_t content_hash(Object *object);
+
 } // namespace pdf
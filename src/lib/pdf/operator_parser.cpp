@@ -34,23 +34,40 @@ template <> std::string OperatorParser::operand(int index) {
     return std::string(tokens[currentTokenIdx - (1 + index)].content);
 }
 
-std::string replace(std::string str, const std::string &from, const std::string &to) {
-    size_t start_pos = str.find(from);
-    if (start_pos == std::string::npos)
-        return str;
-    str.replace(start_pos, from.length(), to);
-    return str;
-}
-
-Operator::Type stringToOperatorType(const std::string_view &t) {
-    // TODO using string replace to get around the 'x' <--> '*' issue, this could be improved
-#define CONDITION(Name, Description)                                                                                   \
-    if (t == replace(std::string(#Name), "x", "*")) {                                                                  \
-        return Operator::Type::Name##_##Description;                                                                   \
+/// packs the length and the characters of an operator name into an integer, operator names have at most three
+/// characters, longer names are all mapped to 0
+static constexpr uint32_t operator_key(std::string_view name) {
+    if (name.size() > 3) {
+        return 0;
     }
-    ENUMERATE_OPERATION_TYPES(CONDITION)
-#undef CONDITION
-    return Operator::Type::UNKNOWN_UNKNOWN;
+    uint32_t result = name.size();
+    for (size_t i = 0; i < name.size(); i++) {
+        result |= static_cast<uint32_t>(static_cast<uint8_t>(name[i])) << (8 * (i + 1));
+    }
+    return result;
+}
+
+/// the key of an operator name from ENUMERATE_OPERATION_TYPES, where 'x' stands for '*' (e.g. Tx for T*)
+static constexpr uint32_t enum_operator_key(std::string_view name) {
+    char buf[3] = {};
+    for (size_t i = 0; i < name.size() && i < 3; i++) {
+        buf[i] = name[i] == 'x' ? '*' : name[i];
+    }
+    return operator_key(name.size() > 3 ? name : std::string_view(buf, name.size()));
+}
+
+Operator::Type stringToOperatorType(std::string_view t) {
+    // the switch is turned into a jump table or a binary search by the compiler
+#define CASE(Name, Description)                                                                                        \
+    case enum_operator_key(#Name):                                                                                     \
+        return Operator::Type::Name##_##Description;
+
+    switch (operator_key(t)) {
+        ENUMERATE_OPERATION_TYPES(CASE)
+    default:
+        return Operator::Type::UNKNOWN_UNKNOWN;
+    }
+#undef CASE
 }
 
 std::ostream &operator<<(std::ostream &os, Operator::Type &type) {
@@ -84,32 +101,44 @@ std::string operatorTypeToString(Operator::Type &type) {
 Operator *OperatorParser::get_operator() {
     while (true) {
         while (currentTokenIdx >= tokens.size()) {
-            auto t = lexer.get_token();
+            auto t = next_token();
             if (!t.has_value()) {
                 return nullptr;
             }
-            tokens.push_back(t.value());
+            push_token(t.value());
         }
 
-        if (tokens[currentTokenIdx].type == Token::Type::NEW_LINE) {
-            lastOperatorEnd += tokens[currentTokenIdx].content.size();
+        if (tokens[currentTokenIdx].type == Token::Type::NEW_LINE && lastOperatorEnd != nullptr) {
+            set_last_operator_end(lastOperatorEnd + tokens[currentTokenIdx].content.size());
         }
 
         if (tokens[currentTokenIdx].type == Token::Type::OPERATOR) {
             if (lastOperatorEnd == nullptr) {
-                lastOperatorEnd = tokens[0].content.data();
+                set_last_operator_end(tokens[0].content.data());
             }
 
+            const auto type = stringToOperatorType(tokens[currentTokenIdx].content);
+            if (type == Operator::Type::BI_InlineImage && !read_inline_image()) {
+                spdlog::warn("Found an incomplete inline image in the operator stream");
+                return nullptr;
+            }
+
+            // the content of an inline image ends with "EI"
             const auto operatorContent               = tokens[currentTokenIdx].content;
             const auto operatorContentWithParameters = std::string_view(
                   lastOperatorEnd, (operatorContent.data() - lastOperatorEnd) + operatorContent.size());
-            lastOperatorEnd = operatorContent.data() + operatorContent.size();
-            if (*lastOperatorEnd == ' ') {
-                lastOperatorEnd++;
+            auto operatorEnd = operatorContent.data() + operatorContent.size();
+            if (*operatorEnd == ' ') {
+                operatorEnd++;
             }
+            set_last_operator_end(operatorEnd);
+
+            auto op = create_operator(type, operatorContentWithParameters);
 
-            auto op = create_operator(stringToOperatorType(operatorContent), operatorContentWithParameters);
-            currentTokenIdx++;
+            // the operands have been consumed, the next operator starts with an empty window
+            tokens.clear();
+            tokenOffsets.clear();
+            currentTokenIdx = 0;
             return op;
         }
 
@@ -122,6 +151,213 @@ Operator *OperatorParser::get_operator() {
     }
 }
 
+std::optional<Token> OperatorParser::next_token() {
+    auto token = lexer.get_token();
+    if (lexer.text_moved()) {
+        move_tokens();
+    }
+    return token;
+}
+
+void OperatorParser::push_token(const Token &token) {
+    tokens.push_back(token);
+    tokenOffsets.push_back(text_offset(token.content.data()));
+}
+
+void OperatorParser::set_last_operator_end(const char *end) {
+    lastOperatorEnd       = end;
+    lastOperatorEndOffset = text_offset(end);
+}
+
+size_t OperatorParser::text_offset(const char *position) {
+    const auto *start = lexer.text_start();
+    if (start == nullptr || position == nullptr) {
+        return 0;
+    }
+    return static_cast<size_t>(position - start);
+}
+
+void OperatorParser::move_tokens() {
+    // the old text might have been freed already, the new positions are computed from the offsets only
+    const auto *start  = lexer.text_start();
+    const auto dropped = lexer.dropped();
+    for (size_t i = 0; i < tokens.size(); i++) {
+        tokenOffsets[i] -= dropped;
+        tokens[i].content = std::string_view(start + tokenOffsets[i], tokens[i].content.size());
+    }
+    if (lastOperatorEnd != nullptr) {
+        lastOperatorEndOffset -= dropped;
+        lastOperatorEnd = start + lastOperatorEndOffset;
+    }
+    if (!inlineImageData.empty()) {
+        inlineImageDataOffset -= dropped;
+        inlineImageData = std::string_view(start + inlineImageDataOffset, inlineImageData.size());
+    }
+}
+
+/// maps the abbreviated keys of inline image dictionaries to the keys of image XObjects
+static std::string_view inline_image_key(std::string_view key) {
+    static const std::unordered_map<std::string_view, std::string_view> keys = {
+          {"BPC", "BitsPerComponent"},
+          {"CS", "ColorSpace"},
+          {"D", "Decode"},
+          {"DP", "DecodeParms"},
+          {"F", "Filter"},
+          {"H", "Height"},
+          {"IM", "ImageMask"},
+          {"I", "Interpolate"},
+          {"W", "Width"},
+    };
+    auto itr = keys.find(key);
+    return itr == keys.end() ? key : itr->second;
+}
+
+/// maps the abbreviated filter and color space names of inline images to their full names
+static void expand_inline_image_name(Name *name) {
+    static const std::unordered_map<std::string_view, std::string_view> names = {
+          {"AHx", "ASCIIHexDecode"},
+          {"A85", "ASCII85Decode"},
+          {"LZW", "LZWDecode"},
+          {"Fl", "FlateDecode"},
+          {"RL", "RunLengthDecode"},
+          {"CCF", "CCITTFaxDecode"},
+          {"DCT", "DCTDecode"},
+          {"G", "DeviceGray"},
+          {"RGB", "DeviceRGB"},
+          {"CMYK", "DeviceCMYK"},
+          {"I", "Indexed"},
+    };
+    auto itr = names.find(name->value);
+    if (itr != names.end()) {
+        name->value = itr->second;
+    }
+}
+
+static void expand_inline_image_names(Object *object) {
+    if (object->is<Name>()) {
+        expand_inline_image_name(object->as<Name>());
+    } else if (object->is<Array>()) {
+        for (auto &value : object->as<Array>()->values) {
+            if (value.is<Name>()) {
+                expand_inline_image_name(value.as<Name>());
+            }
+        }
+    }
+}
+
+/// Size of the data of an inline image in bytes. This is only known for images without filters, 0 is returned
+/// otherwise.
+static size_t inline_image_data_size(Dictionary *dictionary) {
+    if (dictionary->values.find("Filter") != dictionary->values.end()) {
+        return 0;
+    }
+
+    auto integer = [dictionary](const std::string &key) -> int64_t {
+        auto itr = dictionary->values.find(key);
+        if (itr == dictionary->values.end() || !itr->second.is<Integer>()) {
+            return 0;
+        }
+        return itr->second.as<Integer>()->value;
+    };
+
+    const auto imageMask = dictionary->values.find("ImageMask");
+    const auto isMask    = imageMask != dictionary->values.end() && imageMask->second.is<Boolean>() &&
+                        imageMask->second.as<Boolean>()->value;
+
+    int64_t components       = 0;
+    int64_t bitsPerComponent = isMask ? 1 : integer("BitsPerComponent");
+    if (isMask) {
+        components = 1;
+    } else if (auto itr = dictionary->values.find("ColorSpace"); itr != dictionary->values.end()) {
+        Object *colorSpace = itr->second;
+        if (colorSpace->is<Array>() && !colorSpace->as<Array>()->values.empty()) {
+            colorSpace = colorSpace->as<Array>()->values[0];
+        }
+        if (colorSpace->is<Name>()) {
+            const auto &name = colorSpace->as<Name>()->value;
+            if (name == "DeviceGray" || name == "CalGray" || name == "Indexed") {
+                components = 1;
+            } else if (name == "DeviceRGB" || name == "CalRGB" || name == "Lab") {
+                components = 3;
+            } else if (name == "DeviceCMYK") {
+                components = 4;
+            }
+        }
+    }
+
+    const auto width  = integer("Width");
+    const auto height = integer("Height");
+    if (width <= 0 || height <= 0 || components == 0 || bitsPerComponent <= 0) {
+        return 0;
+    }
+
+    // every row starts at a byte boundary
+    const auto bytesPerRow = (width * components * bitsPerComponent + 7) / 8;
+    return static_cast<size_t>(bytesPerRow * height);
+}
+
+bool OperatorParser::read_inline_image() {
+    // BI key1 value1 key2 value2 ... ID data EI
+    const auto dictionaryStart = currentTokenIdx + 1;
+    while (true) {
+        auto t = next_token();
+        if (!t.has_value() || t.value().type == Token::Type::INVALID) {
+            return false;
+        }
+        push_token(t.value());
+        if (t.value().type == Token::Type::OPERATOR && t.value().content == "ID") {
+            break;
+        }
+    }
+
+    auto dictionaryTokens = Vector<Token>(arena);
+    dictionaryTokens.reserve(tokens.size() - dictionaryStart + 1);
+    dictionaryTokens.emplace_back(Token::Type::DICTIONARY_START, "<<");
+    for (size_t i = dictionaryStart; i < tokens.size() - 1; i++) {
+        if (tokens[i].type != Token::Type::NEW_LINE && tokens[i].type != Token::Type::COMMENT) {
+            dictionaryTokens.push_back(tokens[i]);
+        }
+    }
+    dictionaryTokens.emplace_back(Token::Type::DICTIONARY_END, ">>");
+
+    auto l          = TokenLexer(dictionaryTokens);
+    auto p          = Parser(l, arena);
+    auto dictionary = p.parse();
+    if (dictionary == nullptr || !dictionary->is<Dictionary>()) {
+        return false;
+    }
+
+    auto values = UnorderedMap<std::string, Value>(arena);
+    for (auto &entry : dictionary->as<Dictionary>()->values) {
+        const auto key = inline_image_key(entry.first);
+        if (key == "Filter" || key == "ColorSpace") {
+            expand_inline_image_names(entry.second);
+        }
+        values[std::string(key)] = entry.second;
+    }
+    inlineImageDictionary = arena.push<Dictionary>(std::move(values));
+
+    // the returned data already points into the moved text, only the tokens have to be moved
+    auto data = lexer.advance_inline_image_data(inline_image_data_size(inlineImageDictionary));
+    if (lexer.text_moved()) {
+        move_tokens();
+    }
+    inlineImageData       = data;
+    inlineImageDataOffset = text_offset(data.data());
+
+    while (true) {
+        auto t = next_token();
+        if (!t.has_value() || (t.value().type != Token::Type::OPERATOR && t.value().type != Token::Type::NEW_LINE)) {
+            return false;
+        }
+        push_token(t.value());
+        if (t.value().type == Token::Type::OPERATOR) {
+            currentTokenIdx = tokens.size() - 1;
+            return t.value().content == "EI";
+        }
+    }
+}
+
 Operator *OperatorParser::create_operator_n(Operator *result) { return result; }
 Operator *OperatorParser::create_operator_q(Operator *result) { return result; }
 Operator *OperatorParser::create_operator_Q(Operator *result) { return result; }
@@ -151,7 +387,7 @@ Operator *OperatorParser::create_operator_rg(Operator *result) {
 
 Operator *OperatorParser::create_operator_TJ(Operator *result) {
     int arrayStartIndex = -1;
-    for (size_t i = 0; i < currentTokenIdx; i++) {
+    for (size_t i = 0; i <= currentTokenIdx; i++) {
         if (tokens[currentTokenIdx - i].type == Token::Type::ARRAY_START) {
             arrayStartIndex = currentTokenIdx - i;
             break;
@@ -421,7 +657,9 @@ Operator *OperatorParser::create_operator_sh(Operator *result) {
 }
 
 Operator *OperatorParser::create_operator_BI(Operator *result) {
-    // FIXME parse operator 'BI'
+    result->data.BI_InlineImage.stream = arena.push<Stream>(inlineImageDictionary, inlineImageData);
+    inlineImageDictionary              = nullptr;
+    inlineImageData                    = {};
     return result;
 }
 
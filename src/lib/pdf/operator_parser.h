@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -85,8 +86,8 @@ namespace pdf {
     O(k, UNKNOWN)                                                                                                      \
     /* Shading Pattern Operators TODO add more descriptive names */                                                    \
     O(sh, UNKNOWN)                                                                                                     \
-    /* Inline Image Operators TODO add more descriptive names */                                                       \
-    O(BI, UNKNOWN)                                                                                                     \
+    /* Inline Image Operators, ID and EI are part of BI */                                                             \
+    O(BI, InlineImage)                                                                                                 \
     O(ID, UNKNOWN)                                                                                                     \
     O(EI, UNKNOWN)                                                                                                     \
     /* XObject Operators TODO add more descriptive names */                                                            \
@@ -153,23 +154,37 @@ struct Operator {
         struct {
             Name *name;
         } Do_PaintXObject;
+        struct {
+            /// dictionary with unabbreviated keys and names, the data is referenced and not copied
+            Stream *stream;
+        } BI_InlineImage;
     } data;
 
     explicit Operator(Type _type, std::string_view _content) : type(_type), content(_content), data() {}
 };
 
-[[maybe_unused]] Operator::Type stringToOperatorType(const std::string &t);
+/// maps the name of an operator (e.g. "Tf" or "T*") to its type, unknown operators are mapped to UNKNOWN_UNKNOWN
+Operator::Type stringToOperatorType(std::string_view t);
 std::string operatorTypeToString(Operator::Type &type);
 std::ostream &operator<<(std::ostream &os, Operator::Type &type);
 
 struct OperatorParser {
     Lexer &lexer;
     Arena &arena;
-    Vector<Token> tokens;
-    size_t currentTokenIdx      = 0;
-    const char *lastOperatorEnd = nullptr;
-
-    explicit OperatorParser(Lexer &_lexer, Arena &_arena) : lexer(_lexer), arena(_arena), tokens(arena) {}
+    /// tokens since the last operator, the memory is reused for every operator
+    std::vector<Token> tokens;
+    /// offsets of the tokens, the end of the last operator and the inline image data from the start of the lexer's text
+    /// (see Lexer::text_moved())
+    std::vector<size_t> tokenOffsets;
+    size_t lastOperatorEndOffset = 0;
+    size_t inlineImageDataOffset = 0;
+    size_t currentTokenIdx       = 0;
+    const char *lastOperatorEnd  = nullptr;
+    /// dictionary and data of the inline image that is currently being parsed
+    Dictionary *inlineImageDictionary = nullptr;
+    std::string_view inlineImageData;
+
+    explicit OperatorParser(Lexer &_lexer, Arena &_arena) : lexer(_lexer), arena(_arena) {}
 
     Operator *get_operator();
 
@@ -181,6 +196,17 @@ struct OperatorParser {
     template <typename T> T operand(int) { ASSERT(false); }
 
     Operator *create_operator(Operator::Type type, std::string_view content);
+    /// gets the next token from the lexer and moves the tokens of the current operator if necessary
+    std::optional<Token> next_token();
+    /// reads the dictionary and the data of an inline image (BI ... ID ... EI), afterwards the current token is "EI"
+    [[nodiscard]] bool read_inline_image();
+    /// appends the token to the tokens of the current operator and remembers its offset
+    void push_token(const Token &token);
+    void set_last_operator_end(const char *end);
+    /// offset of the given position from the start of the lexer's text
+    size_t text_offset(const char *position);
+    /// moves the tokens of the current operator along with the text of the lexer (see Lexer::text_moved())
+    void move_tokens();
 
 #define __BYTECODE_OP(Name, Description) Operator *create_operator_##Name(Operator *result);
     ENUMERATE_OPERATION_TYPES(__BYTECODE_OP)
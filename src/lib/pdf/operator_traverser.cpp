@@ -6,11 +6,11 @@
 
 namespace pdf {
 
+// the collected data belongs to the page, which is why it is allocated in the page arena
 OperatorTraverser::OperatorTraverser(Page &_page)
-    : page(_page), stateStack(_page.document.allocator), textBlocks(_page.document.allocator),
-      images(_page.document.allocator) {
-    stateStack.emplace_back();
-}
+    : page(_page), stateStack(StlAllocator<GraphicsState>::page(_page.document.allocator)),
+      textBlocks(StlAllocator<TextBlock>::page(_page.document.allocator)),
+      images(StlAllocator<PageImage>::page(_page.document.allocator)) {}
 
 void OperatorTraverser::traverse(cairo_t *crIn) {
     if (!dirty) {
@@ -20,11 +20,17 @@ void OperatorTraverser::traverse(cairo_t *crIn) {
         return;
     }
 
+    auto tagScope = AllocationTagScope(page.document.allocator, AllocationTag::RENDER);
+    if (recordingSurface != nullptr) {
+        cairo_surface_destroy(recordingSurface);
+    }
     recordingSurface = cairo_recording_surface_create(CAIRO_CONTENT_COLOR, nullptr);
     auto cr          = cairo_create(recordingSurface);
 
     images.clear();
     textBlocks.clear();
+    stateStack.clear();
+    stateStack.emplace_back();
 
     cairo_save(cr);
 
@@ -54,6 +60,7 @@ void OperatorTraverser::traverse(cairo_t *crIn) {
     }
 
     cairo_restore(cr);
+    cairo_destroy(cr);
 
     cairo_set_source_surface(crIn, recordingSurface, 0.0, 0.0);
     cairo_paint(crIn);
@@ -61,6 +68,20 @@ void OperatorTraverser::traverse(cairo_t *crIn) {
     dirty = false;
 }
 
+void OperatorTraverser::reset() {
+    dirty                = true;
+    currentContentStream = nullptr;
+    if (recordingSurface != nullptr) {
+        cairo_surface_destroy(recordingSurface);
+        recordingSurface = nullptr;
+    }
+
+    // swapping with empty vectors releases the buffers, clear() would keep them
+    Vector<GraphicsState>(stateStack.get_allocator()).swap(stateStack);
+    Vector<TextBlock>(textBlocks.get_allocator()).swap(textBlocks);
+    Vector<PageImage>(images.get_allocator()).swap(images);
+}
+
 void OperatorTraverser::apply_operator(cairo_t *cr, Operator *op) {
     //    spdlog::info("{}", operatorTypeToString(op->type));
     switch (op->type) {
@@ -104,7 +125,8 @@ void OperatorTraverser::apply_operator(cairo_t *cr, Operator *op) {
         showText(cr, op);
         break;
     case Operator::Type::Do_PaintXObject:
-        onDo(cr, op);
+    case Operator::Type::BI_InlineImage:
+        paintImage(cr, op);
         break;
     default:
         // TODO unknown operator
@@ -208,8 +230,13 @@ void OperatorTraverser::setTextFontAndSize(cairo_t *cr, Operator *op) {
     if (fontFace != nullptr) {
         state().textState.textFont.ftFace = fontFace;
 
+        // the FreeType face is released together with the Cairo font face, which lives as long as it is in use
+        static cairo_user_data_key_t ftFaceKey;
         auto cairo_ff = cairo_ft_font_face_create_for_ft_face(fontFace, 0);
+        cairo_font_face_set_user_data(cairo_ff, &ftFaceKey, fontFace,
+                                      [](void *face) { Font::release_font_face(static_cast<FT_Face>(face)); });
         cairo_set_font_face(cr, cairo_ff);
+        cairo_font_face_destroy(cairo_ff);
     }
 }
 
@@ -217,11 +244,11 @@ void OperatorTraverser::showText(cairo_t *cr, Operator *op) {
     const auto &textState = state().textState;
     cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
 
-    auto scaledFont = cairo_get_scaled_font(cr);
-    auto values     = op->data.TJ_ShowOneOrMoreTextStrings.objects->values;
-    auto glyphs     = std::vector<cairo_glyph_t>();
-    double xOffset  = 0;
-    for (auto value : values) {
+    auto scaledFont    = cairo_get_scaled_font(cr);
+    const auto &values = op->data.TJ_ShowOneOrMoreTextStrings.objects->values;
+    auto glyphs        = std::vector<cairo_glyph_t>();
+    double xOffset     = 0;
+    for (const auto &value : values) {
         if (value->is<Integer>()) {
             auto i = value->as<Integer>();
             xOffset -= static_cast<double>(i->value) / 1000.0;
@@ -258,6 +285,8 @@ void OperatorTraverser::showText(cairo_t *cr, Operator *op) {
                 cairo_scaled_font_glyph_extents(scaledFont, &glyph, 1, &extents);
                 xOffset += static_cast<double>(extents.x_advance);
             }
+            cairo_glyph_free(newGlyphs);
+            cairo_text_cluster_free(clusters);
         }
     }
 
@@ -275,7 +304,7 @@ void OperatorTraverser::showText(cairo_t *cr, Operator *op) {
 
     double offsetX = 0.0;
     std::string text;
-    for (auto value : op->data.TJ_ShowOneOrMoreTextStrings.objects->values) {
+    for (auto &value : op->data.TJ_ShowOneOrMoreTextStrings.objects->values) {
         if (value->is<HexadecimalString>()) {
             if (cmapOpt.has_value()) {
                 text += cmapOpt.value()->map_char_codes(value->as<HexadecimalString>());
@@ -315,7 +344,7 @@ void OperatorTraverser::showText(cairo_t *cr, Operator *op) {
     });
 }
 
-void OperatorTraverser::onDo(cairo_t *cr, Operator *op) {
+void OperatorTraverser::paintImage(cairo_t *cr, Operator *op) {
     auto pageImageResult = pdf::PageImage::create(page, state().ctm, op, currentContentStream);
     if (pageImageResult.has_error()) {
         return;
@@ -325,7 +354,7 @@ void OperatorTraverser::onDo(cairo_t *cr, Operator *op) {
     images.push_back(pageImage);
 
     auto image               = pageImage.image;
-    auto pixels              = image->decode(page.document.allocator);
+    auto pixels              = image->decode(page.document.allocator, page.document.allocator.page());
     auto width               = image->width();
     auto height              = image->height();
     auto bitsPerComponentOpt = image->bits_per_component();
@@ -335,9 +364,13 @@ void OperatorTraverser::onDo(cairo_t *cr, Operator *op) {
 
     const auto stride   = cairo_format_stride_for_width(CAIRO_FORMAT_RGB24, width);
     auto currentRowSize = static_cast<int32_t>((bitsPerComponentOpt.value()->value * 3 * width) / 32.0 * 4.0);
+    if (pixels.size() < static_cast<size_t>(currentRowSize) * height) {
+        // TODO support images that don't use three components
+        return;
+    }
 
     auto tempArena = page.document.allocator.temporary();
-    auto pBuf      = tempArena.arena().push(stride * height);
+    auto pBuf      = tempArena.arena().push(stride * height, CACHE_LINE_SIZE);
     for (int row = 0; row < height; row++) {
         for (int col = 0; col < width; col++) {
             auto pBufIndex      = (height - row - 1) * stride + col * 4;
@@ -356,6 +389,16 @@ void OperatorTraverser::onDo(cairo_t *cr, Operator *op) {
 }
 
 ValueResult<PageImage> PageImage::create(Page &page, const cairo_matrix_t &ctm, Operator *op, ContentStream *cs) {
+    double xOffset = 0.0;
+    double yOffset = 0.0;
+    cairo_matrix_transform_point(&ctm, &xOffset, &yOffset);
+
+    if (op->type == Operator::Type::BI_InlineImage) {
+        // inline images don't have a name
+        auto image = op->data.BI_InlineImage.stream->as<XObjectImage>();
+        return ValueResult<PageImage>::ok(PageImage(&page, "", xOffset, yOffset, image, op, cs));
+    }
+
     const auto &xObjectName = op->data.Do_PaintXObject.name->value;
 
     const auto xObjectMapOpt = page.attr_resources()->x_objects(page.document);
@@ -377,9 +420,6 @@ ValueResult<PageImage> PageImage::create(Page &page, const cairo_matrix_t &ctm,
         return ValueResult<PageImage>::error("XObject is not an image");
     }
 
-    double xOffset = 0.0;
-    double yOffset = 0.0;
-    cairo_matrix_transform_point(&ctm, &xOffset, &yOffset);
     auto pageImage = PageImage(&page, xObjectKey, xOffset, yOffset, xObject->as<XObjectImage>(), op, cs);
     return ValueResult<PageImage>::ok(pageImage);
 }
@@ -417,7 +457,11 @@ void PageImage::move(Document &document, double offsetX, double offsetY) const {
 
     ss << decoded.substr(bytesUntilOperator + op->content.size());
 
-    cs->encode(document.allocator, ss.str());
+    if (auto result = cs->encode(document.allocator, ss.str(), document.editCompression); result.has_error()) {
+        spdlog::error("Failed to move image '{}': {}", name, result.message());
+        return;
+    }
+    document.mark_dirty(cs);
 
     page->traverser.dirty = true;
 
@@ -454,7 +498,11 @@ void TextBlock::move(Document &document, double offsetX, double offsetY) const {
 
     ss << decoded.substr(op->content.data() - decoded.data() + op->content.size());
 
-    cs->encode(document.allocator, ss.str());
+    if (auto result = cs->encode(document.allocator, ss.str(), document.editCompression); result.has_error()) {
+        spdlog::error("Failed to move text block '{}': {}", text, result.message());
+        return;
+    }
+    document.mark_dirty(cs);
 
     page->traverser.dirty = true;
 
@@ -163,9 +163,13 @@ struct OperatorTraverser {
         const auto surface = cairo_recording_surface_create(CAIRO_CONTENT_COLOR, nullptr);
         const auto cr      = cairo_create(surface);
         traverse(cr);
+        cairo_destroy(cr);
+        cairo_surface_destroy(surface);
     }
 
     void traverse(cairo_t *cr);
+    /// drops the recorded drawing and everything that has been collected, the next traversal starts from scratch
+    void reset();
 
   protected:
     GraphicsState &state() { return stateStack.back(); }
@@ -186,7 +190,8 @@ struct OperatorTraverser {
     void modifyClippingPathUsingEvenOddRule() const;
     void appendRectangle() const;
     void showText(cairo_t *cr, Operator *);
-    void onDo(cairo_t *cr, Operator *);
+    /// paints image XObjects (Do) and inline images (BI)
+    void paintImage(cairo_t *cr, Operator *);
 };
 
 } // namespace pdf
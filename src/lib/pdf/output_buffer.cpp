@@ -0,0 +1,147 @@
+#include "output_buffer.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "pdf/util/debug.h"
+
+namespace pdf {
+
+const size_t INITIAL_MEMORY_BUFFER_SIZE = 64 * 1024; // 64 KB
+
+static const char DIGIT_PAIRS[201] = "00010203040506070809"
+                                     "10111213141516171819"
+                                     "20212223242526272829"
+                                     "30313233343536373839"
+                                     "40414243444546474849"
+                                     "50515253545556575859"
+                                     "60616263646566676869"
+                                     "70717273747576777879"
+                                     "80818283848586878889"
+                                     "90919293949596979899";
+
+/// fills the numDigits characters in front of end with the number, two digits at a time
+static inline void format_zero_padded(char *end, uint64_t number, size_t numDigits) {
+    auto start = end - numDigits;
+    while (end - start >= 2) {
+        end -= 2;
+        std::memcpy(end, DIGIT_PAIRS + (number % 100) * 2, 2);
+        number /= 100;
+    }
+    if (end != start) {
+        *--end = static_cast<char>('0' + number % 10);
+        number /= 10;
+    }
+    ASSERT(number == 0);
+}
+
+OutputBuffer::OutputBuffer() : OutputBuffer(INITIAL_MEMORY_BUFFER_SIZE) {}
+
+OutputBuffer::OutputBuffer(size_t initialCapacityInBytes) {
+    bufferStart = static_cast<char *>(std::malloc(initialCapacityInBytes));
+    position    = bufferStart;
+    // without a buffer, every write takes the slow path, which tries to allocate it again
+    capacityEnd = bufferStart == nullptr ? nullptr : bufferStart + initialCapacityInBytes;
+}
+
+OutputBuffer::OutputBuffer(std::FILE *_file, size_t bufferSizeInBytes) : file(_file) {
+    bufferStart = static_cast<char *>(std::malloc(bufferSizeInBytes));
+    position    = bufferStart;
+    // without a buffer, every write goes straight to the file
+    capacityEnd = bufferStart == nullptr ? nullptr : bufferStart + bufferSizeInBytes;
+}
+
+OutputBuffer::~OutputBuffer() { std::free(bufferStart); }
+
+void OutputBuffer::write_slow(const char *data, size_t size) {
+    if (file == nullptr) {
+        if (!grow(size)) {
+            hasError = true;
+            return;
+        }
+        std::memcpy(position, data, size);
+        position += size;
+        return;
+    }
+
+    if (flush().has_error()) {
+        return;
+    }
+
+    if (size >= static_cast<size_t>(capacityEnd - bufferStart)) {
+        // large writes (e.g. stream data) bypass the buffer
+        if (std::fwrite(data, 1, size, file) != size) {
+            hasError = true;
+        }
+        flushedSizeInBytes += size;
+        return;
+    }
+
+    std::memcpy(position, data, size);
+    position += size;
+}
+
+bool OutputBuffer::grow(size_t minimumCapacity) {
+    auto usedSize    = static_cast<size_t>(position - bufferStart);
+    auto newCapacity = std::max(static_cast<size_t>(capacityEnd - bufferStart) * 2, usedSize + minimumCapacity);
+    auto newBuffer   = static_cast<char *>(std::realloc(bufferStart, newCapacity));
+    if (newBuffer == nullptr) {
+        // the old buffer is still valid
+        return false;
+    }
+    bufferStart = newBuffer;
+    position    = newBuffer + usedSize;
+    capacityEnd = newBuffer + newCapacity;
+    return true;
+}
+
+void OutputBuffer::write_real(double number) {
+    // large enough for DBL_MAX in fixed notation
+    char buf[400];
+    auto result = std::to_chars(buf, buf + sizeof(buf), number, std::chars_format::fixed, 6);
+    write(buf, result.ptr - buf);
+}
+
+void OutputBuffer::write_zero_padded(uint64_t number, size_t numDigits) {
+    char buf[20];
+    ASSERT(numDigits <= sizeof(buf));
+    format_zero_padded(buf + numDigits, number, numDigits);
+    write(buf, numDigits);
+}
+
+void OutputBuffer::write_xref_entry(uint64_t number, uint64_t generation, char type) {
+    // nnnnnnnnnn ggggg t\r\n (with a space instead of \r)
+    char buf[20] = {' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', ' ', '\n'};
+    format_zero_padded(buf + 10, number, 10);
+    format_zero_padded(buf + 16, generation, 5);
+    buf[17] = type;
+    write(buf, sizeof(buf));
+}
+
+Result OutputBuffer::flush() {
+    if (file == nullptr) {
+        return Result::ok();
+    }
+
+    auto usedSize = static_cast<size_t>(position - bufferStart);
+    if (std::fwrite(bufferStart, 1, usedSize, file) != usedSize) {
+        hasError = true;
+    }
+    flushedSizeInBytes += usedSize;
+    position = bufferStart;
+
+    return Result::from_bool(hasError, "Failed to write data to file");
+}
+
+uint8_t *OutputBuffer::release(size_t &sizeInBytes) {
+    ASSERT(file == nullptr);
+    sizeInBytes = static_cast<size_t>(position - bufferStart);
+
+    auto result = reinterpret_cast<uint8_t *>(bufferStart);
+    bufferStart = nullptr;
+    position    = nullptr;
+    capacityEnd = nullptr;
+    return result;
+}
+
+} // namespace pdf
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+#include "pdf/util/result.h"
+
+namespace pdf {
+
+const size_t OUTPUT_BUFFER_SIZE = 1024 * 1024; // 1 MB
+
+/// Output sink for serializing documents. It either collects everything in one growable in-memory buffer, or it
+/// collects the data in a fixed size buffer that is written to a file whenever it is full.
+struct OutputBuffer {
+    /// creates an in-memory buffer
+    OutputBuffer();
+    /// creates an in-memory buffer which can hold initialCapacityInBytes before it has to grow
+    explicit OutputBuffer(size_t initialCapacityInBytes);
+    /// creates a buffer that writes to the given file, the file is not closed by the buffer
+    explicit OutputBuffer(std::FILE *file, size_t bufferSizeInBytes = OUTPUT_BUFFER_SIZE);
+    ~OutputBuffer();
+
+    OutputBuffer(const OutputBuffer &)            = delete;
+    OutputBuffer &operator=(const OutputBuffer &) = delete;
+
+    void write(const char *data, size_t size) {
+        if (size <= static_cast<size_t>(capacityEnd - position)) {
+            std::memcpy(position, data, size);
+            position += size;
+            return;
+        }
+        write_slow(data, size);
+    }
+
+    OutputBuffer &operator<<(std::string_view str) {
+        write(str.data(), str.size());
+        return *this;
+    }
+    /// the length of string literals is computed at compile time once this is inlined, which turns the copy into a
+    /// few plain stores
+    OutputBuffer &operator<<(const char *str) { return *this << std::string_view(str); }
+    OutputBuffer &operator<<(const std::string &str) { return *this << std::string_view(str); }
+    OutputBuffer &operator<<(char c) {
+        if (position == capacityEnd) {
+            write_slow(&c, 1);
+            return *this;
+        }
+        *position++ = c;
+        return *this;
+    }
+    template <std::integral T>
+        requires(!std::same_as<T, char> && !std::same_as<T, bool>)
+    OutputBuffer &operator<<(T number) {
+        char buf[24];
+        auto result = std::to_chars(buf, buf + sizeof(buf), number);
+        write(buf, result.ptr - buf);
+        return *this;
+    }
+
+    /// writes the number with the same formatting as std::to_string (fixed notation with 6 decimal places)
+    void write_real(double number);
+    /// writes the number with leading zeros, so that it is exactly numDigits characters long
+    void write_zero_padded(uint64_t number, size_t numDigits);
+    /// writes one 20 byte entry of a cross-reference table
+    void write_xref_entry(uint64_t number, uint64_t generation, char type);
+
+    /// number of bytes that have been written so far
+    [[nodiscard]] size_t size() const { return flushedSizeInBytes + (position - bufferStart); }
+    /// content of the in-memory buffer
+    [[nodiscard]] std::string_view str() const { return {bufferStart, static_cast<size_t>(position - bufferStart)}; }
+    [[nodiscard]] bool has_error() const { return hasError; }
+    /// marks the output as failed, e.g. because data that should have been part of it could not be produced
+    void set_error() { hasError = true; }
+
+    /// writes the buffered data to the file
+    Result flush();
+    /// hands the in-memory buffer over to the caller, who has to free() it
+    uint8_t *release(size_t &sizeInBytes);
+
+  private:
+    std::FILE *file           = nullptr;
+    char *bufferStart         = nullptr;
+    char *position            = nullptr;
+    char *capacityEnd         = nullptr;
+    size_t flushedSizeInBytes = 0;
+    bool hasError             = false;
+
+    void write_slow(const char *data, size_t size);
+    bool grow(size_t minimumCapacity);
+};
+
+} // namespace pdf
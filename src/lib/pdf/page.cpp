@@ -1,8 +1,10 @@
 #include "page.h"
 
+#include <algorithm>
 #include <sstream>
 
 #include "pdf/operator_parser.h"
+#include "pdf/stream_reader.h"
 
 namespace pdf {
 
@@ -44,16 +46,30 @@ std::vector<ContentStream *> Page::content_streams() {
 }
 
 void ContentStream::for_each_operator(Allocator &allocator, const std::function<ForEachResult(Operator *)> &func) {
-    auto decoded        = decode(allocator);
-    auto textProvider   = StringTextProvider(decoded);
+    for_each_operator<const std::function<ForEachResult(Operator *)> &>(allocator, func);
+}
+
+void ContentStream::keep_operators(Allocator &allocator, const std::vector<Operator *> &parsed) {
+    // an empty stream still gets a (non-null) array, so that it is not parsed again
+    operators = allocator.page().push_array<Operator *>(std::max(parsed.size(), size_t(1)));
+    std::copy(parsed.begin(), parsed.end(), operators);
+    operatorCount = parsed.size();
+}
+
+void ContentStream::stream_operators(Allocator &allocator, const std::function<ForEachResult(Operator *)> &func) {
+    auto textProvider   = StreamTextProvider(allocator, this);
     auto lexer          = TextLexer(textProvider);
-    auto operatorParser = OperatorParser(lexer, allocator.arena());
-    Operator *op        = operatorParser.get_operator();
+    auto temp           = allocator.temporary();
+    auto operatorParser = OperatorParser(lexer, temp.arena());
+
+    // the memory of an operator is reused for the next one
+    auto start   = temp.arena().current_buffer_position();
+    Operator *op = operatorParser.get_operator();
     while (op != nullptr) {
-        ForEachResult result = func(op);
-        if (result == ForEachResult::BREAK) {
+        if (func(op) == ForEachResult::BREAK) {
             break;
         }
+        temp.arena().rewind(start);
         op = operatorParser.get_operator();
     }
 }
@@ -61,7 +77,7 @@ void ContentStream::for_each_operator(Allocator &allocator, const std::function<
 size_t count_TJ_characters(CMap *cmap, Operator *op) {
     // TODO skip whitespace characters
     size_t result = 0;
-    for (auto value : op->data.TJ_ShowOneOrMoreTextStrings.objects->values) {
+    for (auto &value : op->data.TJ_ShowOneOrMoreTextStrings.objects->values) {
         if (value->is<Integer>()) {
             // do nothing
         } else if (value->is<HexadecimalString>()) {
@@ -101,7 +117,7 @@ size_t Page::character_count() {
     auto contentStreams = content_streams();
     CMap *cmap          = nullptr;
     for (auto contentStream : contentStreams) {
-        contentStream->for_each_operator(document.allocator, [&result, this, &cmap](Operator *op) {
+        auto countCharacters = [&result, this, &cmap](Operator *op) {
             if (op->type == Operator::Type::TJ_ShowOneOrMoreTextStrings) {
                 result += count_TJ_characters(cmap, op);
             } else if (op->type == Operator::Type::Tj_ShowTextString) {
@@ -120,30 +136,58 @@ size_t Page::character_count() {
             }
 
             return ForEachResult::CONTINUE;
-        });
+        };
+
+        // large content streams are not decoded as a whole, unless they have been parsed already
+        if (contentStream->operators == nullptr && contentStream->streamData.size() > STREAMED_CONTENT_STREAM_SIZE) {
+            contentStream->stream_operators(document.allocator, countCharacters);
+        } else {
+            contentStream->for_each_operator(document.allocator, countCharacters);
+        }
     }
     return result;
 }
 
-Vector<TextBlock> Page::text_blocks() {
+std::span<TextBlock> Page::text_blocks() {
     traverser.traverse();
     return traverser.textBlocks;
 }
 
-Vector<PageImage> Page::images() {
+std::span<PageImage> Page::images() {
     traverser.traverse();
     return traverser.images;
 }
 
 void Page::for_each_image(const std::function<ForEachResult(PageImage &)> &func) {
-    auto images = this->images();
-    for (auto &image : images) {
-        if (func(image) == ForEachResult::BREAK) {
-            break;
-        }
-    }
+    for_each_image<const std::function<ForEachResult(PageImage &)> &>(func);
 }
 
 void Page::render(cairo_t *cr) { traverser.traverse(cr); }
 
+PageScope::~PageScope() {
+    auto start = arenaScope.start_position();
+    auto end   = page.document.allocator.page().current_buffer_position();
+
+    page.traverser.reset();
+    if (page.document.allocator.is_worker()) {
+        // workers don't keep anything in the streams
+        return;
+    }
+
+    // decoded data is kept in the streams, which outlive the scope
+    for (auto contentStream : page.content_streams()) {
+        contentStream->forget_decoded_data(start, end);
+    }
+    auto resourcesOpt = page.node->attribute<Resources>(page.document, "Resources", true);
+    auto xObjectsOpt  = resourcesOpt.has_value() ? resourcesOpt.value()->x_objects(page.document) : std::nullopt;
+    if (xObjectsOpt.has_value()) {
+        for (auto &entry : xObjectsOpt.value()->values) {
+            auto object = page.document.get<Object>(entry.second);
+            if (object->is<Stream>()) {
+                object->as<Stream>()->forget_decoded_data(start, end);
+            }
+        }
+    }
+}
+
 } // namespace pdf
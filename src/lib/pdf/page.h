@@ -1,5 +1,6 @@
 #pragma once
 
+#include <span>
 #include <utility>
 
 #include "pdf/document.h"
@@ -53,8 +54,56 @@ struct Resources : public Dictionary {
     std::optional<FontMap *> fonts(Document &document) { return document.get<FontMap>(find<Object>("Font")); }
 };
 
+/// Content streams larger than this (encoded) are parsed while they are being decoded, if their operators are not
+/// needed later on. Only Page::character_count() does that, the OperatorTraverser keeps the operators of text blocks
+/// and images and therefore always parses the decoded stream.
+const size_t STREAMED_CONTENT_STREAM_SIZE = 1024 * 1024; // 1 MB
+
 struct ContentStream : public Stream {
+    /// the operators are handed to func while they are parsed on the first call, they are kept until the stream is
+    /// edited or its page scope ends (if func does not break early)
     void for_each_operator(Allocator &allocator, const std::function<ForEachResult(Operator *)> &func);
+    /// Same as above, but func is called directly (and can be inlined) instead of through a std::function
+    template <typename Func> void for_each_operator(Allocator &allocator, Func &&func) {
+        if (operators != nullptr) {
+            for (size_t i = 0; i < operatorCount; i++) {
+                if (func(operators[i]) == ForEachResult::BREAK) {
+                    break;
+                }
+            }
+            return;
+        }
+
+        // the operators of a worker live in its own arena, they can't be kept in a stream that other pages might share
+        const auto keep     = !allocator.is_worker();
+        const auto data     = streamData.data();
+        auto &arena         = allocator.page();
+        auto textProvider   = StringTextProvider(decode(allocator, arena));
+        auto lexer          = TextLexer(textProvider);
+        auto operatorParser = OperatorParser(lexer, arena);
+        auto parsed         = std::vector<Operator *>();
+        for (auto op = operatorParser.get_operator(); op != nullptr; op = operatorParser.get_operator()) {
+            if (keep) {
+                parsed.push_back(op);
+            }
+            if (func(op) == ForEachResult::BREAK) {
+                // the rest of the stream is not parsed, which leaves the operators incomplete
+                return;
+            }
+        }
+
+        // func might have replaced the data of the stream
+        if (keep && operators == nullptr && streamData.data() == data) {
+            keep_operators(allocator, parsed);
+        }
+    }
+    /// parses the operators while the stream is being decoded, without keeping the decoded data or the operators
+    /// around, the memory usage does not depend on the size of the stream
+    /// NOTE an operator is only valid during the call to func
+    void stream_operators(Allocator &allocator, const std::function<ForEachResult(Operator *)> &func);
+
+  private:
+    void keep_operators(Allocator &allocator, const std::vector<Operator *> &parsed);
 };
 
 struct Page {
@@ -85,9 +134,19 @@ struct Page {
     }
     std::optional<Object *> attr_contents() { return node->attribute<Object>(document, "Contents", false); }
     std::vector<ContentStream *> content_streams();
-    Vector<TextBlock> text_blocks();
-    Vector<PageImage> images();
+    /// views of the results of the traverser, they are valid until the traverser is reset (e.g. by the PageScope)
+    std::span<TextBlock> text_blocks();
+    std::span<PageImage> images();
     void for_each_image(const std::function<ForEachResult(PageImage &)> &func);
+    template <typename Func> void for_each_image(Func &&func) {
+        traverser.traverse();
+        // indexed, because func might modify the page
+        for (size_t i = 0; i < traverser.images.size(); i++) {
+            if (func(traverser.images[i]) == ForEachResult::BREAK) {
+                break;
+            }
+        }
+    }
 
     int64_t rotate();
     double attr_width();
@@ -98,4 +157,21 @@ struct Page {
     void render(cairo_t *cr);
 };
 
+/// Processes a page in bounded memory. While a PageScope is open, everything that is produced for the page (decoded
+/// content streams and images, operators, text blocks, page images, CMaps) is allocated in the page arena and released
+/// when the scope ends. Objects of the document (e.g. fonts and resources) are still loaded into the internal arena.
+/// Results have to be copied out before the scope ends: TextBlock::text is owned by the TextBlock, but TextBlock::op,
+/// PageImage::op and the views returned by text_blocks() and images() point into the page arena.
+struct PageScope {
+    explicit PageScope(Page &_page) : page(_page), arenaScope(_page.document.allocator) {}
+    ~PageScope();
+
+    PageScope(const PageScope &)            = delete;
+    PageScope &operator=(const PageScope &) = delete;
+
+  private:
+    Page &page;
+    PageArenaScope arenaScope;
+};
+
 } // namespace pdf
@@ -25,12 +25,25 @@ bool Parser::ensure_tokens_have_been_lexed() {
             return false;
         }
 
+        if (firstTokenData == nullptr) {
+            firstTokenData = token.value().content.data();
+        }
         tokens.push_back(token.value());
     }
 
     return true;
 }
 
+void Parser::discard_consumed_tokens() {
+    if (currentTokenIdx == 0) {
+        return;
+    }
+
+    // only the tokens that have been looked ahead are kept
+    tokens.erase_front(currentTokenIdx);
+    currentTokenIdx = 0;
+}
+
 bool Parser::current_token_is(Token::Type type) {
     if (!ensure_tokens_have_been_lexed()) {
         return false;
@@ -39,29 +52,26 @@ bool Parser::current_token_is(Token::Type type) {
     return tokens[currentTokenIdx].type == type;
 }
 
-Boolean *Parser::parse_boolean() {
+std::optional<bool> Parser::parse_boolean_value() {
     if (!current_token_is(Token::Type::BOOLEAN)) {
-        return nullptr;
+        return {};
     }
     auto content = tokens[currentTokenIdx].content;
 
     currentTokenIdx++;
 
-    bool value = false;
     if (content == "true") {
-        value = true;
+        return true;
     } else if (content == "false") {
-        value = false;
-    } else {
-        // TODO add logging
-        return nullptr;
+        return false;
     }
-    return arena.push<Boolean>(value);
+    // TODO add logging
+    return {};
 }
 
-Integer *Parser::parse_integer() {
+std::optional<int64_t> Parser::parse_integer_value() {
     if (!current_token_is(Token::Type::INTEGER)) {
-        return nullptr;
+        return {};
     }
 
     auto content = tokens[currentTokenIdx].content;
@@ -69,18 +79,18 @@ Integer *Parser::parse_integer() {
         // TODO is this conversion to a string really necessary?
         int64_t value = std::stoll(std::string(content));
         currentTokenIdx++;
-        return arena.push<Integer>(value);
+        return value;
     } catch (std::invalid_argument &) {
         // TODO add logging
     } catch (std::out_of_range &) {
         // TODO add logging
     }
-    return nullptr;
+    return {};
 }
 
-Real *Parser::parse_real() {
+std::optional<double> Parser::parse_real_value() {
     if (!current_token_is(Token::Type::REAL)) {
-        return nullptr;
+        return {};
     }
 
     auto content = tokens[currentTokenIdx].content;
@@ -88,24 +98,84 @@ Real *Parser::parse_real() {
         // TODO is this conversion to a string really necessary?
         double value = std::stod(std::string(content));
         currentTokenIdx++;
-        return arena.push<Real>(value);
+        return value;
     } catch (std::invalid_argument &) {
         // TODO add logging
     } catch (std::out_of_range &) {
         // TODO add logging
     }
-    return nullptr;
+    return {};
 }
 
-Null *Parser::parse_null_object() {
+bool Parser::parse_null_value() {
     if (!current_token_is(Token::Type::NULL_OBJ)) {
-        return nullptr;
+        return false;
     }
 
     currentTokenIdx++;
+    return true;
+}
+
+Boolean *Parser::parse_boolean() {
+    auto value = parse_boolean_value();
+    if (!value.has_value()) {
+        return nullptr;
+    }
+    return arena.push<Boolean>(value.value());
+}
+
+Integer *Parser::parse_integer() {
+    auto value = parse_integer_value();
+    if (!value.has_value()) {
+        return nullptr;
+    }
+    return arena.push<Integer>(value.value());
+}
+
+Real *Parser::parse_real() {
+    auto value = parse_real_value();
+    if (!value.has_value()) {
+        return nullptr;
+    }
+    return arena.push<Real>(value.value());
+}
+
+Null *Parser::parse_null_object() {
+    if (!parse_null_value()) {
+        return nullptr;
+    }
     return arena.push<Null>();
 }
 
+std::optional<Value> Parser::parse_value() {
+    ignore_new_lines_and_comments();
+
+    auto boolean = parse_boolean_value();
+    if (boolean.has_value()) {
+        return Value::create<Boolean>(boolean.value());
+    }
+
+    auto integer = parse_integer_value();
+    if (integer.has_value()) {
+        return Value::create<Integer>(integer.value());
+    }
+
+    auto real = parse_real_value();
+    if (real.has_value()) {
+        return Value::create<Real>(real.value());
+    }
+
+    if (parse_null_value()) {
+        return Value::create<Null>();
+    }
+
+    auto object = parse();
+    if (object == nullptr) {
+        return {};
+    }
+    return Value(object);
+}
+
 LiteralString *Parser::parse_literal_string() {
     if (!current_token_is(Token::Type::LITERAL_STRING)) {
         return nullptr;
@@ -144,26 +214,30 @@ Array *Parser::parse_array() {
     auto beforeTokenIdx = currentTokenIdx;
     currentTokenIdx++;
 
-    auto objects = Vector<Object *>(arena);
+    // nested arrays push their elements on top of the ones of this array
+    auto firstValueIdx = arrayValues.size();
     while (true) {
         ignore_new_lines_and_comments();
 
         if (current_token_is(Token::Type::ARRAY_END)) {
             break;
         }
-        auto object = parse();
-        if (object == nullptr) {
+        auto value = parse_value();
+        if (!value.has_value()) {
+            arrayValues.resize(firstValueIdx);
             currentTokenIdx = beforeTokenIdx;
             return nullptr;
         }
 
         ignore_new_lines_and_comments();
 
-        objects.push_back(object);
+        arrayValues.push_back(value.value());
     }
 
     currentTokenIdx++;
-    return arena.push<Array>(objects);
+    auto values = Vector<Value>(arrayValues.begin() + static_cast<ptrdiff_t>(firstValueIdx), arrayValues.end(), arena);
+    arrayValues.resize(firstValueIdx);
+    return arena.push<Array>(std::move(values));
 }
 
 void Parser::ignore_new_lines_and_comments() {
@@ -182,7 +256,7 @@ Dictionary *Parser::parse_dictionary() {
 
     ignore_new_lines_and_comments();
 
-    auto objects = UnorderedMap<std::string, Object *>(arena);
+    auto objects = UnorderedMap<std::string, Value>(arena);
     while (!current_token_is(Token::Type::DICTIONARY_END)) {
         auto key = parse_name();
         if (key == nullptr) {
@@ -190,15 +264,15 @@ Dictionary *Parser::parse_dictionary() {
             return nullptr;
         }
 
-        auto value = parse();
-        if (value == nullptr) {
+        auto value = parse_value();
+        if (!value.has_value()) {
             currentTokenIdx = beforeTokenIdx;
             return nullptr;
         }
 
         ignore_new_lines_and_comments();
 
-        objects[key->value] = value;
+        objects[key->value] = value.value();
     }
 
     currentTokenIdx++;
@@ -339,6 +413,19 @@ Object *Parser::parse_stream_or_dictionary() {
 }
 
 Object *Parser::parse() {
+    // nested calls (elements of arrays and dictionaries, content of indirect objects) must not discard any tokens,
+    // because the enclosing objects might still have to backtrack
+    if (parseDepth == 0) {
+        discard_consumed_tokens();
+    }
+
+    parseDepth++;
+    auto result = parse_object();
+    parseDepth--;
+    return result;
+}
+
+Object *Parser::parse_object() {
     ignore_new_lines_and_comments();
 
     auto boolean = parse_boolean();
@@ -405,12 +492,12 @@ int64_t Parser::already_read_bytes() {
         current_token = tokens[currentTokenIdx];
     }
 
-    if (tokens.empty() || current_token.type == Token::Type::INVALID) {
+    if (firstTokenData == nullptr || current_token.type == Token::Type::INVALID) {
         return 0;
     }
 
     // TODO this only works when all tokens reference a a single large buffer
-    const auto first_token_ptr   = tokens[0].content.data();
+    const auto first_token_ptr   = firstTokenData;
     const auto current_token_ptr = current_token.content.data();
     return current_token_ptr - first_token_ptr;
 }
@@ -9,6 +9,7 @@
 
 #include "pdf/lexer.h"
 #include "pdf/memory/arena_allocator.h"
+#include "pdf/memory/arena_vector.h"
 #include "pdf/objects.h"
 #include "pdf/util/debug.h"
 
@@ -27,8 +28,15 @@ struct Parser {
     Arena &arena;
     ReferenceResolver *referenceResolver;
 
-    Vector<Token> tokens;
-    size_t currentTokenIdx = 0;
+    /// tokens of the object that is currently being parsed (and tokens that have been looked ahead), the tokens of
+    /// previously parsed objects are discarded
+    ArenaVector<Token> tokens;
+    size_t currentTokenIdx     = 0;
+    const char *firstTokenData = nullptr;
+    /// number of nested calls to parse(), tokens are only discarded by the outermost call
+    size_t parseDepth = 0;
+    /// elements of the arrays that are currently being parsed, every array is copied into the arena with its final size
+    std::vector<Value> arrayValues;
 
     explicit Parser(Lexer &_lexer, Arena &_arena);
     explicit Parser(Lexer &_lexer, Arena &_arena, ReferenceResolver *_referenceResolver);
@@ -38,10 +46,19 @@ struct Parser {
     int64_t already_read_bytes();
 
   private:
+    void discard_consumed_tokens();
+    Object *parse_object();
     void ignore_new_lines_and_comments();
     [[nodiscard]] bool ensure_tokens_have_been_lexed();
     [[nodiscard]] bool current_token_is(Token::Type type);
 
+    [[nodiscard]] std::optional<bool> parse_boolean_value();
+    [[nodiscard]] std::optional<int64_t> parse_integer_value();
+    [[nodiscard]] std::optional<double> parse_real_value();
+    [[nodiscard]] bool parse_null_value();
+    /// parses the next object, booleans, integers, reals and null are stored inline instead of being allocated
+    [[nodiscard]] std::optional<Value> parse_value();
+
     Boolean *parse_boolean();
     Integer *parse_integer();
     Real *parse_real();
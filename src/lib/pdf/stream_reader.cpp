@@ -0,0 +1,198 @@
+#include "stream_reader.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <zlib.h>
+
+namespace pdf {
+
+/// zlib allocates its state and window lazily, so it gets a fixed region up front instead of pushing into the temporary
+/// arena at some arbitrary point in time (which could be inside of a temporary scope of the caller)
+const size_t ZLIB_HEAP_SIZE = 64 * 1024;
+
+struct ZlibHeap {
+    uint8_t *position = nullptr;
+    uint8_t *end      = nullptr;
+};
+
+struct StreamReader::Stage {
+    enum class Type {
+        FLATE,
+    };
+
+    Type type              = Type::FLATE;
+    z_stream zstream       = {};
+    ZlibHeap heap          = {};
+    uint8_t *buffer        = nullptr;
+    bool isInitialized     = false;
+    bool isInputExhausted  = false;
+    bool isOutputExhausted = false;
+};
+
+static voidpf heap_zalloc(voidpf opaque, uInt items, uInt size) {
+    auto heap        = reinterpret_cast<ZlibHeap *>(opaque);
+    auto sizeInBytes = static_cast<size_t>(items) * size;
+    auto alignedSize = (sizeInBytes + 15) & ~static_cast<size_t>(15);
+    if (heap->position + alignedSize > heap->end) {
+        return Z_NULL;
+    }
+
+    auto result = heap->position;
+    heap->position += alignedSize;
+    return result;
+}
+
+static void heap_zfree(voidpf /*opaque*/, voidpf /*address*/) {
+    // the memory is released when the temporary allocator of the reader goes out of scope
+}
+
+StreamReader::StreamReader(Allocator &allocator, const Stream *stream, size_t _chunkSizeInBytes)
+    : temp(allocator.temporary()), source(stream->streamData), chunkSizeInBytes(_chunkSizeInBytes) {
+    auto tagScope = AllocationTagScope(allocator, AllocationTag::DECODE);
+    auto fs       = stream->filters();
+    if (fs.empty()) {
+        return;
+    }
+
+    stages     = temp.arena().push_array<Stage>(fs.size());
+    stageCount = fs.size();
+    for (size_t i = 0; i < fs.size(); i++) {
+        auto stage = stages + i;
+        if (fs[i] == "FlateDecode") {
+            // FIXME implement handling of "DecodeParms" from stream dictionary
+            stage->type           = Stage::Type::FLATE;
+            stage->buffer         = temp.arena().push(chunkSizeInBytes, CACHE_LINE_SIZE);
+            stage->heap.position  = temp.arena().push(ZLIB_HEAP_SIZE, alignof(std::max_align_t));
+            stage->heap.end       = stage->heap.position + ZLIB_HEAP_SIZE;
+            stage->zstream.zalloc = heap_zalloc;
+            stage->zstream.zfree  = heap_zfree;
+            stage->zstream.opaque = &stage->heap;
+            if (inflateInit(&stage->zstream) != Z_OK) {
+                set_error(fmt::format("Failed to initialize zlib: {}", stage->zstream.msg ? stage->zstream.msg : ""));
+                return;
+            }
+            stage->isInitialized = true;
+        } else {
+            // TODO handle more filters
+            set_error(fmt::format("Unknown filter: {}", fs[i]));
+            return;
+        }
+    }
+}
+
+StreamReader::~StreamReader() {
+    for (size_t i = 0; i < stageCount; i++) {
+        if (stages[i].isInitialized) {
+            inflateEnd(&stages[i].zstream);
+        }
+    }
+}
+
+Result StreamReader::result() const {
+    return Result::from_bool(hasError, "{}", errorMessage);
+}
+
+void StreamReader::set_error(std::string message) {
+    spdlog::error("{}", message);
+    hasError     = true;
+    errorMessage = std::move(message);
+}
+
+std::optional<std::string_view> StreamReader::read() {
+    if (hasError) {
+        return {};
+    }
+
+    auto result = read_stage(stageCount);
+    if (result.has_value()) {
+        bytesRead += result.value().size();
+    }
+    return result;
+}
+
+/// stage 0 is the raw stream data, stage i is the output of the i-th filter
+std::optional<std::string_view> StreamReader::read_stage(size_t stageIndex) {
+    if (stageIndex == 0) {
+        if (sourceOffset >= source.size()) {
+            return {};
+        }
+
+        auto result = source.substr(sourceOffset, chunkSizeInBytes);
+        sourceOffset += result.size();
+        return result;
+    }
+
+    auto &stage = stages[stageIndex - 1];
+    while (!stage.isOutputExhausted) {
+        if (stage.zstream.avail_in == 0 && !stage.isInputExhausted) {
+            auto input = read_stage(stageIndex - 1);
+            if (hasError) {
+                return {};
+            }
+            if (input.has_value()) {
+                stage.zstream.next_in  = (Bytef *)input.value().data();
+                stage.zstream.avail_in = (uInt)input.value().size();
+            } else {
+                stage.isInputExhausted = true;
+            }
+        }
+
+        stage.zstream.next_out  = stage.buffer;
+        stage.zstream.avail_out = (uInt)chunkSizeInBytes;
+
+        auto status = inflate(&stage.zstream, Z_NO_FLUSH);
+        if (status == Z_STREAM_END) {
+            stage.isOutputExhausted = true;
+        } else if (status == Z_BUF_ERROR && stage.isInputExhausted) {
+            // the compressed data ended prematurely, we return as much as we could decode (same as Stream::decode)
+            stage.isOutputExhausted = true;
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            set_error(fmt::format("Failed to inflate stream: {}", stage.zstream.msg ? stage.zstream.msg : ""));
+            return {};
+        }
+
+        auto producedBytes = chunkSizeInBytes - stage.zstream.avail_out;
+        if (producedBytes > 0) {
+            return std::string_view((char *)stage.buffer, producedBytes);
+        }
+    }
+
+    return {};
+}
+
+StreamTextProvider::StreamTextProvider(Allocator &allocator, const Stream *stream, size_t chunkSizeInBytes)
+    : reader(allocator, stream, chunkSizeInBytes) {
+    capacity = 2 * chunkSizeInBytes;
+    buffer   = static_cast<char *>(std::malloc(capacity));
+}
+
+StreamTextProvider::~StreamTextProvider() { std::free(buffer); }
+
+std::optional<std::string_view> StreamTextProvider::get_text_continuing(std::string_view rest) {
+    // the rest is part of the buffer, it stays untouched if there is nothing left to read
+    auto chunk = reader.read();
+    if (!chunk.has_value()) {
+        return {};
+    }
+
+    auto size = rest.size() + chunk.value().size();
+    if (size > capacity) {
+        auto newCapacity = std::max(capacity * 2, size);
+        auto newBuffer   = static_cast<char *>(std::malloc(newCapacity));
+        ASSERT(newBuffer != nullptr);
+        if (!rest.empty()) {
+            std::memcpy(newBuffer, rest.data(), rest.size());
+        }
+        std::free(buffer);
+        buffer   = newBuffer;
+        capacity = newCapacity;
+    } else if (!rest.empty()) {
+        std::memmove(buffer, rest.data(), rest.size());
+    }
+
+    std::memcpy(buffer + rest.size(), chunk.value().data(), chunk.value().size());
+    return std::string_view(buffer, size);
+}
+
+} // namespace pdf
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+#include "pdf/lexer.h"
+#include "pdf/memory/arena_allocator.h"
+#include "pdf/objects.h"
+#include "pdf/util/result.h"
+
+namespace pdf {
+
+const size_t STREAM_READER_CHUNK_SIZE = 64 * 1024; // 64 KB
+
+/// Decodes a stream chunk by chunk through its filter chain, without ever materializing the whole decoded content.
+/// All buffers (including the ones zlib needs internally) live in the temporary arena and are released once the reader
+/// goes out of scope. Peak memory usage is therefore bounded by the chunk size and the number of filters.
+struct StreamReader {
+    explicit StreamReader(Allocator &allocator, const Stream *stream,
+                          size_t chunkSizeInBytes = STREAM_READER_CHUNK_SIZE);
+    ~StreamReader();
+
+    StreamReader(const StreamReader &)            = delete;
+    StreamReader &operator=(const StreamReader &) = delete;
+
+    /// returns the next chunk of decoded data or an empty optional once the end of the stream has been reached
+    /// NOTE the returned view is only valid until the next call to read()
+    std::optional<std::string_view> read();
+
+    /// number of decoded bytes that have been returned so far
+    [[nodiscard]] size_t position() const { return bytesRead; }
+    /// reports whether decoding failed, which also ends the stream
+    [[nodiscard]] Result result() const;
+
+  private:
+    struct Stage;
+
+    TemporaryAllocator temp;
+    std::string_view source;
+    size_t chunkSizeInBytes = 0;
+    size_t sourceOffset     = 0;
+    size_t bytesRead        = 0;
+
+    Stage *stages     = nullptr;
+    size_t stageCount = 0;
+
+    bool hasError = false;
+    std::string errorMessage;
+
+    std::optional<std::string_view> read_stage(size_t stageIndex);
+    void set_error(std::string message);
+};
+
+/// Feeds the decoded content of a stream to a TextLexer chunk by chunk, while the stream is being decoded. The text
+/// that the lexer still needs is moved to the front of a single buffer, which only grows beyond two chunks if the
+/// operands of one operator don't fit into it.
+struct StreamTextProvider : public TextProvider {
+    explicit StreamTextProvider(Allocator &allocator, const Stream *stream,
+                                size_t chunkSizeInBytes = STREAM_READER_CHUNK_SIZE);
+    ~StreamTextProvider();
+
+    StreamTextProvider(const StreamTextProvider &)            = delete;
+    StreamTextProvider &operator=(const StreamTextProvider &) = delete;
+
+    std::optional<std::string_view> get_text() override { return get_text_continuing({}); }
+    std::optional<std::string_view> get_text_continuing(std::string_view rest) override;
+
+    [[nodiscard]] Result result() const { return reader.result(); }
+
+  private:
+    StreamReader reader;
+    char *buffer    = nullptr;
+    size_t capacity = 0;
+};
+
+} // namespace pdf
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "pdf/memory/stl_allocator.h"
@@ -10,5 +11,6 @@ namespace pdf {
 template <typename T> using Vector = std::vector<T, StlAllocator<T>>;
 template <typename K, typename V>
 using UnorderedMap = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>, StlAllocator<std::pair<const K, V>>>;
+template <typename T> using UnorderedSet = std::unordered_set<T, std::hash<T>, std::equal_to<T>, StlAllocator<T>>;
 
 } // namespace pdf
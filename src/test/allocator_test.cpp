@@ -1,15 +1,29 @@
 #include <gtest/gtest.h>
+#include <cstring>
+#include <thread>
+#include <unordered_set>
 
 #include <pdf/memory/arena_allocator.h>
+#include <pdf/memory/arena_vector.h>
 #include <pdf/util/types.h>
 
+#if !WIN32
+#include <sys/mman.h>
+#endif
+
 // used to make internal fields of Arena accessible during test
 struct TestArena {
-    uint8_t *buffer_start         = nullptr;
-    uint8_t *buffer_position      = nullptr;
-    size_t virtual_size_in_bytes  = 0;
-    size_t reserved_size_in_bytes = 0;
-    size_t page_size_in_bytes     = 0;
+    uint8_t *buffer_start                 = nullptr;
+    uint8_t *buffer_position              = nullptr;
+    size_t virtual_size_in_bytes          = 0;
+    size_t reserved_size_in_bytes         = 0;
+    size_t page_size_in_bytes             = 0;
+    size_t peak_used_size_in_bytes        = 0;
+    size_t allocation_count               = 0;
+    pdf::AllocationTag current_tag        = pdf::AllocationTag::OTHER;
+    pdf::TaggedSizes tagged_size_in_bytes = {};
+    pdf::ArenaPages pages                 = pdf::ArenaPages::NORMAL;
+    size_t huge_tlb_size_in_bytes         = 0;
 };
 
 TEST(Arena, can_handle_small_allocation) {
@@ -63,6 +77,348 @@ TEST(Arena, can_handle_growing_allocation) {
     ASSERT_EQ(2 * MB, testArena->reserved_size_in_bytes);
 }
 
+TEST(Arena, aligns_allocations) {
+    auto result = pdf::Arena::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &arena          = result.value();
+    const auto unaligned = arena.push(3);
+    ASSERT_TRUE(nullptr != unaligned);
+
+    // the byte buffer leaves the arena at an odd position, the typed allocation skips ahead to the next multiple of 8
+    const auto number = arena.push<double>(1.5);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(number) % alignof(double), 0);
+    ASSERT_EQ(reinterpret_cast<uint8_t *>(number), unaligned + 8);
+    ASSERT_EQ(*number, 1.5);
+
+    const auto line = arena.push(10, pdf::CACHE_LINE_SIZE);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(line) % pdf::CACHE_LINE_SIZE, 0);
+
+    // without an alignment the allocations stay adjacent
+    const auto adjacent = arena.push(1);
+    ASSERT_EQ(line + 10, adjacent);
+}
+
+TEST(Arena, push_array) {
+    struct Element {
+        int64_t value = 42;
+        double weight = 0.5;
+    };
+
+    auto result = pdf::Arena::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &arena = result.value();
+    arena.push(1);
+    const auto elements = arena.push_array<Element>(5);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(elements) % alignof(Element), 0);
+    for (size_t i = 0; i < 5; i++) {
+        ASSERT_EQ(elements[i].value, 42);
+        ASSERT_EQ(elements[i].weight, 0.5);
+    }
+    ASSERT_EQ(arena.current_buffer_position(), reinterpret_cast<uint8_t *>(elements + 5));
+}
+
+TEST(Arena, extend_and_release) {
+    auto result = pdf::Arena::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &arena      = result.value();
+    const auto first = arena.push(16);
+    ASSERT_TRUE(arena.extend(first, 16, 32));
+    ASSERT_EQ(arena.current_buffer_position(), first + 32);
+
+    // only the most recent allocation can grow or be given back
+    const auto second = arena.push(8);
+    ASSERT_FALSE(arena.extend(first, 32, 64));
+    arena.release(first, 32);
+    ASSERT_EQ(arena.current_buffer_position(), second + 8);
+    arena.release(second, 8);
+    ASSERT_EQ(arena.current_buffer_position(), second);
+
+    // growing past the reserved memory reserves more
+    ASSERT_TRUE(arena.extend(second, 0, 2 * pdf::ARENA_PAGE_SIZE));
+    second[2 * pdf::ARENA_PAGE_SIZE - 1] = 1;
+}
+
+TEST(Arena, statistics) {
+    auto result = pdf::Arena::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &arena = result.value();
+    arena.push(100);
+    arena.set_tag(pdf::AllocationTag::PARSER);
+    arena.push(50);
+    arena.pop(50);
+
+    auto statistics = arena.statistics();
+    ASSERT_EQ(statistics.committedSizeInBytes, pdf::ARENA_PAGE_SIZE);
+    ASSERT_EQ(statistics.usedSizeInBytes, 100);
+    ASSERT_EQ(statistics.peakUsedSizeInBytes, 150);
+    ASSERT_EQ(statistics.allocationCount, 2);
+    ASSERT_EQ(statistics.allocatedSizeInBytesByTag[static_cast<size_t>(pdf::AllocationTag::OTHER)], 100);
+    ASSERT_EQ(statistics.allocatedSizeInBytesByTag[static_cast<size_t>(pdf::AllocationTag::PARSER)], 50);
+}
+
+TEST(Arena, decommits_after_large_temporary_allocation) {
+    auto result = pdf::Allocator::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &allocator = result.value();
+    {
+        auto temp = allocator.temporary();
+        temp.arena().push(10);
+        {
+            auto largeTemp = allocator.temporary();
+            auto buffer    = largeTemp.arena().push(2 * pdf::ARENA_DECOMMIT_THRESHOLD);
+
+            buffer[2 * pdf::ARENA_DECOMMIT_THRESHOLD - 1] = 1;
+            ASSERT_GT(allocator.temporary_statistics().committedSizeInBytes, 2 * pdf::ARENA_DECOMMIT_THRESHOLD);
+        }
+
+        // the page that is still in use stays committed
+        ASSERT_EQ(allocator.temporary_statistics().committedSizeInBytes, pdf::ARENA_PAGE_SIZE);
+        ASSERT_EQ(allocator.temporary_statistics().peakUsedSizeInBytes, 2 * pdf::ARENA_DECOMMIT_THRESHOLD + 10);
+
+        // the memory can be used again
+        auto buffer = temp.arena().push(pdf::ARENA_PAGE_SIZE * 2);
+        ASSERT_NE(buffer, nullptr);
+        buffer[pdf::ARENA_PAGE_SIZE * 2 - 1] = 1;
+    }
+    ASSERT_EQ(allocator.temporary_statistics().usedSizeInBytes, 0);
+}
+
+#if !WIN32
+/// true if the page at the given address is part of a mapping, no matter if it has been committed or only reserved
+static bool is_mapped(uint8_t *address) {
+    unsigned char residency = 0;
+    return mincore(address, 1, &residency) == 0;
+}
+
+TEST(Arena, move_assignment_releases_reservation) {
+    auto first  = pdf::Arena::create();
+    auto second = pdf::Arena::create();
+    ASSERT_FALSE(first.has_error()) << first.message();
+    ASSERT_FALSE(second.has_error()) << second.message();
+
+    auto &arena    = first.value();
+    auto oldBuffer = arena.push(1);
+    auto newBuffer = second.value().push(1);
+    ASSERT_TRUE(is_mapped(oldBuffer));
+    arena = std::move(second.value());
+    ASSERT_FALSE(is_mapped(oldBuffer));
+    ASSERT_TRUE(is_mapped(newBuffer));
+}
+#endif
+
+TEST(Arena, huge_pages) {
+    auto result = pdf::Arena::create(pdf::ArenaPages::TRANSPARENT_HUGE);
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &arena    = result.value();
+    const auto buf = arena.push(3 * pdf::HUGE_PAGE_SIZE);
+    ASSERT_NE(buf, nullptr);
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(buf) % pdf::HUGE_PAGE_SIZE, 0);
+    std::memset(buf, 1, 3 * pdf::HUGE_PAGE_SIZE);
+
+    // either the kernel supports transparent huge pages, or the arena fell back to normal pages
+    auto statistics = arena.statistics();
+    ASSERT_NE(statistics.pages, pdf::ArenaPages::EXPLICIT_HUGE);
+    ASSERT_EQ(statistics.committedSizeInBytes % pdf::HUGE_ARENA_PAGE_SIZE, 0);
+    ASSERT_GE(statistics.committedSizeInBytes, 3 * pdf::HUGE_PAGE_SIZE);
+}
+
+TEST(Arena, explicit_huge_pages_fall_back_when_the_pool_is_empty) {
+    auto result = pdf::Arena::create(pdf::ArenaPages::EXPLICIT_HUGE);
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    // this works no matter how many huge pages have been preallocated
+    auto &arena = result.value();
+    for (int i = 0; i < 2; i++) {
+        const auto size = 2 * pdf::ARENA_DECOMMIT_THRESHOLD;
+        const auto buf  = arena.push(size);
+        ASSERT_NE(buf, nullptr);
+        std::memset(buf, 1, size);
+        arena.pop_all();
+        ASSERT_EQ(arena.statistics().committedSizeInBytes, 0);
+    }
+}
+
+TEST(PageArenaScope, switches_the_page_arena) {
+    auto result = pdf::Allocator::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &allocator = result.value();
+    ASSERT_EQ(&allocator.page(), &allocator.arena());
+
+    auto vector = pdf::Vector<int>(StlAllocator<int>::page(allocator));
+    {
+        auto scope = pdf::PageArenaScope(allocator);
+        ASSERT_NE(&allocator.page(), &allocator.arena());
+
+        vector.resize(1000);
+        ASSERT_GE(allocator.page_statistics().usedSizeInBytes, 1000 * sizeof(int));
+        ASSERT_EQ(allocator.internal_statistics().usedSizeInBytes, 0);
+
+        // the buffer has to be released before the scope ends
+        pdf::Vector<int>(vector.get_allocator()).swap(vector);
+    }
+    ASSERT_EQ(&allocator.page(), &allocator.arena());
+    ASSERT_EQ(allocator.page_statistics().usedSizeInBytes, 0);
+
+    // outside of a scope the container allocates from the internal arena
+    vector.resize(10);
+    ASSERT_GE(allocator.internal_statistics().usedSizeInBytes, 10 * sizeof(int));
+}
+
+TEST(AllocationTagScope, restores_previous_tag) {
+    auto result = pdf::Allocator::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &allocator = result.value();
+    {
+        auto scope = pdf::AllocationTagScope(allocator, pdf::AllocationTag::DECODE);
+        allocator.arena().push(8);
+        auto temp = allocator.temporary();
+        temp.arena().push(16);
+    }
+    allocator.arena().push(4);
+
+    auto internal  = allocator.internal_statistics();
+    auto temporary = allocator.temporary_statistics();
+    ASSERT_EQ(internal.allocatedSizeInBytesByTag[static_cast<size_t>(pdf::AllocationTag::DECODE)], 8);
+    ASSERT_EQ(internal.allocatedSizeInBytesByTag[static_cast<size_t>(pdf::AllocationTag::OTHER)], 4);
+    ASSERT_EQ(temporary.allocatedSizeInBytesByTag[static_cast<size_t>(pdf::AllocationTag::DECODE)], 16);
+}
+
+TEST(ArenaVector, grows_in_place) {
+    auto result = pdf::Arena::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &arena = result.value();
+    auto start  = arena.current_buffer_position();
+    {
+        auto v = pdf::ArenaVector<int64_t>(arena);
+        for (int64_t i = 0; i < 1000; i++) {
+            v.push_back(i);
+        }
+        ASSERT_EQ(v.size(), 1000);
+        ASSERT_EQ(v.data(), reinterpret_cast<int64_t *>(start));
+        ASSERT_EQ(arena.current_buffer_position(), start + v.capacity() * sizeof(int64_t));
+        for (int64_t i = 0; i < 1000; i++) {
+            ASSERT_EQ(v[i], i);
+        }
+    }
+    ASSERT_EQ(arena.current_buffer_position(), start);
+}
+
+TEST(ArenaVector, copies_when_not_at_the_top) {
+    auto result = pdf::Arena::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &arena = result.value();
+    auto v      = pdf::ArenaVector<int32_t>(arena);
+    v.push_back(1);
+    const auto before = v.data();
+    arena.push(1);
+    v.reserve(100);
+    ASSERT_NE(v.data(), before);
+    ASSERT_EQ(v.size(), 1);
+    ASSERT_EQ(v[0], 1);
+}
+
+TEST(StlAllocator, ReleasesTopAllocation) {
+    auto result = pdf::Arena::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &arena = result.value();
+    auto start  = arena.current_buffer_position();
+    {
+        auto v = pdf::Vector<int>(arena);
+        v.reserve(10);
+    }
+    ASSERT_EQ(arena.current_buffer_position(), start);
+}
+
+TEST(ConcurrentArena, push_from_multiple_threads) {
+    auto result = pdf::ConcurrentArena::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &arena                  = result.value();
+    const size_t threadCount     = 8;
+    const size_t pushesPerThread = 10000;
+    auto allocations             = std::vector<std::vector<int64_t *>>(threadCount);
+    auto threads                 = std::vector<std::thread>();
+    for (size_t t = 0; t < threadCount; t++) {
+        threads.emplace_back([&arena, &allocations, t]() {
+            for (size_t i = 0; i < pushesPerThread; i++) {
+                auto number = arena.push<int64_t>(static_cast<int64_t>(t * pushesPerThread + i));
+                allocations[t].push_back(number);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // no allocation has been handed out twice
+    auto seen = std::unordered_set<int64_t *>();
+    for (size_t t = 0; t < threadCount; t++) {
+        for (size_t i = 0; i < pushesPerThread; i++) {
+            auto number = allocations[t][i];
+            ASSERT_EQ(reinterpret_cast<uintptr_t>(number) % alignof(int64_t), 0);
+            ASSERT_EQ(*number, static_cast<int64_t>(t * pushesPerThread + i));
+            ASSERT_TRUE(seen.insert(number).second);
+        }
+    }
+}
+
+TEST(ConcurrentArena, large_allocation) {
+    auto result = pdf::ConcurrentArena::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &arena      = result.value();
+    const auto small = arena.push(10);
+    const auto large = arena.push(pdf::CONCURRENT_ARENA_CHUNK_SIZE * 3, pdf::CACHE_LINE_SIZE);
+    ASSERT_NE(large, nullptr);
+    large[pdf::CONCURRENT_ARENA_CHUNK_SIZE * 3 - 1] = 1;
+
+    // the large allocation does not replace the current chunk
+    const auto next = arena.push(1);
+    ASSERT_EQ(small + 10, next);
+
+    arena.pop_all();
+    ASSERT_EQ(arena.reserved_size(), 0);
+    ASSERT_NE(arena.push(1), next + 1);
+}
+
+#if !WIN32
+TEST(ConcurrentArena, move_assignment_releases_reservation) {
+    auto first  = pdf::ConcurrentArena::create();
+    auto second = pdf::ConcurrentArena::create();
+    ASSERT_FALSE(first.has_error()) << first.message();
+    ASSERT_FALSE(second.has_error()) << second.message();
+
+    auto &arena    = first.value();
+    auto oldBuffer = arena.push(1);
+    auto newBuffer = second.value().push(1);
+    ASSERT_TRUE(is_mapped(oldBuffer));
+    arena = std::move(second.value());
+    ASSERT_FALSE(is_mapped(oldBuffer));
+    ASSERT_TRUE(is_mapped(newBuffer));
+}
+#endif
+
+TEST(StlAllocator, ConcurrentArena) {
+    auto result = pdf::ConcurrentArena::create();
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto v = pdf::Vector<int>(result.value());
+    for (int i = 0; i < 100; i++) {
+        v.push_back(i);
+    }
+    ASSERT_EQ(v[99], 99);
+}
+
 namespace pdf {
 pdf::PtrResult ReserveAddressRange(size_t sizeInBytes);
 pdf::Result ReleaseAddressRange(uint8_t *buffer, size_t sizeInBytes);
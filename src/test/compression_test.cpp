@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+
+#include <pdf/compression.h>
+#include <pdf/document.h>
+#include <pdf/page.h>
+#include <zlib.h>
+
+std::string create_compressible_data(size_t sizeInBytes) {
+    auto result = std::string();
+    result.reserve(sizeInBytes);
+    for (size_t i = 0; result.size() < sizeInBytes; i++) {
+        result += "BT /F1 12 Tf " + std::to_string(i % 613) + " " + std::to_string(i * 31 % 797);
+        result += " Td (Hello) Tj ET\n";
+    }
+    result.resize(sizeInBytes);
+    return result;
+}
+
+void assertCanBeInflated(std::string_view compressed, const std::string &expected) {
+    auto output     = std::string(expected.size(), '\0');
+    auto outputSize = static_cast<uLongf>(output.size());
+    auto ret = uncompress((Bytef *)output.data(), &outputSize, (const Bytef *)compressed.data(), compressed.size());
+    ASSERT_EQ(ret, Z_OK);
+    ASSERT_EQ(outputSize, expected.size());
+    ASSERT_EQ(output, expected);
+}
+
+TEST(Compression, Sequential) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error()) << allocatorResult.message();
+    auto &allocator = allocatorResult.value();
+
+    auto data = create_compressible_data(100000);
+    auto best = pdf::deflate_buffer(allocator, (uint8_t *)data.data(), data.size()).value();
+    auto fast =
+          pdf::deflate_buffer(allocator, (uint8_t *)data.data(), data.size(), pdf::CompressionOptions::fast()).value();
+    assertCanBeInflated(best, data);
+    assertCanBeInflated(fast, data);
+    ASSERT_LT(best.size(), fast.size());
+}
+
+TEST(Compression, Parallel) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error()) << allocatorResult.message();
+    auto &allocator = allocatorResult.value();
+
+    auto options                     = pdf::CompressionOptions();
+    options.parallelThresholdInBytes = 1024;
+    options.parallelBlockSizeInBytes = 4096;
+    options.threadCount              = 4;
+
+    for (size_t size : {4097, 10000, 100000}) {
+        auto data     = create_compressible_data(size);
+        auto parallel = pdf::deflate_buffer(allocator, (uint8_t *)data.data(), data.size(), options).value();
+        assertCanBeInflated(parallel, data);
+
+        // priming each block with the end of the previous one keeps the output close to the sequential one
+        options.parallelThresholdInBytes = 0;
+        auto sequential = pdf::deflate_buffer(allocator, (uint8_t *)data.data(), data.size(), options).value();
+        options.parallelThresholdInBytes = 1024;
+        ASSERT_LT(parallel.size(), sequential.size() + sequential.size() / 10);
+    }
+}
+
+TEST(Compression, ParallelIncompressibleData) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error()) << allocatorResult.message();
+    auto &allocator = allocatorResult.value();
+
+    auto data = std::string(5 * 1024 * 1024, '\0');
+    auto seed = uint32_t(42);
+    for (auto &c : data) {
+        seed = seed * 1664525 + 1013904223;
+        c    = static_cast<char>(seed >> 24);
+    }
+
+    // the output of random data is larger than the input, how much larger depends on memLevel and strategy
+    for (int memLevel : {1, 8, 9}) {
+        auto options        = pdf::CompressionOptions::fast();
+        options.memLevel    = memLevel;
+        options.threadCount = 2;
+        auto result         = pdf::deflate_buffer(allocator, (uint8_t *)data.data(), data.size(), options);
+        ASSERT_FALSE(result.has_error()) << result.message();
+        assertCanBeInflated(result.value(), data);
+    }
+
+    auto options     = pdf::CompressionOptions();
+    options.memLevel = 0;
+    ASSERT_TRUE(pdf::deflate_buffer(allocator, (uint8_t *)data.data(), data.size(), options).has_error());
+}
+
+TEST(Compression, RecompressOnSave) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error()) << allocatorResult.message();
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/hello-world.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+
+    auto &document = result.value();
+    auto stream    = document.pages()[0]->attr_contents().value()->as<pdf::Stream>();
+    auto content   = std::string(stream->decode(document.allocator)) + " ";
+    ASSERT_FALSE(stream->encode(document.allocator, content, document.editCompression).has_error());
+    ASSERT_EQ(stream->compressionLevel, document.editCompression.level);
+
+    uint8_t *buffer = nullptr;
+    size_t size     = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size).has_error());
+    free(buffer);
+
+    ASSERT_EQ(stream->compressionLevel, document.compression.level);
+    ASSERT_EQ(stream->decode(document.allocator), content);
+}
@@ -112,3 +112,23 @@ TEST(MD5_checksum, Length65) {
     // THEN
     ASSERT_EQ("017d572b274249897ce1c9234c92711e", pdf::hash::to_hex_string(result));
 }
+
+TEST(MD5_checksum, incremental) {
+    // GIVEN
+    std::string s;
+    for (int i = 0; i < 1000; i++) {
+        s += std::to_string(i);
+    }
+
+    for (size_t chunkSize : {1, 7, 55, 56, 63, 64, 65, 1000}) {
+        // WHEN
+        auto context = pdf::hash::MD5Context();
+        for (size_t offset = 0; offset < s.size(); offset += chunkSize) {
+            auto size = std::min(chunkSize, s.size() - offset);
+            context.update(reinterpret_cast<const uint8_t *>(s.data()) + offset, size);
+        }
+
+        // THEN
+        ASSERT_EQ(pdf::hash::to_hex_string(pdf::hash::md5_checksum(s)), pdf::hash::to_hex_string(context.finish()));
+    }
+}
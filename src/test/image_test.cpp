@@ -3,6 +3,7 @@
 #include <fstream>
 #include <pdf/document.h>
 #include <pdf/image.h>
+#include <pdf/page.h>
 
 void assertFilesAreIdentical(const std::string &f1, const std::string &f2) {
     std::ifstream ifs1(f1, std::ios::in | std::ios::ate | std::ios::binary);
@@ -95,3 +96,28 @@ TEST(Image, ExtractImage3) {
         return pdf::ForEachResult::CONTINUE;
     });
 }
+
+TEST(Image, InlineImage) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto &allocator = allocatorResult.value();
+
+    auto documentResult = pdf::Document::read_from_file(allocator, "../../../test-files/hello-world.pdf");
+    ASSERT_FALSE(documentResult.has_error());
+    auto &document = documentResult.value();
+    auto page      = document.pages()[0];
+
+    // a 2x2 RGB image, the data contains " EI " and is skipped by using the size from the dictionary
+    const auto data    = std::string("\x01\x02 EI \x03\x04\x05\x06\x07\x08", 12);
+    const auto content = "q 1 0 0 1 100 200 cm BI /W 2 /H 2 /BPC 8 /CS /RGB ID " + data + " EI Q\n";
+    ASSERT_FALSE(page->content_streams()[0]->encode(allocator, content).has_error());
+
+    auto images = page->images();
+    ASSERT_EQ(images.size(), 1);
+    ASSERT_EQ(images[0].op->type, pdf::Operator::Type::BI_InlineImage);
+    ASSERT_EQ(images[0].image->width(), 2);
+    ASSERT_EQ(images[0].image->height(), 2);
+    ASSERT_EQ(images[0].image->bits_per_component().value()->value, 8);
+    ASSERT_EQ(images[0].image->decode(allocator), data);
+    ASSERT_EQ(images[0].xOffset, 100);
+}
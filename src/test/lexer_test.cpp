@@ -98,16 +98,17 @@ TEST(Lexer, IndirectReference) {
 }
 
 TEST(Lexer, HexadecimalString) {
-    auto textProvider =
-          pdf::StringTextProvider("<949FFBA879E60749D38B89A33E0DD9E7> <949ffba879e60749d38b89a33e0dd9e7> <> "
-                                  "<76\r65\t72 61\f504446  2074\n61> "
-                                  "<54\000\066\070\066\065\062\060\066\071\066c652>");
-    auto lexer = pdf::TextLexer(textProvider);
+    using namespace std::string_literals;
+    auto text         = "<949FFBA879E60749D38B89A33E0DD9E7> <949ffba879e60749d38b89a33e0dd9e7> <> "
+                        "<76\r65\t72 61\f504446  2074\n61> "
+                        "<54\000\066\070\066\065\062\060\066\071\066c652>"s;
+    auto textProvider = pdf::StringTextProvider(text);
+    auto lexer        = pdf::TextLexer(textProvider);
     assertNextToken(lexer, pdf::Token::Type::HEXADECIMAL_STRING, "<949FFBA879E60749D38B89A33E0DD9E7>");
     assertNextToken(lexer, pdf::Token::Type::HEXADECIMAL_STRING, "<949ffba879e60749d38b89a33e0dd9e7>");
     assertNextToken(lexer, pdf::Token::Type::HEXADECIMAL_STRING, "<>");
     assertNextToken(lexer, pdf::Token::Type::HEXADECIMAL_STRING, "<76\r65\t72 61\f504446  2074\n61>");
-    assertNextToken(lexer, pdf::Token::Type::HEXADECIMAL_STRING, "<54\000\066\070\066\065\062\060\066\071\066c652>");
+    assertNextToken(lexer, pdf::Token::Type::HEXADECIMAL_STRING, "<54\000\066\070\066\065\062\060\066\071\066c652>"s);
     assertNoMoreTokens(lexer);
 }
 
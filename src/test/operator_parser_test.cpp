@@ -114,3 +114,70 @@ TEST(OperationParser, Content) {
                  [](auto op) { ASSERT_EQ(op->content, "n"); });
     assertNextOp(parser, pdf::Operator::Type::Q_PopGraphicsState, [](auto op) { ASSERT_EQ(op->content, "Q"); });
 }
+
+TEST(OperatorParser, StringToOperatorType) {
+    ASSERT_EQ(pdf::stringToOperatorType("Tf"), pdf::Operator::Type::Tf_SetTextFontAndSize);
+    ASSERT_EQ(pdf::stringToOperatorType("T*"), pdf::Operator::Type::Tx_MoveStartOfNextLineAbsolute);
+    ASSERT_EQ(pdf::stringToOperatorType("W*"), pdf::Operator::Type::Wx_ModifyClippingPathUsingEvenOddRule);
+    ASSERT_EQ(pdf::stringToOperatorType("q"), pdf::Operator::Type::q_PushGraphicsState);
+    ASSERT_EQ(pdf::stringToOperatorType("Q"), pdf::Operator::Type::Q_PopGraphicsState);
+    ASSERT_EQ(pdf::stringToOperatorType("BDC"), pdf::Operator::Type::BDC_UNKNOWN);
+    ASSERT_EQ(pdf::stringToOperatorType("Tx"), pdf::Operator::Type::UNKNOWN_UNKNOWN);
+    ASSERT_EQ(pdf::stringToOperatorType("TfX"), pdf::Operator::Type::UNKNOWN_UNKNOWN);
+    ASSERT_EQ(pdf::stringToOperatorType("UNKNOWN"), pdf::Operator::Type::UNKNOWN_UNKNOWN);
+    ASSERT_EQ(pdf::stringToOperatorType(""), pdf::Operator::Type::UNKNOWN_UNKNOWN);
+}
+
+TEST(OperationParser, KeepsOnlyTheTokensOfTheCurrentOperator) {
+    auto input = std::string();
+    for (int i = 0; i < 1000; i++) {
+        input += "BT /F1 12 Tf 10 " + std::to_string(i) + " Td [(Hello) -250 (World)] TJ ET\n";
+    }
+    auto textProvider = pdf::StringTextProvider(input);
+    auto lexer        = pdf::TextLexer(textProvider);
+    auto arenaResult  = pdf::Arena::create();
+    ASSERT_FALSE(arenaResult.has_error()) << arenaResult.message();
+    auto &arena = arenaResult.value();
+    auto parser = pdf::OperatorParser(lexer, arena);
+
+    for (int i = 0; i < 1000; i++) {
+        assertNextOp(parser, pdf::Operator::Type::BT_BeginText);
+        assertNextOp(parser, pdf::Operator::Type::Tf_SetTextFontAndSize);
+        assertNextOp(parser, pdf::Operator::Type::Td_MoveStartOfNextLine,
+                     [i](auto op) { ASSERT_EQ(op->data.Td_MoveStartOfNextLine.y, i); });
+        assertNextOp(parser, pdf::Operator::Type::TJ_ShowOneOrMoreTextStrings,
+                     [](auto op) { ASSERT_EQ(op->data.TJ_ShowOneOrMoreTextStrings.objects->values.size(), 3); });
+        assertNextOp(parser, pdf::Operator::Type::ET_EndText);
+        ASSERT_LE(parser.tokens.capacity(), 16);
+    }
+}
+
+TEST(OperationParser, InlineImage) {
+    // the data of the first image contains " EI ", its size is known from the dictionary
+    // the data of the second image is filtered and contains "EI" without whitespace in front of it
+    auto textProvider = pdf::StringTextProvider("q BI /W 2 /H 2 /BPC 8 /CS /RGB ID ab EI cdefgh EI Q\n"
+                                                "BI /W 2 /H 2 /BPC 8 /CS /G /F /AHx\nID 0aEIff0b> EI Q");
+    auto lexer        = pdf::TextLexer(textProvider);
+    auto arenaResult  = pdf::Arena::create();
+    ASSERT_FALSE(arenaResult.has_error()) << arenaResult.message();
+    auto &arena = arenaResult.value();
+    auto parser = pdf::OperatorParser(lexer, arena);
+    assertNextOp(parser, pdf::Operator::Type::q_PushGraphicsState);
+    assertNextOp(parser, pdf::Operator::Type::BI_InlineImage, [](auto op) {
+        ASSERT_EQ(op->content, "BI /W 2 /H 2 /BPC 8 /CS /RGB ID ab EI cdefgh EI");
+        auto stream = op->data.BI_InlineImage.stream;
+        ASSERT_EQ(stream->streamData, "ab EI cdefgh");
+        ASSERT_EQ(stream->dictionary->template must_find<pdf::Integer>("Width")->value, 2);
+        ASSERT_EQ(stream->dictionary->template must_find<pdf::Integer>("BitsPerComponent")->value, 8);
+        ASSERT_EQ(stream->dictionary->template must_find<pdf::Name>("ColorSpace")->value, "DeviceRGB");
+    });
+    assertNextOp(parser, pdf::Operator::Type::Q_PopGraphicsState);
+    assertNextOp(parser, pdf::Operator::Type::BI_InlineImage, [](auto op) {
+        auto stream = op->data.BI_InlineImage.stream;
+        ASSERT_EQ(stream->streamData, "0aEIff0b>");
+        ASSERT_EQ(stream->dictionary->template must_find<pdf::Name>("ColorSpace")->value, "DeviceGray");
+        ASSERT_EQ(stream->filters(), std::vector<std::string>{"ASCIIHexDecode"});
+    });
+    assertNextOp(parser, pdf::Operator::Type::Q_PopGraphicsState);
+    ASSERT_EQ(parser.get_operator(), nullptr);
+}
@@ -85,6 +85,39 @@ TEST(Parser, ArrayWithValues) {
     });
 }
 
+TEST(Parser, ArrayWithInlineValues) {
+    assertParses<pdf::Array>("[549 3.14 false null /SomeName]", [](auto *result) {
+        ASSERT_EQ(result->values.size(), 5);
+        ASSERT_EQ(result->values[0]->template as<pdf::Integer>()->value, 549);
+        ASSERT_DOUBLE_EQ(result->values[1]->template as<pdf::Real>()->value, 3.14);
+        ASSERT_FALSE(result->values[2]->template as<pdf::Boolean>()->value);
+        ASSERT_TRUE(result->values[3]->template is<pdf::Null>());
+        ASSERT_EQ(result->values[4]->template as<pdf::Name>()->value, "SomeName");
+
+        // scalars live inside of the array, while everything else is allocated separately
+        auto storageStart = reinterpret_cast<uint8_t *>(result->values.data());
+        auto storageEnd   = reinterpret_cast<uint8_t *>(result->values.data() + result->values.size());
+        auto integer      = reinterpret_cast<uint8_t *>(static_cast<pdf::Object *>(result->values[0]));
+        auto name         = reinterpret_cast<uint8_t *>(static_cast<pdf::Object *>(result->values[4]));
+        ASSERT_TRUE(integer >= storageStart && integer < storageEnd);
+        ASSERT_FALSE(name >= storageStart && name < storageEnd);
+    });
+}
+
+TEST(Parser, ArrayRefersToArenaScalars) {
+    auto arenaResult = pdf::Arena::create();
+    ASSERT_FALSE(arenaResult.has_error()) << arenaResult.message();
+    auto &arena = arenaResult.value();
+
+    // only the parser stores scalars inline, objects from the arena are referenced and not copied
+    auto integer = arena.push<pdf::Integer>(1);
+    auto array   = arena.push<pdf::Array>(pdf::Vector<pdf::Value>(arena));
+    array->values.push_back(integer);
+    integer->value = 2;
+    ASSERT_EQ(array->values[0]->as<pdf::Integer>()->value, 2);
+    ASSERT_EQ(static_cast<pdf::Object *>(array->values[0]), integer);
+}
+
 TEST(Parser, ArrayNested) {
     assertParses<pdf::Array>("[549 [3.14 false] /SomeName]", [](auto *result) {
         ASSERT_EQ(result->values.size(), 3); //
@@ -249,6 +282,47 @@ TEST(Parser, MultipleObjects) {
     ASSERT_EQ(result->as<pdf::Integer>()->value, 7);
 }
 
+TEST(Parser, DiscardsTokensOfParsedObjects) {
+    auto input = std::string();
+    for (int i = 0; i < 1000; i++) {
+        input += std::to_string(i) + " [" + std::to_string(i) + "] ";
+    }
+    auto textProvider = pdf::StringTextProvider(input);
+    auto lexer        = pdf::TextLexer(textProvider);
+    auto arenaResult  = pdf::Arena::create();
+    ASSERT_FALSE(arenaResult.has_error()) << arenaResult.message();
+    auto &arena = arenaResult.value();
+    auto parser = pdf::Parser(lexer, arena);
+
+    for (int i = 0; i < 1000; i++) {
+        auto integer = parser.parse();
+        ASSERT_NE(integer, nullptr);
+        ASSERT_EQ(integer->as<pdf::Integer>()->value, i);
+        auto array = parser.parse();
+        ASSERT_NE(array, nullptr);
+        ASSERT_EQ(array->as<pdf::Array>()->values.size(), 1);
+        if (i == 499) {
+            ASSERT_EQ(parser.already_read_bytes(), input.find(" 500 [") + 1);
+        }
+        ASSERT_LE(parser.tokens.size(), 8);
+    }
+}
+
+TEST(Parser, BacktracksAfterFailedParse) {
+    auto textProvider = pdf::StringTextProvider("<< /Type /X /K [ 7 ] stream\n");
+    auto lexer        = pdf::TextLexer(textProvider);
+    auto arenaResult  = pdf::Arena::create();
+    ASSERT_FALSE(arenaResult.has_error()) << arenaResult.message();
+    auto &arena = arenaResult.value();
+    auto parser = pdf::Parser(lexer, arena);
+
+    // the stream is missing its length, the parser has to stay in front of the dictionary
+    ASSERT_EQ(parser.parse(), nullptr);
+    ASSERT_EQ(parser.currentTokenIdx, 0);
+    ASSERT_EQ(parser.already_read_bytes(), 0);
+    ASSERT_EQ(parser.parse(), nullptr);
+}
+
 TEST(Parser, IndirectObject1) {
     auto textProvider = pdf::StringTextProvider(
           "5 0 obj\n<<\n/Type /Metadata\n/Subtype /XML\n/Length 870>>\nstream\r\n<?xpacket begin='﻿' "
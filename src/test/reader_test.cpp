@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <utility>
 
 #include <pdf/document.h>
 #include <pdf/page.h>
@@ -155,3 +156,192 @@ TEST(Reader, ObjectStream) {
     auto str    = stream->decode(document.allocator);
     ASSERT_EQ(str.size(), 117);
 }
+
+TEST(Reader, ReferrerIndex) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/two-pages.pdf", true);
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+
+    // the second page (4 0 obj) is referenced by the page tree node (7 0 obj)
+    auto page    = document.get_object(4);
+    auto kids    = document.get_object(7)->object->as<pdf::Dictionary>()->must_find<pdf::Array>("Kids");
+    auto objects = std::vector<int64_t>();
+    document.for_each_referrer(4, [&objects](pdf::IndirectObject *referrer) {
+        objects.push_back(referrer->objectNumber);
+        return pdf::ForEachResult::CONTINUE;
+    });
+    ASSERT_EQ(std::vector<int64_t>({7}), objects);
+    ASSERT_EQ(document.get_object(7), document.find_existing_object(kids));
+    ASSERT_EQ(document.get_object(7), document.find_existing_object(kids->values[1]));
+    ASSERT_EQ(page, document.find_existing_object(page->object));
+
+    // removing the page from the page tree removes the reference as well
+    ASSERT_FALSE(document.delete_page(2).has_error());
+    objects.clear();
+    document.for_each_referrer(4, [&objects](pdf::IndirectObject *referrer) {
+        objects.push_back(referrer->objectNumber);
+        return pdf::ForEachResult::CONTINUE;
+    });
+    ASSERT_TRUE(objects.empty());
+}
+
+TEST(Reader, ReferrerIndexWithInlineValues) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/two-pages.pdf", true);
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+
+    // the inline integer in front of the references moves whenever the array changes
+    auto pageTree = document.get_object(7);
+    auto kids     = pageTree->object->as<pdf::Dictionary>()->must_find<pdf::Array>("Kids");
+    ASSERT_EQ(2, kids->values.size());
+    auto firstPage = kids->values[0]->as<pdf::IndirectReference>()->objectNumber;
+    kids->values.insert(kids->values.begin(), pdf::Value::create<pdf::Integer>(1));
+    ASSERT_EQ(pageTree, document.find_existing_object(kids->values[0]));
+
+    auto isReferredToByPageTree = [&document](int64_t objectNumber) {
+        auto result = false;
+        document.for_each_referrer(objectNumber, [&result](pdf::IndirectObject *referrer) {
+            result = referrer->objectNumber == 7;
+            return result ? pdf::ForEachResult::BREAK : pdf::ForEachResult::CONTINUE;
+        });
+        return result;
+    };
+    kids->remove_element(document, 0);
+    ASSERT_TRUE(isReferredToByPageTree(firstPage));
+    ASSERT_TRUE(isReferredToByPageTree(4));
+
+    // removing one reference keeps the other one
+    kids->remove_element(document, 1);
+    ASSERT_TRUE(isReferredToByPageTree(firstPage));
+    ASSERT_FALSE(isReferredToByPageTree(4));
+    ASSERT_EQ(pageTree, document.find_existing_object(kids->values[0]));
+}
+
+TEST(Reader, ForEachBreak) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/two-pages.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+
+    size_t visitedPages = 0;
+    document.for_each_page([&visitedPages](pdf::Page *) {
+        visitedPages++;
+        return pdf::ForEachResult::BREAK;
+    });
+    ASSERT_EQ(visitedPages, 1);
+    ASSERT_EQ(document.page_count(), 2);
+
+    // the std::function overloads forward to the templates, a non-const std::function would bind to the template
+    auto visitedObjects = std::vector<pdf::IndirectObject *>();
+    auto visitObject    = std::function<pdf::ForEachResult(pdf::IndirectObject *)>([&visitedObjects](auto object) {
+        visitedObjects.push_back(object);
+        return visitedObjects.size() == 3 ? pdf::ForEachResult::BREAK : pdf::ForEachResult::CONTINUE;
+    });
+    document.for_each_object(std::as_const(visitObject));
+    ASSERT_EQ(visitedObjects.size(), 3);
+    auto objects = document.objects();
+    ASSERT_EQ(std::vector<pdf::IndirectObject *>(objects.begin(), std::next(objects.begin(), 3)), visitedObjects);
+}
+
+TEST(Reader, LazyCounts) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/two-pages.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+
+    // the counts come from the cross reference table and from the page tree root, instead of loading everything
+    ASSERT_EQ(document.object_count(false), 16);
+    ASSERT_EQ(document.objects().size(), 16);
+    ASSERT_EQ(document.declared_page_count(), 2);
+    auto loadedObjectCount = std::count_if(document.objectList.begin(), document.objectList.end(),
+                                           [](auto &entry) { return entry.second != nullptr; });
+    ASSERT_EQ(loadedObjectCount, 2);
+
+    ASSERT_EQ(document.object_count(true), 16);
+    ASSERT_EQ(document.page_count(), 2);
+    ASSERT_EQ(document.pages().size(), 2);
+    ASSERT_NE(document.pages()[0], document.pages()[1]);
+
+    ASSERT_FALSE(document.delete_page(1).has_error());
+    ASSERT_EQ(document.declared_page_count(), 1);
+    ASSERT_EQ(document.page_count(), 1);
+    ASSERT_EQ(document.pages().size(), 1);
+}
+
+TEST(Reader, SparseCrossReferenceTable) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    const auto data = std::string("%PDF-1.6\n"
+                                  "1 0 obj\n<</Type /Catalog /Pages 2 0 R>>\nendobj\n"
+                                  "2 0 obj\n<</Type /Pages /Count 0 /Kids []>>\nendobj\n"
+                                  "900000000 0 obj\n<<>>\nendobj\n"
+                                  "xref\n"
+                                  "0 3\n"
+                                  "0000000000 65535 f \n"
+                                  "0000000009 00000 n \n"
+                                  "0000000056 00000 n \n"
+                                  "900000000 1\n"
+                                  "0000000106 00000 n \n"
+                                  "trailer\n<</Size 900000001 /Root 1 0 R>>\n"
+                                  "startxref\n134\n%%EOF\n");
+    auto result = pdf::Document::read_from_memory(allocatorResult.value(), (const uint8_t *)data.data(), data.size());
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+
+    // only the entries are visited, not every object number up to the highest one
+    ASSERT_EQ(document.object_count(false), 3);
+    auto objectNumbers = std::vector<int64_t>();
+    for (auto object : document.objects()) {
+        objectNumbers.push_back(object->objectNumber);
+    }
+    ASSERT_EQ(objectNumbers, std::vector<int64_t>({1, 2, 900000000}));
+    ASSERT_EQ(document.object_count(true), 3);
+}
+
+TEST(Reader, WrongPageCount) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/two-pages.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+
+    // /Count is only informational, the pages themselves are what counts
+    document.catalog()->page_tree_root(document)->count()->value = 5;
+    ASSERT_EQ(document.declared_page_count(), 5);
+    ASSERT_EQ(document.page_count(), 2);
+    ASSERT_EQ(document.pages().size(), 2);
+    ASSERT_TRUE(document.delete_page(3).has_error());
+}
+
+TEST(Reader, EmbeddedFileCheckSum) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto &allocator = allocatorResult.value();
+
+    const auto digest     = std::string("\x8c\x1f\xc1(\xd7\\\n\x04\xb2\xb1)\x2c\x1c\x3e\x4d\x5f", 16);
+    auto createCheckSumOf = [&allocator](pdf::Object *checkSum) {
+        auto params        = pdf::UnorderedMap<std::string, pdf::Object *>(allocator);
+        params["CheckSum"] = checkSum;
+        auto entries       = pdf::UnorderedMap<std::string, pdf::Object *>(allocator);
+        entries["Type"]    = allocator.arena().push<pdf::Name>("EmbeddedFile");
+        entries["Params"]  = allocator.arena().push<pdf::Dictionary>(params);
+        auto stream        = pdf::Stream::create_from_unencoded_data(allocator, entries, "data");
+        return stream->as<pdf::EmbeddedFile>()->check_sum();
+    };
+
+    ASSERT_EQ(createCheckSumOf(allocator.arena().push<pdf::HexadecimalString>("8C1FC128D75C0A04B2B1292C1C3E4D5F")),
+              digest);
+    // binary literal strings contain escape sequences
+    ASSERT_EQ(createCheckSumOf(allocator.arena().push<pdf::LiteralString>(
+                    "\\214\x1f\xc1\\(\xd7\\\\\\n\4\xb2\xb1\\)\x2c\x1c\x3e\x4d\x5f")),
+              digest);
+    // the hexadecimal text that embed_file() used to write
+    ASSERT_EQ(createCheckSumOf(allocator.arena().push<pdf::LiteralString>("8c1fc128d75c0a04b2b1292c1c3e4d5f")), digest);
+    ASSERT_FALSE(createCheckSumOf(allocator.arena().push<pdf::Integer>(5)).has_value());
+}
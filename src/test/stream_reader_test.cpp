@@ -0,0 +1,236 @@
+#include <gtest/gtest.h>
+
+#include <pdf/operator_parser.h>
+#include <pdf/page.h>
+#include <pdf/stream_reader.h>
+
+std::string create_test_data(size_t sizeInBytes) {
+    auto result = std::string();
+    result.reserve(sizeInBytes);
+    for (size_t i = 0; result.size() < sizeInBytes; i++) {
+        result += std::to_string(i * 7919 % 10007) + " ";
+    }
+    result.resize(sizeInBytes);
+    return result;
+}
+
+TEST(StreamReader, Unfiltered) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error()) << allocatorResult.message();
+    auto &allocator = allocatorResult.value();
+
+    auto data       = create_test_data(10000);
+    auto dictionary = allocator.arena().push<pdf::Dictionary>(pdf::UnorderedMap<std::string, pdf::Object *>(allocator));
+    auto stream     = allocator.arena().push<pdf::Stream>(dictionary, data);
+
+    auto reader = pdf::StreamReader(allocator, stream, 4096);
+    auto result = std::string();
+    int chunks  = 0;
+    while (auto chunk = reader.read()) {
+        ASSERT_LE(chunk->size(), 4096);
+        result += chunk.value();
+        chunks++;
+    }
+
+    ASSERT_FALSE(reader.result().has_error());
+    ASSERT_EQ(chunks, 3);
+    ASSERT_EQ(reader.position(), data.size());
+    ASSERT_EQ(result, data);
+}
+
+TEST(StreamReader, FlateDecode) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error()) << allocatorResult.message();
+    auto &allocator = allocatorResult.value();
+
+    auto data   = create_test_data(1024 * 1024);
+    auto stream = pdf::Stream::create_from_unencoded_data(
+          allocator, pdf::UnorderedMap<std::string, pdf::Object *>(allocator), data);
+    ASSERT_EQ(stream->filters().size(), 1);
+    ASSERT_LT(stream->streamData.size(), data.size());
+
+    auto reader = pdf::StreamReader(allocator, stream, 4096);
+    auto result = std::string();
+    while (auto chunk = reader.read()) {
+        ASSERT_LE(chunk->size(), 4096);
+        result += chunk.value();
+    }
+
+    ASSERT_FALSE(reader.result().has_error());
+    ASSERT_EQ(reader.position(), data.size());
+    ASSERT_EQ(result, data);
+}
+
+TEST(StreamReader, InvalidData) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error()) << allocatorResult.message();
+    auto &allocator = allocatorResult.value();
+
+    auto dictValues      = pdf::UnorderedMap<std::string, pdf::Object *>(allocator);
+    dictValues["Filter"] = allocator.arena().push<pdf::Name>("FlateDecode");
+    auto dictionary      = allocator.arena().push<pdf::Dictionary>(dictValues);
+    auto stream          = allocator.arena().push<pdf::Stream>(dictionary, "this is not compressed");
+
+    auto reader = pdf::StreamReader(allocator, stream);
+    ASSERT_FALSE(reader.read().has_value());
+    ASSERT_TRUE(reader.result().has_error());
+}
+
+std::string create_content_stream(size_t operatorCount) {
+    auto result = std::string();
+    for (size_t i = 0; i < operatorCount; i++) {
+        result += "q 0.1 w " + std::to_string(i) + " 0 0 1 rg 10 " + std::to_string(i % 97) + " 20 10 re W* n Q\n";
+        result += "BT /Font" + std::to_string(i % 13) + " 12 Tf 1 0 0 1 " + std::to_string(i) + " 7.5 Tm";
+        result += " [(Hello \\(World\\) " + std::string(i % 200, 'x') + ") -250 (!)] TJ <48656C6C6F> Tj ET\n";
+    }
+    return result;
+}
+
+TEST(StreamTextProvider, InlineImagesAcrossChunkBoundaries) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error()) << allocatorResult.message();
+    auto &allocator = allocatorResult.value();
+
+    auto data = std::string();
+    for (size_t i = 0; i < 100; i++) {
+        // the size of the first image is known, the second one is found by searching for "EI"
+        data += "q BI /W 4 /H 1 /BPC 8 /CS /G ID " + std::string(i % 2 == 0 ? "E EI" : "xyz\n") + "\nEI Q\n";
+        data += "q BI /W 4 /H 1 /BPC 8 /CS /G /F /AHx ID " + std::string(i % 50, '0') + "EI> EI Q\n";
+    }
+    auto stream = pdf::Stream::create_from_unencoded_data(
+          allocator, pdf::UnorderedMap<std::string, pdf::Object *>(allocator), data);
+
+    for (size_t chunkSize : {1, 7, 64}) {
+        auto textProvider = pdf::StreamTextProvider(allocator, stream, chunkSize);
+        auto lexer        = pdf::TextLexer(textProvider);
+        auto parser       = pdf::OperatorParser(lexer, allocator.arena());
+
+        for (size_t i = 0; i < 100; i++) {
+            auto op = parser.get_operator();
+            ASSERT_NE(op, nullptr) << chunkSize;
+            ASSERT_EQ(op->type, pdf::Operator::Type::q_PushGraphicsState);
+            op = parser.get_operator();
+            ASSERT_NE(op, nullptr) << chunkSize;
+            ASSERT_EQ(op->type, pdf::Operator::Type::BI_InlineImage);
+            ASSERT_EQ(op->data.BI_InlineImage.stream->streamData, i % 2 == 0 ? "E EI" : "xyz\n") << chunkSize;
+            ASSERT_EQ(op->content.substr(0, 2), "BI");
+            ASSERT_EQ(op->content.substr(op->content.size() - 2), "EI");
+            op = parser.get_operator();
+            ASSERT_NE(op, nullptr) << chunkSize;
+            ASSERT_EQ(op->type, pdf::Operator::Type::Q_PopGraphicsState);
+
+            op = parser.get_operator();
+            ASSERT_NE(op, nullptr) << chunkSize;
+            ASSERT_EQ(op->type, pdf::Operator::Type::q_PushGraphicsState);
+            op = parser.get_operator();
+            ASSERT_NE(op, nullptr) << chunkSize;
+            ASSERT_EQ(op->type, pdf::Operator::Type::BI_InlineImage);
+            ASSERT_EQ(op->data.BI_InlineImage.stream->streamData, std::string(i % 50, '0') + "EI>") << chunkSize;
+            op = parser.get_operator();
+            ASSERT_NE(op, nullptr) << chunkSize;
+            ASSERT_EQ(op->type, pdf::Operator::Type::Q_PopGraphicsState);
+        }
+        ASSERT_EQ(parser.get_operator(), nullptr);
+        ASSERT_FALSE(textProvider.result().has_error());
+    }
+}
+
+TEST(StreamTextProvider, TokensAcrossChunkBoundaries) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error()) << allocatorResult.message();
+    auto &allocator = allocatorResult.value();
+
+    auto data   = create_content_stream(300);
+    auto stream = pdf::Stream::create_from_unencoded_data(
+          allocator, pdf::UnorderedMap<std::string, pdf::Object *>(allocator), data);
+
+    for (size_t chunkSize : {1, 7, 64, 1000, 64 * 1024}) {
+        auto expectedTextProvider = pdf::StringTextProvider(data);
+        auto expectedLexer        = pdf::TextLexer(expectedTextProvider);
+        auto expectedParser       = pdf::OperatorParser(expectedLexer, allocator.arena());
+
+        auto textProvider = pdf::StreamTextProvider(allocator, stream, chunkSize);
+        auto lexer        = pdf::TextLexer(textProvider);
+        auto parser       = pdf::OperatorParser(lexer, allocator.arena());
+
+        size_t operatorCount = 0;
+        while (auto expected = expectedParser.get_operator()) {
+            auto op = parser.get_operator();
+            ASSERT_NE(op, nullptr) << chunkSize;
+            ASSERT_EQ(op->type, expected->type) << chunkSize;
+            ASSERT_EQ(op->content, expected->content) << chunkSize;
+            if (op->type == pdf::Operator::Type::Tf_SetTextFontAndSize) {
+                ASSERT_EQ(op->data.Tf_SetTextFontAndSize.font_name(), expected->data.Tf_SetTextFontAndSize.font_name());
+            } else if (op->type == pdf::Operator::Type::Tm_SetTextMatrixAndTextLineMatrix) {
+                ASSERT_EQ(op->data.Tm_SetTextMatrixAndTextLineMatrix.matrix[4],
+                          expected->data.Tm_SetTextMatrixAndTextLineMatrix.matrix[4]);
+            } else if (op->type == pdf::Operator::Type::TJ_ShowOneOrMoreTextStrings) {
+                auto &values         = op->data.TJ_ShowOneOrMoreTextStrings.objects->values;
+                auto &expectedValues = expected->data.TJ_ShowOneOrMoreTextStrings.objects->values;
+                ASSERT_EQ(values.size(), expectedValues.size());
+                ASSERT_EQ(values[0]->as<pdf::LiteralString>()->value,
+                          expectedValues[0]->as<pdf::LiteralString>()->value);
+            }
+            operatorCount++;
+        }
+        ASSERT_EQ(parser.get_operator(), nullptr);
+        ASSERT_FALSE(textProvider.result().has_error());
+        ASSERT_EQ(operatorCount, 300 * 13);
+    }
+}
+
+TEST(StreamTextProvider, ForEachOperatorStopsParsingOnBreak) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error()) << allocatorResult.message();
+    auto &allocator = allocatorResult.value();
+
+    auto data   = create_content_stream(2000);
+    auto stream = pdf::Stream::create_from_unencoded_data(
+                        allocator, pdf::UnorderedMap<std::string, pdf::Object *>(allocator), data)
+                        ->as<pdf::ContentStream>();
+    (void)stream->decode(allocator);
+
+    // breaking right away only parses the first operator, which is not enough to keep the operators
+    auto usedSize = allocator.internal_statistics().usedSizeInBytes;
+    stream->for_each_operator(allocator, [](pdf::Operator *) { return pdf::ForEachResult::BREAK; });
+    auto breakSize = allocator.internal_statistics().usedSizeInBytes - usedSize;
+    ASSERT_EQ(stream->operators, nullptr);
+
+    usedSize             = allocator.internal_statistics().usedSizeInBytes;
+    size_t operatorCount = 0;
+    stream->for_each_operator(allocator, [&operatorCount](pdf::Operator *) {
+        operatorCount++;
+        return pdf::ForEachResult::CONTINUE;
+    });
+    auto fullSize = allocator.internal_statistics().usedSizeInBytes - usedSize;
+    ASSERT_EQ(stream->operatorCount, operatorCount);
+    ASSERT_LT(breakSize * 100, fullSize);
+}
+
+TEST(StreamTextProvider, StreamOperators) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error()) << allocatorResult.message();
+    auto &allocator = allocatorResult.value();
+
+    auto data   = create_content_stream(2000);
+    auto stream = pdf::Stream::create_from_unencoded_data(
+                        allocator, pdf::UnorderedMap<std::string, pdf::Object *>(allocator), data)
+                        ->as<pdf::ContentStream>();
+
+    auto types = std::vector<pdf::Operator::Type>();
+    stream->for_each_operator(allocator, [&types](pdf::Operator *op) {
+        types.push_back(op->type);
+        return pdf::ForEachResult::CONTINUE;
+    });
+
+    // streaming neither decodes the whole stream nor keeps the operators
+    auto internalUsedSize = allocator.internal_statistics().usedSizeInBytes;
+    size_t index          = 0;
+    stream->stream_operators(allocator, [&types, &index](pdf::Operator *op) {
+        EXPECT_EQ(op->type, types[index++]);
+        return pdf::ForEachResult::CONTINUE;
+    });
+    ASSERT_EQ(index, types.size());
+    ASSERT_EQ(allocator.internal_statistics().usedSizeInBytes, internalUsedSize);
+    ASSERT_EQ(allocator.temporary_statistics().usedSizeInBytes, 0);
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <numeric>
+
+#include <pdf/compression.h>
 #include <pdf/document.h>
 #include <pdf/page.h>
 
@@ -68,3 +71,184 @@ TEST(Text, Move) {
         ASSERT_DOUBLE_EQ(textBlocks[0].height, 9);
     }
 }
+
+TEST(Text, PageScopeReleasesPageMemory) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto &allocator = allocatorResult.value();
+
+    auto documentResult = pdf::Document::read_from_file(allocator, "../../../test-files/hello-world.pdf");
+    ASSERT_FALSE(documentResult.has_error());
+
+    auto &document = documentResult.value();
+    auto pages     = document.pages();
+    ASSERT_EQ(pages.size(), 1);
+
+    size_t internalUsedSize = 0;
+    for (int i = 0; i < 3; i++) {
+        {
+            auto scope      = pdf::PageScope(*pages[0]);
+            auto textBlocks = pages[0]->text_blocks();
+            ASSERT_EQ(textBlocks.size(), 1);
+            ASSERT_EQ(textBlocks[0].text, "Hello World");
+            ASSERT_GT(allocator.page_statistics().usedSizeInBytes, 0);
+        }
+        ASSERT_EQ(allocator.page_statistics().usedSizeInBytes, 0);
+
+        // the objects of the document are loaded once, processing the page again does not use any more memory
+        if (i == 0) {
+            internalUsedSize = allocator.internal_statistics().usedSizeInBytes;
+        } else {
+            ASSERT_EQ(allocator.internal_statistics().usedSizeInBytes, internalUsedSize);
+        }
+    }
+}
+
+TEST(Text, ContentStreamOperatorsAreParsedOnce) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto &allocator = allocatorResult.value();
+
+    auto documentResult = pdf::Document::read_from_file(allocator, "../../../test-files/hello-world.pdf");
+    ASSERT_FALSE(documentResult.has_error());
+
+    auto &document      = documentResult.value();
+    auto page           = document.pages()[0];
+    auto contentStreams = page->content_streams();
+    ASSERT_EQ(contentStreams.size(), 1);
+    ASSERT_EQ(contentStreams[0]->operators, nullptr);
+
+    auto characterCount = page->character_count();
+    auto operators      = contentStreams[0]->operators;
+    ASSERT_NE(operators, nullptr);
+    ASSERT_GT(contentStreams[0]->operatorCount, 0);
+
+    // traversing the page again reuses the operators without parsing the content stream again
+    ASSERT_EQ(page->character_count(), characterCount);
+    ASSERT_EQ(contentStreams[0]->operators, operators);
+
+    // editing the content stream invalidates its operators
+    auto textBlocks = page->text_blocks();
+    ASSERT_EQ(textBlocks.size(), 1);
+    textBlocks[0].move(document, 10, 500);
+    ASSERT_EQ(contentStreams[0]->operators, nullptr);
+    ASSERT_EQ(page->character_count(), characterCount);
+    ASSERT_NE(contentStreams[0]->operators, nullptr);
+}
+
+/// Creates a document whose pages share a font (with a compressed ToUnicode CMap) and one of their content streams
+static std::string create_document_with_shared_resources(pdf::Allocator &allocator, size_t pageCount) {
+    auto result    = std::string("%PDF-1.6\n");
+    auto offsets   = std::vector<size_t>();
+    auto addObject = [&](const std::string &content) {
+        offsets.push_back(result.size());
+        result += std::to_string(offsets.size()) + " 0 obj\n" + content + "\nendobj\n";
+    };
+    auto addStream = [&](const std::string &dictionary, std::string_view data) {
+        addObject("<<" + dictionary + " /Length " + std::to_string(data.size()) + ">>\nstream\n" + std::string(data) +
+                  "\nendstream");
+    };
+
+    auto kids = std::string();
+    for (size_t i = 0; i < pageCount; i++) {
+        kids += std::to_string(6 + i * 2) + " 0 R ";
+    }
+    addObject("<</Type /Catalog /Pages 2 0 R>>");
+    addObject("<</Type /Pages /Count " + std::to_string(pageCount) + " /Kids [" + kids + "]>>");
+    addObject("<</Type /Font /Subtype /Type0 /BaseFont /Test /ToUnicode 4 0 R>>");
+    const auto cmap = std::string("/CIDInit /ProcSet findresource begin\n12 dict begin\nbegincmap\n1 "
+                                  "begincodespacerange\n<00> <FF>\nendcodespacerange\n2 beginbfchar\n<01> <0048>\n"
+                                  "<02> <0069>\nendbfchar\nendcmap\nCMapName currentdict /CMap defineresource pop\n"
+                                  "end\nend");
+    addStream("/Filter /FlateDecode",
+              pdf::deflate_buffer(allocator, (const uint8_t *)cmap.data(), cmap.size()).value());
+    addStream("", "BT /F1 12 Tf 10 10 Td [<0102> -250 <01>] TJ ET");
+
+    for (size_t i = 0; i < pageCount; i++) {
+        addObject("<</Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] /Contents [5 0 R " + std::to_string(7 + i * 2) +
+                  " 0 R] /Resources <</Font <</F1 3 0 R>>>>>>");
+        auto glyphs = std::string("01");
+        for (size_t j = 0; j < i % 7; j++) {
+            glyphs += "02";
+        }
+        addStream("", "BT /F1 12 Tf 56.8 700 Td (Page " + std::to_string(i) + ") Tj [<" + glyphs + ">] TJ ET");
+    }
+
+    auto startXref = result.size();
+    result += "xref\n0 " + std::to_string(offsets.size() + 1) + "\n0000000000 65535 f \n";
+    for (auto offset : offsets) {
+        auto offsetStr = std::to_string(offset);
+        result += std::string(10 - offsetStr.size(), '0') + offsetStr + " 00000 n \n";
+    }
+    result += "trailer\n<</Size " + std::to_string(offsets.size() + 1) + " /Root 1 0 R>>\nstartxref\n" +
+              std::to_string(startXref) + "\n%%EOF\n";
+    return result;
+}
+
+TEST(Text, ParallelCharacterCount) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    const auto data = create_document_with_shared_resources(allocatorResult.value(), 200);
+
+    auto serialAllocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(serialAllocatorResult.has_error());
+    auto serialDocumentResult = pdf::Document::read_from_memory(serialAllocatorResult.value(),
+                                                                (const uint8_t *)data.data(), data.size());
+    ASSERT_FALSE(serialDocumentResult.has_error()) << serialDocumentResult.message();
+    auto serialCounts =
+          serialDocumentResult.value().parallel_for_each_page(1, [](pdf::Page *page) { return page->character_count(); });
+    ASSERT_EQ(serialCounts.size(), 200);
+    ASSERT_GT(serialCounts[0], 0);
+    ASSERT_EQ(serialCounts[1], serialCounts[0] + 1);
+
+    // the objects are loaded, the CMap is decoded and the content streams are parsed by the worker threads
+    for (size_t threadCount : {2, 8}) {
+        auto parallelAllocatorResult = pdf::Allocator::create();
+        ASSERT_FALSE(parallelAllocatorResult.has_error());
+        auto &parallelAllocator     = parallelAllocatorResult.value();
+        auto parallelDocumentResult = pdf::Document::read_from_memory(parallelAllocator, (const uint8_t *)data.data(),
+                                                                      data.size());
+        ASSERT_FALSE(parallelDocumentResult.has_error()) << parallelDocumentResult.message();
+        auto &document = parallelDocumentResult.value();
+
+        const auto internalUsed = parallelAllocator.internal_statistics().usedSizeInBytes;
+        auto counts = document.parallel_for_each_page(threadCount, [](pdf::Page *page) { return page->character_count(); });
+        ASSERT_EQ(counts, serialCounts);
+        ASSERT_EQ(document.character_count(threadCount), std::accumulate(counts.begin(), counts.end(), size_t(0)));
+
+        // the objects that have been loaded by the workers are kept in the document, but nothing else
+        ASSERT_GT(parallelAllocator.internal_statistics().usedSizeInBytes, internalUsed);
+        ASSERT_EQ(parallelAllocator.page_statistics().usedSizeInBytes, 0);
+        for (auto contentStream : document.pages()[0]->content_streams()) {
+            ASSERT_EQ(contentStream->operators, nullptr);
+        }
+    }
+}
+
+TEST(Text, ParallelTextBlocks) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto documentResult = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/two-pages.pdf");
+    ASSERT_FALSE(documentResult.has_error());
+    auto &document = documentResult.value();
+
+    auto texts = document.parallel_for_each_page(2, [](pdf::Page *page) {
+        auto result = std::vector<std::string>();
+        for (auto &textBlock : page->text_blocks()) {
+            result.push_back(textBlock.text);
+        }
+        return result;
+    });
+    ASSERT_EQ(texts.size(), 2);
+
+    auto serialTexts = std::vector<std::vector<std::string>>();
+    document.for_each_page([&serialTexts](pdf::Page *page) {
+        auto scope = pdf::PageScope(*page);
+        serialTexts.emplace_back();
+        for (auto &textBlock : page->text_blocks()) {
+            serialTexts.back().push_back(textBlock.text);
+        }
+        return pdf::ForEachResult::CONTINUE;
+    });
+    ASSERT_EQ(texts, serialTexts);
+}
@@ -1,29 +1,29 @@
 #include <gtest/gtest.h>
-#include <sstream>
 #include <vector>
 
 #include <pdf/document.h>
+#include <pdf/output_buffer.h>
 #include <pdf/util/types.h>
 
 namespace pdf {
-void write_object(std::ostream &s, Object *object);
-void write_null_object(std::ostream &s, Null *);
-void write_boolean_object(std::ostream &s, Boolean *boolean);
-void write_integer_object(std::ostream &s, Integer *integer);
-void write_real_object(std::ostream &s, Real *real);
-void write_hexadecimal_string_object(std::ostream &s, HexadecimalString *hexadecimal);
-void write_literal_string_object(std::ostream &s, LiteralString *literal);
-void write_name_object(std::ostream &s, Name *name);
-void write_array_object(std::ostream &s, Array *array);
-void write_dictionary_object(std::ostream &s, Dictionary *dictionary);
-void write_indirect_reference_object(std::ostream &s, IndirectReference *reference);
-void write_indirect_object(std::ostream &s, IndirectObject *object);
-void write_stream_object(std::ostream &s, Stream *stream);
-void write_object_stream_content_object(std::ostream &, ObjectStreamContent *);
+void write_object(OutputBuffer &s, Object *object);
+void write_null_object(OutputBuffer &s, Null *);
+void write_boolean_object(OutputBuffer &s, Boolean *boolean);
+void write_integer_object(OutputBuffer &s, Integer *integer);
+void write_real_object(OutputBuffer &s, Real *real);
+void write_hexadecimal_string_object(OutputBuffer &s, HexadecimalString *hexadecimal);
+void write_literal_string_object(OutputBuffer &s, LiteralString *literal);
+void write_name_object(OutputBuffer &s, Name *name);
+void write_array_object(OutputBuffer &s, Array *array);
+void write_dictionary_object(OutputBuffer &s, Dictionary *dictionary);
+void write_indirect_reference_object(OutputBuffer &s, IndirectReference *reference);
+void write_indirect_object(OutputBuffer &s, IndirectObject *object);
+void write_stream_object(OutputBuffer &s, Stream *stream);
+void write_object_stream_content_object(OutputBuffer &, ObjectStreamContent *);
 } // namespace pdf
 
 TEST(Writer, write_null) {
-    std::stringstream s;
+    pdf::OutputBuffer s;
     pdf::write_null_object(s, new pdf::Null());
     const auto &str = s.str();
     ASSERT_EQ(str, "null");
@@ -31,13 +31,13 @@ TEST(Writer, write_null) {
 
 TEST(Writer, write_boolean) {
     {
-        std::stringstream s;
+        pdf::OutputBuffer s;
         pdf::write_boolean_object(s, new pdf::Boolean(true));
         const auto &str = s.str();
         ASSERT_EQ(str, "true");
     }
     {
-        std::stringstream s;
+        pdf::OutputBuffer s;
         pdf::write_boolean_object(s, new pdf::Boolean(false));
         const auto &str = s.str();
         ASSERT_EQ(str, "false");
@@ -45,35 +45,35 @@ TEST(Writer, write_boolean) {
 }
 
 TEST(Writer, write_integer) {
-    std::stringstream s;
+    pdf::OutputBuffer s;
     pdf::write_integer_object(s, new pdf::Integer(123));
     const auto &str = s.str();
     ASSERT_EQ(str, "123");
 }
 
 TEST(Writer, write_real) {
-    std::stringstream s;
+    pdf::OutputBuffer s;
     pdf::write_real_object(s, new pdf::Real(12.3));
     const auto &str = s.str();
     ASSERT_EQ(str, "12.300000");
 }
 
 TEST(Writer, write_hexadecimal_string) {
-    std::stringstream s;
+    pdf::OutputBuffer s;
     pdf::write_hexadecimal_string_object(s, new pdf::HexadecimalString("abc123"));
     const auto &str = s.str();
     ASSERT_EQ(str, "<abc123>");
 }
 
 TEST(Writer, write_literal_string) {
-    std::stringstream s;
+    pdf::OutputBuffer s;
     pdf::write_literal_string_object(s, new pdf::LiteralString("My String"));
     const auto &str = s.str();
     ASSERT_EQ(str, "(My String)");
 }
 
 TEST(Writer, write_name) {
-    std::stringstream s;
+    pdf::OutputBuffer s;
     pdf::write_name_object(s, new pdf::Name("MyName"));
     const auto &str = s.str();
     ASSERT_EQ(str, "/MyName");
@@ -82,7 +82,7 @@ TEST(Writer, write_name) {
 TEST(Writer, write_array) {
     auto allocator_result = pdf::Allocator::create();
     auto &allocator       = allocator_result.value();
-    std::stringstream s;
+    pdf::OutputBuffer s;
     auto vec = pdf::Vector<pdf::Object *>(allocator);
     vec.push_back(new pdf::Name("Hello"));
     vec.push_back(new pdf::Name("World"));
@@ -94,7 +94,7 @@ TEST(Writer, write_array) {
 TEST(Writer, write_dictionary) {
     auto allocator_result = pdf::Allocator::create();
     auto &allocator       = allocator_result.value();
-    std::stringstream s;
+    pdf::OutputBuffer s;
     auto map     = pdf::UnorderedMap<std::string, pdf::Object *>(allocator);
     map["Hello"] = new pdf::Integer(123);
     map["World"] = new pdf::LiteralString("World");
@@ -104,14 +104,14 @@ TEST(Writer, write_dictionary) {
 }
 
 TEST(Writer, write_indirect_reference) {
-    std::stringstream s;
+    pdf::OutputBuffer s;
     pdf::write_indirect_reference_object(s, new pdf::IndirectReference(12, 3));
     const auto &str = s.str();
     ASSERT_EQ(str, "12 3 R");
 }
 
 TEST(Writer, write_indirect_object) {
-    std::stringstream s;
+    pdf::OutputBuffer s;
     pdf::write_indirect_object(s, new pdf::IndirectObject(12, 3, new pdf::Integer(5)));
     const auto &str = s.str();
     ASSERT_EQ(str, "12 3 obj\n5\nendobj\n");
@@ -120,7 +120,7 @@ TEST(Writer, write_indirect_object) {
 TEST(Writer, write_stream) {
     auto allocator_result = pdf::Allocator::create();
     auto &allocator       = allocator_result.value();
-    std::stringstream s;
+    pdf::OutputBuffer s;
     auto m    = pdf::UnorderedMap<std::string, pdf::Object *>(allocator);
     m["Size"] = new pdf::Integer(123);
     auto dict = new pdf::Dictionary(m);
@@ -128,3 +128,43 @@ TEST(Writer, write_stream) {
     const auto &str = s.str();
     ASSERT_EQ(str, "<</Size 123>>\nstream\nabc123\nendstream");
 }
+
+TEST(Writer, write_real_matches_to_string) {
+    for (double value : {0.0, -0.0, 1.0, -1.5, 0.1, 123456.789, 1e-7, 5e-7, 1e20, -3.999999951}) {
+        pdf::OutputBuffer s;
+        pdf::write_real_object(s, new pdf::Real(value));
+        ASSERT_EQ(s.str(), std::to_string(value));
+    }
+}
+
+TEST(Writer, write_xref_entry) {
+    pdf::OutputBuffer s;
+    s.write_xref_entry(0, 65535, 'f');
+    s.write_xref_entry(1234567, 0, 'n');
+    ASSERT_EQ(s.str(), "0000000000 65535 f \n0001234567 00000 n \n");
+}
+
+TEST(Writer, output_buffer_grows) {
+    pdf::OutputBuffer s;
+    auto expected = std::string();
+    for (int i = 0; i < 100000; i++) {
+        s << i << ' ';
+        expected += std::to_string(i) + " ";
+    }
+    ASSERT_EQ(s.size(), expected.size());
+    ASSERT_EQ(s.str(), expected);
+
+    size_t size  = 0;
+    auto *buffer = s.release(size);
+    ASSERT_EQ(size, expected.size());
+    ASSERT_EQ(std::string_view((char *)buffer, size), expected);
+    free(buffer);
+}
+
+TEST(Writer, output_buffer_char_array) {
+    pdf::OutputBuffer s;
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%d", 42);
+    s << "[" << buf << "]";
+    ASSERT_EQ(s.str(), "[42]");
+}
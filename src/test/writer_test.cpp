@@ -1,3 +1,4 @@
+#include <cstring>
 #include <filesystem>
 #include <gtest/gtest.h>
 #include <iostream>
@@ -37,6 +38,173 @@ TEST(Writer, DeletePageFirst) {
     ASSERT_TRUE(std::filesystem::exists(std::filesystem::path(filePath)));
 }
 
+TEST(Writer, RemoveUnusedObjects) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto &allocator     = allocatorResult.value();
+    auto documentResult = pdf::Document::read_from_file(allocator, "../../../test-files/hello-world.pdf");
+    ASSERT_FALSE(documentResult.has_error()) << documentResult.message();
+    auto &document = documentResult.value();
+
+    // two objects that are not referenced from anywhere in the document, even though one references the other
+    auto unused      = document.add_object(allocator.arena().push<pdf::Integer>(42));
+    auto values      = pdf::UnorderedMap<std::string, pdf::Object *>(allocator);
+    values["Unused"] = allocator.arena().push<pdf::IndirectReference>(unused, 0);
+    document.add_object(allocator.arena().push<pdf::Dictionary>(values));
+
+    uint8_t *fullBuffer = nullptr;
+    size_t fullSize     = 0;
+    ASSERT_FALSE(document.write_to_memory(fullBuffer, fullSize).has_error());
+    auto fullResult = pdf::Document::read_from_memory(allocator, fullBuffer, fullSize);
+    ASSERT_FALSE(fullResult.has_error()) << fullResult.message();
+
+    auto options                = pdf::WriteOptions();
+    options.removeUnusedObjects = true;
+    uint8_t *buffer             = nullptr;
+    size_t size                 = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size, options).has_error());
+    ASSERT_LT(size, fullSize);
+
+    auto writtenResult = pdf::Document::read_from_memory(allocator, buffer, size);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    auto &written = writtenResult.value();
+    ASSERT_EQ(1, written.page_count());
+    ASSERT_EQ(written.object_count() + 2, fullResult.value().object_count());
+
+    // everything that is left is still reachable
+    auto temp      = allocator.temporary();
+    auto reachable = written.find_reachable_objects(temp);
+    ASSERT_EQ(reachable.size(), written.object_count());
+    free(fullBuffer);
+    free(buffer);
+}
+
+TEST(Writer, RenumberObjects) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto &allocator     = allocatorResult.value();
+    auto documentResult = pdf::Document::read_from_file(allocator, "../../../test-files/two-pages.pdf");
+    ASSERT_FALSE(documentResult.has_error()) << documentResult.message();
+    auto &document = documentResult.value();
+    ASSERT_FALSE(document.delete_page(1).has_error());
+
+    auto options                = pdf::WriteOptions();
+    options.removeUnusedObjects = true;
+    options.renumberObjects     = true;
+    uint8_t *buffer             = nullptr;
+    size_t size                 = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size, options).has_error());
+
+    auto writtenResult = pdf::Document::read_from_memory(allocator, buffer, size, true);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    auto &written = writtenResult.value();
+    ASSERT_EQ(1, written.page_count());
+
+    // the object numbers are dense, which means that the only free entry is the head of the free list
+    auto objectCount = static_cast<int64_t>(written.object_count());
+    ASSERT_EQ(objectCount + 1, written.file.trailer.dict->must_find<pdf::Integer>("Size")->value);
+    int64_t expectedObjectNumber = 1;
+    written.for_each_object([&expectedObjectNumber](pdf::IndirectObject *object) {
+        EXPECT_EQ(expectedObjectNumber++, object->objectNumber);
+        EXPECT_EQ(0, object->generationNumber);
+        return pdf::ForEachResult::CONTINUE;
+    });
+    free(buffer);
+}
+
+TEST(Writer, DeduplicateObjects) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto &allocator     = allocatorResult.value();
+    auto documentResult = pdf::Document::read_from_file(allocator, "../../../test-files/hello-world.pdf");
+    ASSERT_FALSE(documentResult.has_error()) << documentResult.message();
+    auto &document = documentResult.value();
+
+    // the same stream is added twice, together with a dictionary referring to it, which is also identical after the
+    // streams have been merged
+    auto references = pdf::Vector<pdf::Object *>(allocator);
+    for (int i = 0; i < 2; i++) {
+        auto streamValues = pdf::UnorderedMap<std::string, pdf::Object *>(allocator);
+        auto stream       = pdf::Stream::create_from_unencoded_data(allocator, streamValues, "the same data");
+
+        auto values    = pdf::UnorderedMap<std::string, pdf::Object *>(allocator);
+        values["Data"] = allocator.arena().push<pdf::IndirectReference>(document.add_object(stream), 0);
+        auto holder    = document.add_object(allocator.arena().push<pdf::Dictionary>(values));
+        references.push_back(allocator.arena().push<pdf::IndirectReference>(holder, 0));
+    }
+    auto listObjectNumber = document.add_object(allocator.arena().push<pdf::Array>(references));
+
+    uint8_t *fullBuffer = nullptr;
+    size_t fullSize     = 0;
+    ASSERT_FALSE(document.write_to_memory(fullBuffer, fullSize).has_error());
+    auto fullResult = pdf::Document::read_from_memory(allocator, fullBuffer, fullSize);
+    ASSERT_FALSE(fullResult.has_error()) << fullResult.message();
+
+    auto options               = pdf::WriteOptions();
+    options.deduplicateObjects = true;
+    uint8_t *buffer            = nullptr;
+    size_t size                = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size, options).has_error());
+    ASSERT_LT(size, fullSize);
+
+    auto writtenResult = pdf::Document::read_from_memory(allocator, buffer, size);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    auto &written = writtenResult.value();
+    ASSERT_EQ(1, written.page_count());
+    ASSERT_EQ(written.object_count() + 2, fullResult.value().object_count());
+
+    auto list = written.get_object(listObjectNumber)->object->as<pdf::Array>();
+    ASSERT_EQ(2, list->values.size());
+    ASSERT_EQ(list->values[0]->as<pdf::IndirectReference>()->objectNumber,
+              list->values[1]->as<pdf::IndirectReference>()->objectNumber);
+    free(fullBuffer);
+    free(buffer);
+}
+
+TEST(Writer, DeduplicateKeepsAnnotations) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto &allocator     = allocatorResult.value();
+    auto documentResult = pdf::Document::read_from_file(allocator, "../../../test-files/two-pages.pdf");
+    ASSERT_FALSE(documentResult.has_error()) << documentResult.message();
+    auto &document = documentResult.value();
+
+    // an annotation belongs to exactly one page, identical annotations on different pages must stay separate
+    for (auto page : document.pages()) {
+        auto rect = pdf::Vector<pdf::Object *>(allocator);
+        for (auto coordinate : {10, 10, 30, 30}) {
+            rect.push_back(allocator.arena().push<pdf::Integer>(coordinate));
+        }
+        auto values        = pdf::UnorderedMap<std::string, pdf::Object *>(allocator);
+        values["Type"]     = allocator.arena().push<pdf::Name>("Annot");
+        values["Subtype"]  = allocator.arena().push<pdf::Name>("Text");
+        values["Rect"]     = allocator.arena().push<pdf::Array>(rect);
+        values["Contents"] = allocator.arena().push<pdf::LiteralString>("Note");
+        auto annotation    = document.add_object(allocator.arena().push<pdf::Dictionary>(values));
+
+        auto annots = pdf::Vector<pdf::Object *>(allocator);
+        annots.push_back(allocator.arena().push<pdf::IndirectReference>(annotation, 0));
+        page->node->values["Annots"] = allocator.arena().push<pdf::Array>(annots);
+    }
+
+    auto options               = pdf::WriteOptions();
+    options.deduplicateObjects = true;
+    uint8_t *buffer            = nullptr;
+    size_t size                = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size, options).has_error());
+
+    auto writtenResult = pdf::Document::read_from_memory(allocator, buffer, size);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    auto &written = writtenResult.value();
+    ASSERT_EQ(2, written.page_count());
+    auto annotationOf = [&written](size_t pageIndex) {
+        auto annots = written.pages()[pageIndex]->node->must_find<pdf::Array>("Annots");
+        return annots->values[0]->as<pdf::IndirectReference>()->objectNumber;
+    };
+    ASSERT_NE(annotationOf(0), annotationOf(1));
+    free(buffer);
+}
+
 TEST(Writer, DISABLED_DeletePageSecond) {
     auto allocatorResult = pdf::Allocator::create();
     ASSERT_FALSE(allocatorResult.has_error());
@@ -121,6 +289,10 @@ TEST(Writer, Embed) {
         ASSERT_EQ(6650, embeddedFile->dictionary->must_find<pdf::Integer>("Length")->value);
         auto params = embeddedFile->dictionary->must_find<pdf::Dictionary>("Params");
         ASSERT_EQ(7350, params->must_find<pdf::Integer>("Size")->value);
+
+        auto checkSum = embeddedFile->check_sum();
+        ASSERT_TRUE(checkSum.has_value());
+        ASSERT_EQ(checkSum.value(), pdf::HexadecimalString("cfe11cd83950838aec155d34580304fc").to_string());
     };
 
     auto result_2 = pdf::Document::read_from_memory(allocatorResult.value(), buffer, size);
@@ -160,6 +332,291 @@ TEST(Writer, Objects) {
     ASSERT_BUFFER_CONTAINS_AT(buffer, 19, "8 0 obj");
 }
 
+std::string_view raw_object_data(pdf::Document &document, int64_t objectNumber) {
+    auto object = document.get_object(objectNumber);
+    if (object == nullptr) {
+        return {};
+    }
+    return document.file.metadata.objects[object].data;
+}
+
+TEST(Writer, UnmodifiedObjectsAreCopied) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/hello-world.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+
+    uint8_t *buffer = nullptr;
+    size_t size     = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size).has_error());
+
+    auto writtenResult = pdf::Document::read_from_memory(allocatorResult.value(), buffer, size);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    auto &written = writtenResult.value();
+    ASSERT_EQ(document.object_count(false), written.object_count(false));
+
+    // none of the objects have been loaded before writing, they still have to end up in the output unchanged
+    for (int64_t i = 1; i < static_cast<int64_t>(document.object_count(false)) + 1; i++) {
+        ASSERT_EQ(raw_object_data(document, i), raw_object_data(written, i)) << "object " << i;
+    }
+    free(buffer);
+}
+
+TEST(Writer, ModifiedObjectsAreSerialized) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/two-pages.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+
+    auto parent = document.pages()[0]->node->parent(document);
+    ASSERT_FALSE(document.is_dirty(document.find_existing_object(parent)));
+    ASSERT_FALSE(document.delete_page(1).has_error());
+    ASSERT_TRUE(document.is_dirty(document.find_existing_object(parent)));
+
+    uint8_t *buffer = nullptr;
+    size_t size     = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size).has_error());
+
+    auto writtenResult = pdf::Document::read_from_memory(allocatorResult.value(), buffer, size);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    auto &written = writtenResult.value();
+    ASSERT_EQ(1, written.page_count());
+    free(buffer);
+}
+
+TEST(Writer, UnmarkedModificationsAreSerialized) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/two-pages.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+
+    // neither of these modifications marks the objects as dirty
+    auto root = document.catalog()->page_tree_root(document);
+    root->count()->value = 5;
+    document.catalog()->values["Lang"] = allocatorResult.value().arena().push<pdf::LiteralString>("en");
+    ASSERT_TRUE(document.is_dirty(document.find_existing_object(root)));
+
+    uint8_t *buffer = nullptr;
+    size_t size     = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size).has_error());
+
+    auto writtenResult = pdf::Document::read_from_memory(allocatorResult.value(), buffer, size);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    auto &written = writtenResult.value();
+    ASSERT_EQ(written.declared_page_count(), 5);
+    ASSERT_EQ(written.catalog()->must_find<pdf::LiteralString>("Lang")->value, "en");
+    free(buffer);
+}
+
+TEST(Writer, ObjectStreamRoundTrip) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/object-stream.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+    auto pageCount = document.page_count();
+
+    uint8_t *buffer = nullptr;
+    size_t size     = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size).has_error());
+
+    auto writtenResult = pdf::Document::read_from_memory(allocatorResult.value(), buffer, size, true);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    auto &written = writtenResult.value();
+    ASSERT_EQ(pageCount, written.page_count());
+
+    // the compressed objects are written as regular objects, the object stream itself is dropped
+    written.for_each_object([](pdf::IndirectObject *object) {
+        auto type = object->object->is<pdf::Stream>()
+                          ? object->object->as<pdf::Stream>()->dictionary->find<pdf::Name>("Type")
+                          : std::optional<pdf::Name *>();
+        EXPECT_FALSE(type.has_value() && type.value()->value == "ObjStm");
+        EXPECT_FALSE(type.has_value() && type.value()->value == "XRef");
+        return pdf::ForEachResult::CONTINUE;
+    });
+    free(buffer);
+}
+
+TEST(Writer, IncrementalSave) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/two-pages.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+    ASSERT_FALSE(document.delete_page(1).has_error());
+
+    auto options        = pdf::WriteOptions();
+    options.incremental = true;
+    uint8_t *buffer     = nullptr;
+    size_t size         = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size, options).has_error());
+
+    // the original file is left untouched, only the modified objects and a new cross reference table are appended
+    ASSERT_GT(size, document.file.sizeInBytes);
+    ASSERT_EQ(0, std::memcmp(buffer, document.file.data, document.file.sizeInBytes));
+
+    auto writtenResult = pdf::Document::read_from_memory(allocatorResult.value(), buffer, size);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    auto &written = writtenResult.value();
+    ASSERT_NE(nullptr, written.file.trailer.dict);
+    ASSERT_EQ(document.file.lastCrossRefStart, written.file.trailer.dict->must_find<pdf::Integer>("Prev")->value);
+    ASSERT_NE(nullptr, written.file.trailer.prev);
+    ASSERT_EQ(1, written.page_count());
+    ASSERT_EQ(document.object_count(false), written.object_count(false));
+    free(buffer);
+}
+
+TEST(Writer, IncrementalSaveCrossReferenceStream) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), "../../../test-files/object-stream.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document   = result.value();
+    auto pageCount   = document.page_count();
+    auto objectCount = document.object_count(false);
+    auto newObject   = document.add_object(allocatorResult.value().arena().push<pdf::Integer>(42));
+
+    auto options        = pdf::WriteOptions();
+    options.incremental = true;
+    uint8_t *buffer     = nullptr;
+    size_t size         = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size, options).has_error());
+    ASSERT_EQ(0, std::memcmp(buffer, document.file.data, document.file.sizeInBytes));
+
+    auto writtenResult = pdf::Document::read_from_memory(allocatorResult.value(), buffer, size);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    auto &written = writtenResult.value();
+    ASSERT_EQ(nullptr, written.file.trailer.dict);
+    ASSERT_NE(nullptr, written.file.trailer.streamObject);
+    ASSERT_NE(nullptr, written.file.trailer.prev);
+    ASSERT_EQ(pageCount, written.page_count());
+    // the new object and the cross reference stream itself
+    ASSERT_EQ(objectCount + 2, written.object_count(false));
+    ASSERT_EQ(42, written.get_object(newObject)->object->as<pdf::Integer>()->value);
+    free(buffer);
+}
+
+TEST(Writer, IncrementalSaveInPlace) {
+    auto filePath = std::string("incremental-save-in-place.pdf");
+    std::filesystem::copy_file("../../../test-files/hello-world.pdf", filePath,
+                               std::filesystem::copy_options::overwrite_existing);
+    auto originalSize = std::filesystem::file_size(filePath);
+
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto result = pdf::Document::read_from_file(allocatorResult.value(), filePath);
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+    document.add_object(allocatorResult.value().arena().push<pdf::Integer>(42));
+
+    auto options        = pdf::WriteOptions();
+    options.incremental = true;
+    ASSERT_FALSE(document.write_to_file(filePath, options).has_error());
+    ASSERT_GT(std::filesystem::file_size(filePath), originalSize);
+
+    // the file has changed on disk, appending another update based on the old cross reference section would break it
+    ASSERT_TRUE(document.write_to_file(filePath, options).has_error());
+
+    auto writtenResult = pdf::Document::read_from_file(allocatorResult.value(), filePath);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    ASSERT_EQ(document.file.lastCrossRefStart,
+              writtenResult.value().file.trailer.dict->must_find<pdf::Integer>("Prev")->value);
+}
+
+TEST(Writer, ParallelWriteIsIdentical) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto &allocator = allocatorResult.value();
+    auto result     = pdf::Document::read_from_file(allocator, "../../../test-files/hello-world.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+
+    // enough new objects to split the serialization into several blocks
+    for (int64_t i = 0; i < 1000; i++) {
+        auto values      = pdf::UnorderedMap<std::string, pdf::Object *>(allocator);
+        values["Number"] = allocator.arena().push<pdf::Integer>(i);
+        values["Real"]   = allocator.arena().push<pdf::Real>(static_cast<double>(i) / 3.0);
+        document.add_object(allocator.arena().push<pdf::Dictionary>(values));
+    }
+
+    uint8_t *sequentialBuffer = nullptr;
+    size_t sequentialSize     = 0;
+    ASSERT_FALSE(document.write_to_memory(sequentialBuffer, sequentialSize).has_error());
+
+    auto options        = pdf::WriteOptions();
+    options.threadCount = 4;
+    uint8_t *buffer     = nullptr;
+    size_t size         = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size, options).has_error());
+
+    ASSERT_EQ(sequentialSize, size);
+    ASSERT_EQ(0, std::memcmp(sequentialBuffer, buffer, size));
+
+    auto writtenResult = pdf::Document::read_from_memory(allocator, buffer, size);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    ASSERT_EQ(document.object_count(false) + 1000, writtenResult.value().object_count(false));
+    free(sequentialBuffer);
+    free(buffer);
+}
+
+TEST(Writer, ObjectStreams) {
+    auto allocatorResult = pdf::Allocator::create();
+    ASSERT_FALSE(allocatorResult.has_error());
+    auto &allocator = allocatorResult.value();
+    auto result     = pdf::Document::read_from_file(allocator, "../../../test-files/hello-world.pdf");
+    ASSERT_FALSE(result.has_error()) << result.message();
+    auto &document = result.value();
+    for (int64_t i = 0; i < 1000; i++) {
+        auto values      = pdf::UnorderedMap<std::string, pdf::Object *>(allocator);
+        values["Number"] = allocator.arena().push<pdf::Integer>(i);
+        document.add_object(allocator.arena().push<pdf::Dictionary>(values));
+    }
+
+    uint8_t *tableBuffer = nullptr;
+    size_t tableSize     = 0;
+    ASSERT_FALSE(document.write_to_memory(tableBuffer, tableSize).has_error());
+
+    auto options             = pdf::WriteOptions();
+    options.useObjectStreams = true;
+    uint8_t *buffer          = nullptr;
+    size_t size              = 0;
+    ASSERT_FALSE(document.write_to_memory(buffer, size, options).has_error());
+    ASSERT_LT(size, tableSize / 2);
+
+    auto writtenResult = pdf::Document::read_from_memory(allocator, buffer, size, true);
+    ASSERT_FALSE(writtenResult.has_error()) << writtenResult.message();
+    auto &written = writtenResult.value();
+    ASSERT_NE(nullptr, written.file.trailer.streamObject);
+    ASSERT_EQ(1, written.page_count());
+
+    // the field widths are as small as possible: 1 byte for the type, 2 bytes for offsets below 64K and 2 bytes for
+    // the generation number 65535 of the head of the free list
+    auto W = written.file.trailer.streamObject->object->as<pdf::Stream>()->dictionary->must_find<pdf::Array>("W");
+    ASSERT_EQ(1, W->values[0]->as<pdf::Integer>()->value);
+    ASSERT_EQ(2, W->values[1]->as<pdf::Integer>()->value);
+    ASSERT_EQ(2, W->values[2]->as<pdf::Integer>()->value);
+
+    size_t objectStreamCount = 0;
+    int64_t numberSum        = 0;
+    written.for_each_object([&objectStreamCount, &numberSum](pdf::IndirectObject *object) {
+        if (object->object->is<pdf::Stream>()) {
+            auto type = object->object->as<pdf::Stream>()->dictionary->find<pdf::Name>("Type");
+            objectStreamCount += type.has_value() && type.value()->value == "ObjStm";
+        } else if (object->object->is<pdf::Dictionary>()) {
+            auto number = object->object->as<pdf::Dictionary>()->find<pdf::Integer>("Number");
+            numberSum += number.has_value() ? number.value()->value : 0;
+        }
+        return pdf::ForEachResult::CONTINUE;
+    });
+    ASSERT_EQ(11, objectStreamCount);
+    ASSERT_EQ(999 * 1000 / 2, numberSum);
+    free(tableBuffer);
+    free(buffer);
+}
+
 std::vector<std::string_view> split_by_lines(const std::string &input) {
     size_t lastStartIndex = 0;
     size_t currentIndex   = 0;